@@ -0,0 +1,202 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "FrameTransform.h"
+#include "../CoreExceptions.h"
+#include <cmath>
+
+#if defined(__AVX__)
+#  define FRAMETRANSFORM_AVX 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define FRAMETRANSFORM_SSE2 1
+#endif
+#if defined(FRAMETRANSFORM_AVX) || defined(FRAMETRANSFORM_SSE2)
+#  include <immintrin.h>
+#endif
+
+namespace core {
+
+namespace {
+
+#if defined(FRAMETRANSFORM_AVX)
+/** 4 doubles per register */
+struct PackAVX
+{
+	typedef __m256d type;
+	enum { width = 4 };
+	static type load (const double * p) { return _mm256_loadu_pd(p); }
+	static void store (double * p, type v) { _mm256_storeu_pd(p, v); }
+	static type set1 (double d) { return _mm256_set1_pd(d); }
+	static type add (type a, type b) { return _mm256_add_pd(a, b); }
+	static type mul (type a, type b) { return _mm256_mul_pd(a, b); }
+};
+#endif
+
+#if defined(FRAMETRANSFORM_SSE2)
+/** 2 doubles per register */
+struct PackSSE2
+{
+	typedef __m128d type;
+	enum { width = 2 };
+	static type load (const double * p) { return _mm_loadu_pd(p); }
+	static void store (double * p, type v) { _mm_storeu_pd(p, v); }
+	static type set1 (double d) { return _mm_set1_pd(d); }
+	static type add (type a, type b) { return _mm_add_pd(a, b); }
+	static type mul (type a, type b) { return _mm_mul_pd(a, b); }
+};
+#endif
+
+
+/**
+ * Transforms the points stored by coordinates, a register of points at a time, with the
+ * products and sums in the order of FrameTransform::xform(const Point3 &).
+ * Returns the number of points processed (a multiple of the register width).
+ */
+template <class P>
+size_t xformKernel (const double (&m)[3][4], size_t count, const double * x, const double * y, const double * z,
+	double * xOut, double * yOut, double * zOut)
+{
+	typedef typename P::type V;
+	V r[3][4];
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 4; ++j)
+			r[i][j] = P::set1(m[i][j]);
+	}
+
+	size_t k = 0;
+	for (; k + P::width <= count; k += P::width) {
+		const V px = P::load(x + k), py = P::load(y + k), pz = P::load(z + k);
+		const V qx = P::add(P::add(P::add(P::mul(r[0][0], px), P::mul(r[0][1], py)), P::mul(r[0][2], pz)), r[0][3]);
+		const V qy = P::add(P::add(P::add(P::mul(r[1][0], px), P::mul(r[1][1], py)), P::mul(r[1][2], pz)), r[1][3]);
+		const V qz = P::add(P::add(P::add(P::mul(r[2][0], px), P::mul(r[2][1], py)), P::mul(r[2][2], pz)), r[2][3]);
+		P::store(xOut + k, qx);
+		P::store(yOut + k, qy);
+		P::store(zOut + k, qz);
+	}
+	return k;
+}
+
+}  // namespace
+
+
+FrameTransform::FrameTransform()
+{
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 4; ++j)
+			m[i][j] = (i == j) ? 1.0 : 0.0;
+	}
+}
+
+
+FrameTransform::FrameTransform(const Trihedron & from, const Trihedron & to)
+{
+	// from.xformTo(to, p) is invert(to) * from * p: once for all the points
+	const Matrix4 composed = invert(to.getMatrix()) * from.getMatrix();
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 4; ++j)
+			m[i][j] = composed[i][j];
+	}
+}
+
+
+FrameTransform::FrameTransform(const Matrix4 & matrix)
+{
+	if (! (std::abs(matrix[3][0]) < IGT_EPSILON
+	       && std::abs(matrix[3][1]) < IGT_EPSILON
+	       && std::abs(matrix[3][2]) < IGT_EPSILON
+	       && std::abs(matrix[3][3] - 1) < IGT_EPSILON))
+		throw IGTInvalidParameterErr("FrameTransform", "Matrix is not an homogeneous matrix");
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 4; ++j)
+			m[i][j] = matrix[i][j];
+	}
+}
+
+
+void FrameTransform::xform (const Point3 * in, Point3 * out, size_t count) const
+{
+	size_t k = 0;
+#if defined(FRAMETRANSFORM_AVX)
+	// a point per register, its coordinates in the first three lanes
+	const __m256d c0 = _mm256_setr_pd(m[0][0], m[1][0], m[2][0], 0.0);
+	const __m256d c1 = _mm256_setr_pd(m[0][1], m[1][1], m[2][1], 0.0);
+	const __m256d c2 = _mm256_setr_pd(m[0][2], m[1][2], m[2][2], 0.0);
+	const __m256d c3 = _mm256_setr_pd(m[0][3], m[1][3], m[2][3], 0.0);
+	for (; k < count; ++k) {
+		const double * p = &in[k][0];
+		__m256d q = _mm256_add_pd(_mm256_mul_pd(c0, _mm256_broadcast_sd(p)), _mm256_mul_pd(c1, _mm256_broadcast_sd(p + 1)));
+		q = _mm256_add_pd(_mm256_add_pd(q, _mm256_mul_pd(c2, _mm256_broadcast_sd(p + 2))), c3);
+		double * r = &out[k][0];
+		_mm_storeu_pd(r, _mm256_castpd256_pd128(q));
+		_mm_store_sd(r + 2, _mm256_extractf128_pd(q, 1));
+	}
+#elif defined(FRAMETRANSFORM_SSE2)
+	// x and y of a point in a register, z in another one
+	const __m128d c0 = _mm_setr_pd(m[0][0], m[1][0]), d0 = _mm_set_sd(m[2][0]);
+	const __m128d c1 = _mm_setr_pd(m[0][1], m[1][1]), d1 = _mm_set_sd(m[2][1]);
+	const __m128d c2 = _mm_setr_pd(m[0][2], m[1][2]), d2 = _mm_set_sd(m[2][2]);
+	const __m128d c3 = _mm_setr_pd(m[0][3], m[1][3]), d3 = _mm_set_sd(m[2][3]);
+	for (; k < count; ++k) {
+		const double * p = &in[k][0];
+		const __m128d px = _mm_set1_pd(p[0]), py = _mm_set1_pd(p[1]), pz = _mm_set1_pd(p[2]);
+		const __m128d xy = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(c0, px), _mm_mul_pd(c1, py)), _mm_mul_pd(c2, pz)), c3);
+		const __m128d z  = _mm_add_sd(_mm_add_sd(_mm_add_sd(_mm_mul_sd(d0, px), _mm_mul_sd(d1, py)), _mm_mul_sd(d2, pz)), d3);
+		double * r = &out[k][0];
+		_mm_storeu_pd(r, xy);
+		_mm_store_sd(r + 2, z);
+	}
+#endif
+	for (; k < count; ++k)
+		out[k] = xform(in[k]);
+}
+
+
+void FrameTransform::xform (const double * x, const double * y, const double * z, double * xOut, double * yOut,
+	double * zOut, size_t count) const
+{
+	size_t k = 0;
+#if defined(FRAMETRANSFORM_AVX)
+	k = xformKernel<PackAVX>(m, count, x, y, z, xOut, yOut, zOut);
+#elif defined(FRAMETRANSFORM_SSE2)
+	k = xformKernel<PackSSE2>(m, count, x, y, z, xOut, yOut, zOut);
+#endif
+	for (; k < count; ++k) {
+		const Point3 q = xform(Point3(x[k], y[k], z[k]));
+		xOut[k] = q[0];
+		yOut[k] = q[1];
+		zOut[k] = q[2];
+	}
+}
+
+
+FrameTransform FrameTransform::inverse() const
+{
+	return FrameTransform(invert(getMatrix()));
+}
+
+
+Matrix4 FrameTransform::getMatrix() const
+{
+	return Matrix4(m[0][0], m[0][1], m[0][2], m[0][3],
+		m[1][0], m[1][1], m[1][2], m[1][3],
+		m[2][0], m[2][1], m[2][2], m[2][3],
+		0.0, 0.0, 0.0, 1.0);
+}
+
+
+FrameTransform operator* (const FrameTransform & a, const FrameTransform & b)
+{
+	FrameTransform ab;
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			ab.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j];
+		}
+		ab.m[i][3] += a.m[i][3];
+	}
+	return ab;
+}
+
+
+}  // namespace core
@@ -0,0 +1,114 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef FrameTransformH
+#define FrameTransformH
+
+#include "../../libCore.h"
+#include "Trihedron.h"
+
+#include <cstddef>
+
+namespace core {
+
+/**
+ * @brief The change of coordinates between two trihedrons, computed once.
+ *
+ * Trihedron::xformTo builds both matrices and inverts one for each point. A FrameTransform
+ * keeps the composed affine matrix (3 x 4: the last row of the homogeneous matrix is
+ * always (0, 0, 0, 1)), and transforms single points or whole arrays of them, with SIMD
+ * when available. The arrays compute the same products and sums as the single points, in the
+ * same order: the results are the same, to the last bits where the compiler contracts the
+ * single point products and sums into multiply-adds (e.g. -ffp-contract=fast with FMA).
+ *
+ * The transform is a snapshot: changes of the trihedrons afterwards are not seen.
+ */
+class TGCORE_API FrameTransform
+{
+public:
+	/** The identity. */
+	FrameTransform();
+
+	/**
+	 * The transform of the points expressed in @em from to @em to, as from.xformTo(to, p).
+	 * @throws IGTDivideByZeroErr if the axes of @em to are not independent.
+	 */
+	FrameTransform(const Trihedron & from, const Trihedron & to);
+
+	/**
+	 * The transform of an homogeneous matrix.
+	 * @warning The last line of the matrix must be (0, 0, 0, 1),
+	 * @throws IGTInvalidParameterErr otherwise.
+	 */
+	explicit FrameTransform(const Matrix4 & m);
+
+	/** Returns the transformed point. */
+	inline Point3 xform (const Point3 & p) const;
+
+	/** Returns the transformed vector: the translation does not apply. */
+	inline Vector3 xformVector (const Vector3 & v) const;
+
+	/** Returns the transformed point, in homogeneous coordinates (a vector if t is 0). */
+	inline Vector4 xform (const Vector4 & p) const;
+
+	/**
+	 * Transforms count points. out may be in.
+	 * @param in the points to transform,
+	 * @param out set to xform(in[i]), for each point,
+	 * @param count the number of points.
+	 */
+	void xform (const Point3 * in, Point3 * out, size_t count) const;
+
+	/**
+	 * Transforms count points stored by coordinates, as the columns of a voxel grid.
+	 * The output arrays may be the input ones.
+	 */
+	void xform (const double * x, const double * y, const double * z, double * xOut, double * yOut, double * zOut,
+		size_t count) const;
+
+	/**
+	 * Returns the inverse transform, from @em to to @em from.
+	 * @throws IGTDivideByZeroErr if the transform is not invertible.
+	 */
+	FrameTransform inverse() const;
+
+	/** Returns the homogeneous matrix of the transform. */
+	Matrix4 getMatrix() const;
+
+	/** Returns the transform b, then a: the transform from the trihedron of b to the one of a. */
+	friend TGCORE_API FrameTransform operator* (const FrameTransform & a, const FrameTransform & b);
+
+private:
+	/** The first three rows of the homogeneous matrix. */
+	double m[3][4];
+};
+
+
+inline Point3 FrameTransform::xform (const Point3 & p) const
+{
+	return Point3(m[0][0] * p[0] + m[0][1] * p[1] + m[0][2] * p[2] + m[0][3],
+		m[1][0] * p[0] + m[1][1] * p[1] + m[1][2] * p[2] + m[1][3],
+		m[2][0] * p[0] + m[2][1] * p[1] + m[2][2] * p[2] + m[2][3]);
+}
+
+
+inline Vector3 FrameTransform::xformVector (const Vector3 & v) const
+{
+	return Vector3(m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2],
+		m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2],
+		m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2]);
+}
+
+
+inline Vector4 FrameTransform::xform (const Vector4 & p) const
+{
+	return Vector4(m[0][0] * p[0] + m[0][1] * p[1] + m[0][2] * p[2] + m[0][3] * p[3],
+		m[1][0] * p[0] + m[1][1] * p[1] + m[1][2] * p[2] + m[1][3] * p[3],
+		m[2][0] * p[0] + m[2][1] * p[1] + m[2][2] * p[2] + m[2][3] * p[3],
+		p[3]);
+}
+
+
+}  // namespace core
+#endif  // FrameTransformH
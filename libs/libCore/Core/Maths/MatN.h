@@ -0,0 +1,428 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MatNH
+#define MatNH
+
+#include "../../libCore.h"
+#include "../Constants.h"
+#include "../CoreExceptions.h"
+#include "Matrix3.h"
+#include "Matrix4.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include <cmath>
+#include <initializer_list>
+#include <iostream>
+#include <type_traits>
+
+namespace core {
+
+//! @cond EXCLUDE_FROM_PLUGINS_SDK
+namespace detail {
+
+/// Calls f(0), f(1), ..., f(N - 1), unrolled at compile time.
+template <int N>
+struct Unroll
+{
+	template <typename F>
+	static inline void apply(const F & f)
+	{
+		Unroll<N - 1>::apply(f);
+		f(N - 1);
+	}
+};
+
+template <>
+struct Unroll<0>
+{
+	template <typename F>
+	static inline void apply(const F &) {}
+};
+
+/// Whether M converts to and from a MatN<R, C>, and element access for the conversion.
+template <typename M, int R, int C>
+struct MatNInterop : std::false_type {};
+
+template <>
+struct MatNInterop<Matrix3, 3, 3> : std::true_type
+{
+	static double get(const Matrix3 & m, int r, int c) { return m[r][c]; }
+	static void set(Matrix3 & m, int r, int c, double value) { m[r][c] = value; }
+};
+
+template <>
+struct MatNInterop<Matrix4, 4, 4> : std::true_type
+{
+	static double get(const Matrix4 & m, int r, int c) { return m[r][c]; }
+	static void set(Matrix4 & m, int r, int c, double value) { m[r][c] = value; }
+};
+
+template <>
+struct MatNInterop<Vector3, 3, 1> : std::true_type
+{
+	static double get(const Vector3 & v, int r, int) { return v[r]; }
+	static void set(Vector3 & v, int r, int, double value) { v[r] = value; }
+};
+
+template <>
+struct MatNInterop<Vector4, 4, 1> : std::true_type
+{
+	static double get(const Vector4 & v, int r, int) { return v[r]; }
+	static void set(Vector4 & v, int r, int, double value) { v[r] = value; }
+};
+
+};  // namespace detail
+//! @endcond
+
+
+/// A R x C matrix of fixed size, stored row by row on the stack.
+/// The dimensions are known at compile time: no allocation, and the element loops are unrolled.
+/// MatN<3, 3>, MatN<4, 4>, MatN<3, 1> and MatN<4, 1> convert implicitly to and from Matrix3, Matrix4,
+/// Vector3 and Vector4.
+template <int R, int C, typename T = double>
+class MatN
+{
+	static_assert(R > 0 && C > 0, "MatN dimensions must be positive");
+
+public:
+	typedef T ValueType;
+
+	/// Number of rows.
+	static constexpr int Rows = R;
+	/// Number of columns.
+	static constexpr int Cols = C;
+	/// Number of elements.
+	static constexpr int Size = R * C;
+
+	// Constructors
+	/// Default constructor. All the elements are set to 0.
+	MatN() { fill(T(0)); }
+
+	/// Constructor from the elements, row by row. The missing elements are set to 0.
+	MatN(std::initializer_list<T> values)
+	{
+		fill(T(0));
+		int k = 0;
+		for (auto it = values.begin(); it != values.end() && k < Size; ++it)
+			m_data[k++] = *it;
+	}
+
+	/// Conversion from Matrix3, Matrix4, Vector3 or Vector4, of the same dimensions.
+	template <typename M, typename std::enable_if<detail::MatNInterop<M, R, C>::value, int>::type = 0>
+	MatN(const M & m)
+	{
+		for (int r = 0; r < R; ++r)
+			for (int c = 0; c < C; ++c)
+				(*this)(r, c) = T(detail::MatNInterop<M, R, C>::get(m, r, c));
+	}
+
+	/// Conversion to Matrix3, Matrix4, Vector3 or Vector4, of the same dimensions.
+	template <typename M, typename std::enable_if<detail::MatNInterop<M, R, C>::value, int>::type = 0>
+	operator M() const
+	{
+		M m;
+		for (int r = 0; r < R; ++r)
+			for (int c = 0; c < C; ++c)
+				detail::MatNInterop<M, R, C>::set(m, r, c, double((*this)(r, c)));
+		return m;
+	}
+
+	/// Returns a matrix with 1 on the diagonal and 0 elsewhere.
+	static MatN identity()
+	{
+		MatN m;
+		detail::Unroll<(R < C ? R : C)>::apply([&](int i) { m(i, i) = T(1); });
+		return m;
+	}
+
+	// Accessors
+	/// Element of row r and column c.
+	inline T & operator() (int r, int c) { return m_data[r * C + c]; }
+	inline const T & operator() (int r, int c) const { return m_data[r * C + c]; }
+
+	/// Element k, row by row: the component k of a vector.
+	inline T & operator[] (int k) { return m_data[k]; }
+	inline const T & operator[] (int k) const { return m_data[k]; }
+
+	/// The elements, row by row.
+	inline T * data() { return m_data; }
+	inline const T * data() const { return m_data; }
+
+	/// Sets all the elements to value.
+	void fill(T value)
+	{
+		detail::Unroll<Size>::apply([&](int k) { m_data[k] = value; });
+	}
+
+	// Assignment operators
+	MatN & operator+= (const MatN & m)
+	{
+		detail::Unroll<Size>::apply([&](int k) { m_data[k] += m.m_data[k]; });
+		return *this;
+	}
+
+	MatN & operator-= (const MatN & m)
+	{
+		detail::Unroll<Size>::apply([&](int k) { m_data[k] -= m.m_data[k]; });
+		return *this;
+	}
+
+	MatN & operator*= (T d)
+	{
+		detail::Unroll<Size>::apply([&](int k) { m_data[k] *= d; });
+		return *this;
+	}
+
+	MatN & operator/= (T d)
+	{
+		return *this *= T(1) / d;
+	}
+
+	/// Whether all the elements differ from those of m by at most epsilon.
+	bool isClose(const MatN & m, T epsilon) const
+	{
+		for (int k = 0; k < Size; ++k)
+			if (std::abs(m_data[k] - m.m_data[k]) > epsilon)
+				return false;
+		return true;
+	}
+
+private:
+	T m_data[Size];
+};
+
+template <int R, int C, typename T> constexpr int MatN<R, C, T>::Rows;
+template <int R, int C, typename T> constexpr int MatN<R, C, T>::Cols;
+template <int R, int C, typename T> constexpr int MatN<R, C, T>::Size;
+
+/// A column vector of fixed size.
+template <int N, typename T = double>
+using VecN = MatN<N, 1, T>;
+
+
+// Operators
+
+template <int R, int C, typename T>
+inline MatN<R, C, T> operator+ (MatN<R, C, T> m1, const MatN<R, C, T> & m2)
+{
+	return m1 += m2;
+}
+
+template <int R, int C, typename T>
+inline MatN<R, C, T> operator- (MatN<R, C, T> m1, const MatN<R, C, T> & m2)
+{
+	return m1 -= m2;
+}
+
+template <int R, int C, typename T>
+inline MatN<R, C, T> operator- (MatN<R, C, T> m)
+{
+	return m *= T(-1);
+}
+
+template <int R, int C, typename T>
+inline MatN<R, C, T> operator* (MatN<R, C, T> m, typename MatN<R, C, T>::ValueType d)
+{
+	return m *= d;
+}
+
+template <int R, int C, typename T>
+inline MatN<R, C, T> operator* (typename MatN<R, C, T>::ValueType d, MatN<R, C, T> m)
+{
+	return m *= d;
+}
+
+template <int R, int C, typename T>
+inline MatN<R, C, T> operator/ (MatN<R, C, T> m, typename MatN<R, C, T>::ValueType d)
+{
+	return m /= d;
+}
+
+/// Matrix product.
+template <int R, int K, int C, typename T>
+inline MatN<R, C, T> operator* (const MatN<R, K, T> & m1, const MatN<K, C, T> & m2)
+{
+	MatN<R, C, T> m;
+	detail::Unroll<R * C>::apply([&](int rc) {
+		const int r = rc / C, c = rc % C;
+		T sum = T(0);
+		detail::Unroll<K>::apply([&](int k) { sum += m1(r, k) * m2(k, c); });
+		m(r, c) = sum;
+	});
+	return m;
+}
+
+/// Product of a 3x3 matrix and a Vector3, so that they mix without an explicit conversion.
+inline Vector3 operator* (const MatN<3, 3, double> & m, const Vector3 & v)
+{
+	return Vector3(
+		m(0, 0) * v[0] + m(0, 1) * v[1] + m(0, 2) * v[2],
+		m(1, 0) * v[0] + m(1, 1) * v[1] + m(1, 2) * v[2],
+		m(2, 0) * v[0] + m(2, 1) * v[1] + m(2, 2) * v[2]);
+}
+
+/// Exact comparison of all the elements.
+template <int R, int C, typename T>
+inline bool operator== (const MatN<R, C, T> & m1, const MatN<R, C, T> & m2)
+{
+	return m1.isClose(m2, T(0));
+}
+
+template <int R, int C, typename T>
+inline bool operator!= (const MatN<R, C, T> & m1, const MatN<R, C, T> & m2)
+{
+	return !(m1 == m2);
+}
+
+/// Displays the matrix row by row, one row per line.
+template <int R, int C, typename T>
+std::ostream & operator<< (std::ostream & os, const MatN<R, C, T> & m)
+{
+	for (int r = 0; r < R; ++r) {
+		for (int c = 0; c < C; ++c)
+			os << (c ? " " : "") << m(r, c);
+		os << std::endl;
+	}
+	return os;
+}
+
+
+// Functions
+
+template <int R, int C, typename T>
+inline MatN<C, R, T> transpose (const MatN<R, C, T> & m)
+{
+	MatN<C, R, T> t;
+	detail::Unroll<R * C>::apply([&](int rc) { t(rc % C, rc / C) = m(rc / C, rc % C); });
+	return t;
+}
+
+template <int N, typename T>
+inline T trace (const MatN<N, N, T> & m)
+{
+	T sum = T(0);
+	detail::Unroll<N>::apply([&](int i) { sum += m(i, i); });
+	return sum;
+}
+
+/// Dot product of two vectors.
+template <int N, typename T>
+inline T dot (const MatN<N, 1, T> & v1, const MatN<N, 1, T> & v2)
+{
+	T sum = T(0);
+	detail::Unroll<N>::apply([&](int i) { sum += v1[i] * v2[i]; });
+	return sum;
+}
+
+/// Solves m x = b for x, with one column of x per column of b: Gaussian elimination with partial pivoting,
+/// on a copy of m kept on the stack.
+/// Throws IGTDivideByZeroErr if m is singular.
+template <int N, int K, typename T>
+MatN<N, K, T> solve (MatN<N, N, T> m, MatN<N, K, T> b)
+{
+	for (int i = 0; i < N; ++i) {
+		int pivot = i;
+		for (int r = i + 1; r < N; ++r)
+			if (std::abs(m(r, i)) > std::abs(m(pivot, i)))
+				pivot = r;
+		if (std::abs(m(pivot, i)) < IGT_LITTLE_EPSILON)
+			throw IGTDivideByZeroErr("MatN solve, singular matrix");
+		if (pivot != i) {
+			for (int c = i; c < N; ++c)
+				std::swap(m(i, c), m(pivot, c));
+			for (int c = 0; c < K; ++c)
+				std::swap(b(i, c), b(pivot, c));
+		}
+		for (int r = i + 1; r < N; ++r) {
+			T factor = m(r, i) / m(i, i);
+			for (int c = i + 1; c < N; ++c)
+				m(r, c) -= factor * m(i, c);
+			for (int c = 0; c < K; ++c)
+				b(r, c) -= factor * b(i, c);
+		}
+	}
+	for (int i = N - 1; i >= 0; --i) {
+		for (int c = 0; c < K; ++c) {
+			T sum = b(i, c);
+			for (int j = i + 1; j < N; ++j)
+				sum -= m(i, j) * b(j, c);
+			b(i, c) = sum / m(i, i);
+		}
+	}
+	return b;
+}
+
+/// Determinant, by elimination with partial pivoting.
+template <int N, typename T>
+T determinant (MatN<N, N, T> m)
+{
+	T det = T(1);
+	for (int i = 0; i < N; ++i) {
+		int pivot = i;
+		for (int r = i + 1; r < N; ++r)
+			if (std::abs(m(r, i)) > std::abs(m(pivot, i)))
+				pivot = r;
+		if (m(pivot, i) == T(0))
+			return T(0);
+		if (pivot != i) {
+			for (int c = i; c < N; ++c)
+				std::swap(m(i, c), m(pivot, c));
+			det = -det;
+		}
+		det *= m(i, i);
+		for (int r = i + 1; r < N; ++r) {
+			T factor = m(r, i) / m(i, i);
+			for (int c = i + 1; c < N; ++c)
+				m(r, c) -= factor * m(i, c);
+		}
+	}
+	return det;
+}
+
+template <typename T>
+inline T determinant (const MatN<2, 2, T> & m)
+{
+	return m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+}
+
+template <typename T>
+inline T determinant (const MatN<3, 3, T> & m)
+{
+	return m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1)) +
+	       m(0, 1) * (m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2)) +
+	       m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+}
+
+/// Inverse of m.
+/// Throws IGTDivideByZeroErr if m is singular.
+template <int N, typename T>
+inline MatN<N, N, T> invert (const MatN<N, N, T> & m)
+{
+	return solve(m, MatN<N, N, T>::identity());
+}
+
+template <typename T>
+inline MatN<3, 3, T> invert (const MatN<3, 3, T> & m)
+{
+	T det = determinant(m);
+	if (std::abs(det) < IGT_LITTLE_EPSILON)
+		throw IGTDivideByZeroErr("MatN invert, determinant zero");
+
+	return MatN<3, 3, T> {
+		m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1),
+		m(2, 1) * m(0, 2) - m(2, 2) * m(0, 1),
+		m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1),
+		m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2),
+		m(2, 2) * m(0, 0) - m(2, 0) * m(0, 2),
+		m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2),
+		m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0),
+		m(2, 0) * m(0, 1) - m(2, 1) * m(0, 0),
+		m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)
+	} / det;
+}
+
+
+};  // namespace core
+#endif // ifndef MatNH
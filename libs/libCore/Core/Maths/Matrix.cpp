@@ -5,9 +5,167 @@
 #include "Matrix.h"
 #include <stdexcept>
 #include <cmath>
+#include <thread>
+#include <utility>
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#  define MATRIX_AVX2_FMA 1
+#  include <immintrin.h>
+#endif
 
 namespace core {
 
+namespace {
+
+// Blocking of the product, for doubles: a MC x KC block of A stays in L2 while a KC x NC panel of B streams
+// from L3, and the micro-kernel keeps a MR x NR block of C in registers.
+const int MR = 4;
+const int NR = 8;
+const int MC = 128;
+const int KC = 256;
+const int NC = 2048;
+
+// Below this many multiply-adds, packing costs more than it saves
+const double SmallProduct = 16.0 * 16.0 * 16.0;
+
+// Block size of the LU factorization and of the triangular solves
+const int LUBlock = 64;
+
+
+// Copies the mc x kc block of A into slivers of MR rows, column by column, padded with 0
+void packA (int mc, int kc, const double * a, int lda, double * packed)
+{
+	for (int ir = 0; ir < mc; ir += MR) {
+		int mr = std::min(MR, mc - ir);
+		for (int p = 0; p < kc; ++p) {
+			for (int i = 0; i < MR; ++i) {
+				*packed++ = i < mr ? a[(ir + i) * lda + p] : 0.0;
+			}
+		}
+	}
+}
+
+
+// Copies the kc x nc panel of B into slivers of NR columns, row by row, padded with 0
+void packB (int kc, int nc, const double * b, int ldb, double * packed)
+{
+	for (int jr = 0; jr < nc; jr += NR) {
+		int nr = std::min(NR, nc - jr);
+		for (int p = 0; p < kc; ++p) {
+			const double * row = b + p * ldb + jr;
+			for (int j = 0; j < NR; ++j) {
+				*packed++ = j < nr ? row[j] : 0.0;
+			}
+		}
+	}
+}
+
+
+// C (mr x nr, at most MR x NR) += alpha A B, from a packed sliver of A and a packed sliver of B
+void microKernel (int kc, double alpha, const double * a, const double * b, double * c, int ldc, int mr, int nr)
+{
+	double acc[MR][NR];
+
+#if defined(MATRIX_AVX2_FMA)
+	__m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+	__m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+	__m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+	__m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+	for (int p = 0; p < kc; ++p, a += MR, b += NR) {
+		__m256d b0 = _mm256_loadu_pd(b);
+		__m256d b1 = _mm256_loadu_pd(b + 4);
+		__m256d ai = _mm256_broadcast_sd(a);
+		c00 = _mm256_fmadd_pd(ai, b0, c00);
+		c01 = _mm256_fmadd_pd(ai, b1, c01);
+		ai  = _mm256_broadcast_sd(a + 1);
+		c10 = _mm256_fmadd_pd(ai, b0, c10);
+		c11 = _mm256_fmadd_pd(ai, b1, c11);
+		ai  = _mm256_broadcast_sd(a + 2);
+		c20 = _mm256_fmadd_pd(ai, b0, c20);
+		c21 = _mm256_fmadd_pd(ai, b1, c21);
+		ai  = _mm256_broadcast_sd(a + 3);
+		c30 = _mm256_fmadd_pd(ai, b0, c30);
+		c31 = _mm256_fmadd_pd(ai, b1, c31);
+	}
+	_mm256_storeu_pd(acc[0], c00);
+	_mm256_storeu_pd(acc[0] + 4, c01);
+	_mm256_storeu_pd(acc[1], c10);
+	_mm256_storeu_pd(acc[1] + 4, c11);
+	_mm256_storeu_pd(acc[2], c20);
+	_mm256_storeu_pd(acc[2] + 4, c21);
+	_mm256_storeu_pd(acc[3], c30);
+	_mm256_storeu_pd(acc[3] + 4, c31);
+#else
+	// the compiler vectorizes the j loops
+	for (int i = 0; i < MR; ++i) {
+		for (int j = 0; j < NR; ++j) {
+			acc[i][j] = 0.0;
+		}
+	}
+	for (int p = 0; p < kc; ++p, a += MR, b += NR) {
+		for (int i = 0; i < MR; ++i) {
+			for (int j = 0; j < NR; ++j) {
+				acc[i][j] += a[i] * b[j];
+			}
+		}
+	}
+#endif
+
+	for (int i = 0; i < mr; ++i) {
+		for (int j = 0; j < nr; ++j) {
+			c[i * ldc + j] += alpha * acc[i][j];
+		}
+	}
+}
+
+
+// C (m x n) += alpha A (m x k) B (k x n), all stored row by row with the given row strides
+void gemm (int m, int n, int k, double alpha, const double * a, int lda, const double * b, int ldb, double * c, int ldc)
+{
+	if (m <= 0 || n <= 0 || k <= 0)
+		return;
+
+	if (double(m) * n * k <= SmallProduct) {
+		for (int i = 0; i < m; ++i) {
+			for (int j = 0; j < n; ++j) {
+				double sum = 0.0;
+				for (int p = 0; p < k; ++p) {
+					sum += a[i * lda + p] * b[p * ldb + j];
+				}
+				c[i * ldc + j] += alpha * sum;
+			}
+		}
+		return;
+	}
+
+	int ncMax = std::min(NC, (n + NR - 1) / NR * NR);
+	int kcMax = std::min(KC, k);
+	int mcMax = std::min(MC, (m + MR - 1) / MR * MR);
+	std::vector<double> packedA(mcMax * kcMax), packedB(kcMax * ncMax);
+
+	for (int jc = 0; jc < n; jc += NC) {
+		int nc = std::min(NC, n - jc);
+		for (int pc = 0; pc < k; pc += KC) {
+			int kc = std::min(KC, k - pc);
+			packB(kc, nc, b + pc * ldb + jc, ldb, packedB.data());
+			for (int ic = 0; ic < m; ic += MC) {
+				int mc = std::min(MC, m - ic);
+				packA(mc, kc, a + ic * lda + pc, lda, packedA.data());
+				for (int jr = 0; jr < nc; jr += NR) {
+					for (int ir = 0; ir < mc; ir += MR) {
+						microKernel(kc, alpha, packedA.data() + ir * kc, packedB.data() + jr * kc,
+						            c + (ic + ir) * ldc + jc + jr, ldc, std::min(MR, mc - ir), std::min(NR, nc - jr));
+					}
+				}
+			}
+		}
+	}
+}
+
+}  // namespace
+
+
+
 Xform2DParams::Xform2DParams(int flags_) :
 	flags(flags_)
 {
@@ -69,18 +227,25 @@ Matrix::Matrix(const Matrix & m_) :
 }
 
 
+Matrix::Matrix(Matrix && m_) :
+	m_own(m_.m_own)
+	, m_cols(m_.m_cols)
+	, m_rows(m_.m_rows)
+	, m_data(m_.m_data)
+{
+	m_.m_own  = true;
+	m_.m_cols = 0;
+	m_.m_rows = 0;
+	m_.m_data = nullptr;
+}
+
+
 Matrix & Matrix::operator= (const Matrix & other)
 {
 	if (this == &other)
 		return *this;
 
-	m_cols = other.m_cols;
-	m_rows = other.m_rows;
-
-	if (m_own)
-		delete[] m_data;
-	m_own  = true;
-	m_data = new double[m_cols * m_rows];
+	setSize(other.m_cols, other.m_rows);
 
 	for (int k = 0; k < m_cols * m_rows; ++k) {
 		m_data[k] = other.m_data[k];
@@ -90,6 +255,42 @@ Matrix & Matrix::operator= (const Matrix & other)
 }
 
 
+Matrix & Matrix::operator= (Matrix && other)
+{
+	if (this == &other)
+		return *this;
+
+	if (m_own)
+		delete[] m_data;
+
+	m_own  = other.m_own;
+	m_cols = other.m_cols;
+	m_rows = other.m_rows;
+	m_data = other.m_data;
+
+	other.m_own  = true;
+	other.m_cols = 0;
+	other.m_rows = 0;
+	other.m_data = nullptr;
+
+	return *this;
+}
+
+
+void Matrix::setSize(int cols_, int rows_)
+{
+	if (! m_own || cols_ * rows_ != m_cols * m_rows) {
+		if (m_own)
+			delete[] m_data;
+		m_own  = true;
+		m_data = new double[cols_ * rows_];
+	}
+
+	m_cols = cols_;
+	m_rows = rows_;
+}
+
+
 Matrix::Matrix(const Xform2DParams & P) :
 	m_own(true)
 	, m_cols(3)
@@ -158,7 +359,7 @@ Matrix::~Matrix(void)
 }
 
 
-Matrix Matrix::transpose() const
+Matrix Matrix::transpose() const &
 {
 	Matrix res(m_rows, m_cols);
 
@@ -172,85 +373,83 @@ Matrix Matrix::transpose() const
 }
 
 
-Matrix Matrix::inverse() const  // Gauss-Jordan elimination
+Matrix Matrix::transpose() &&
+{
+	if (m_cols == m_rows) {
+		for (int j = 0; j < m_rows; ++j) {
+			for (int i = j + 1; i < m_cols; ++i) {
+				std::swap(m_data[j * m_cols + i], m_data[i * m_cols + j]);
+			}
+		}
+	}
+	else if (m_cols == 1 || m_rows == 1) {
+		// a vector: same components, row by row
+		std::swap(m_cols, m_rows);
+	}
+	else {
+		return static_cast<const Matrix &>(*this).transpose();
+	}
+
+	return std::move(*this);
+}
+
+
+Matrix Matrix::inverse() const &
 {
 	if (m_cols != m_rows)
 		throw std::domain_error("Matrix inversion: matrix not square");
 
-	Matrix mat(*this);
-	Matrix res(m_cols, m_rows);
-
-	for (int j0 = 0; j0 < m_rows; ++j0) {
-		double pivot = mat[j0 * (m_cols + 1)];
-		int pindex   = j0;
-		for (int j = j0 + 1; j < m_rows; ++j) {
-			double c = mat[j * m_cols + j0];
-			if (std::abs(c) > std::abs(pivot)) {
-				pivot  = c;
-				pindex = j;
-			}
-		}
+	LUDecomposition lu(*this);
+	if (lu.isSingular())
+		throw std::domain_error("Matrix not invertible");
 
-		if (pivot == 0.0f)
-			throw std::domain_error("Matrix not invertible");
+	Matrix res(m_cols);
+	lu.solve(res.m_data, m_cols);
 
-		if (pindex != j0) {
-			for (int i = j0; i < m_cols; ++i) {
-				std::swap(mat[j0 * m_cols + i], mat[pindex * m_cols + i]);
-			}
-			for (int i = 0; i < m_cols; ++i) {
-				std::swap(res[j0 * m_cols + i], res[pindex * m_cols + i]);
-			}
-		}
+	return res;
+}
 
-		for (int i = j0; i < m_cols; ++i) {
-			mat[j0 * m_cols + i] /= pivot;
-		}
-		for (int i = 0; i < m_cols; ++i) {
-			res[j0 * m_cols + i] /= pivot;
-		}
 
-		for (int j = 0; j < m_rows; ++j) {
-			if (j == j0)
-				continue;
+Matrix Matrix::inverse() &&
+{
+	if (m_cols != m_rows)
+		throw std::domain_error("Matrix inversion: matrix not square");
 
-			double k = mat[j * m_cols + j0];
-			if (k == 0.0f)
-				continue;
-			else
-				mat[j * m_cols + j0] = 0.0f;
+	LUDecomposition lu(*this);
+	if (lu.isSingular())
+		throw std::domain_error("Matrix not invertible");
 
-			for (int i = j0 + 1; i < m_cols; ++i) {
-				mat[j * m_cols + i] -= k * mat[j0 * m_cols + i];
-			}
-			for (int i = 0; i < m_cols; ++i) {
-				res[j * m_cols + i] -= k * res[j0 * m_cols + i];
-			}
-		}
-	}
+	init();
+	lu.solve(m_data, m_cols);
 
-	return res;
+	return std::move(*this);
 }
 
 
 Matrix operator* (const Matrix & lhs, const Matrix & rhs)
+{
+	Matrix res(rhs.m_cols, lhs.m_rows);
+	multiplyInto(res, lhs, rhs);
+
+	return res;
+}
+
+
+void multiplyInto (Matrix & out, const Matrix & lhs, const Matrix & rhs)
 {
 	if (lhs.m_cols != rhs.m_rows)
 		throw std::domain_error("Matrix product: sizes mismatch");
 
-	Matrix res(rhs.m_cols, lhs.m_rows);
-
-	for (int j = 0; j < res.m_rows; ++j) {
-		for (int i = 0; i < res.m_cols; ++i) {
-			double & c = res[j * res.m_cols + i];
-			c = 0.0f;
-			for (int k = 0; k < lhs.m_cols; ++k) {
-				c += lhs[k * lhs.m_rows + i] * rhs[j * rhs.m_cols + k];
-			}
-		}
+	if (&out == &lhs || &out == &rhs) {
+		out = lhs * rhs;
+		return;
 	}
 
-	return res;
+	out.setSize(rhs.m_cols, lhs.m_rows);
+	std::fill_n(out.m_data, out.m_cols * out.m_rows, 0.0);
+
+	// same order of the components as ever: out[j][i] = sum of rhs[j][k] * lhs[k * lhs.m_rows + i]
+	gemm(lhs.m_rows, rhs.m_cols, lhs.m_cols, 1.0, rhs.m_data, rhs.m_cols, lhs.m_data, lhs.m_rows, out.m_data, out.m_cols);
 }
 
 
@@ -269,16 +468,7 @@ Matrix & Matrix::operator+= (const Matrix & rhs)
 
 Matrix & Matrix::operator*= (const Matrix & rhs)
 {
-	Matrix mat(*this * rhs);
-
-	// TRICKY Constant time copy and destroy
-	// cppcheck-suppress unreadVariable
-	mat.m_own = false;
-	delete[] m_data;
-	m_data    = mat.m_data;
-
-	m_cols    = mat.m_cols;
-	m_rows    = mat.m_rows;
+	multiplyInto(*this, *this, rhs);
 
 	return *this;
 }
@@ -314,7 +504,7 @@ Matrix & Matrix::operator*= (const Matrix & rhs)
     //return tmp;*/
 
 
-Matrix solve (const Matrix & A, const Matrix & b)  // Gaussian elimination
+Matrix solve (const Matrix & A, const Matrix & b)  // LU factorization with partial pivoting
 {
 	if (A.m_cols != A.m_rows)
 		throw std::domain_error("System solving: matrix not square");
@@ -325,57 +515,150 @@ Matrix solve (const Matrix & A, const Matrix & b)  // Gaussian elimination
 	if (A.m_rows != b.m_rows)
 		throw std::domain_error("System solving: sizes mismatch");
 
-	Matrix mat(A);
-	Matrix vec(b);
-
-	for (int j0 = 0; j0 < A.m_rows; ++j0) {
-		double pivot = mat[j0 * (A.m_cols + 1)];
-		int pindex   = j0;
-		for (int j = j0 + 1; j < A.m_rows; ++j) {
-			double c = mat[j * A.m_cols + j0];
-			if (std::abs(c) > std::abs(pivot)) {
-				pivot  = c;
-				pindex = j;
+	LUDecomposition lu(A);
+	if (lu.isSingular())
+		throw std::domain_error("System not solvable");
+
+	Matrix res(b.m_rows, 1);
+	std::copy(b.m_data, b.m_data + b.m_rows, res.m_data);
+	lu.solve(res.m_data);
+
+	return res;
+}
+
+
+LUDecomposition::LUDecomposition(const Matrix & A) :
+	m_size(A.rows())
+	, m_isSingular(false)
+	, m_sign(1)
+	, m_lu(A.data(), A.data() + A.columns() * A.rows())
+	, m_pivots(A.rows())
+{
+	if (A.columns() != A.rows())
+		throw std::domain_error("LU decomposition: matrix not square");
+
+	const int n = m_size;
+	double * lu = m_lu.data();
+
+	// right-looking, by panels of LUBlock columns
+	for (int k0 = 0; k0 < n; k0 += LUBlock) {
+		int k1 = std::min(k0 + LUBlock, n);
+
+		// factor the panel, swapping whole rows
+		for (int j = k0; j < k1; ++j) {
+			int pindex = j;
+			for (int i = j + 1; i < n; ++i) {
+				if (std::abs(lu[i * n + j]) > std::abs(lu[pindex * n + j]))
+					pindex = i;
+			}
+			m_pivots[j] = pindex;
+			if (pindex != j) {
+				std::swap_ranges(lu + j * n, lu + (j + 1) * n, lu + pindex * n);
+				m_sign = -m_sign;
 			}
-		}
 
-		if (pivot == 0.0f)
-			throw std::domain_error("System not solvable");
+			double pivot = lu[j * n + j];
+			if (pivot == 0.0) {
+				m_isSingular = true;
+				continue;
+			}
 
-		if (pindex != j0) {
-			for (int i = j0; i < A.m_cols; ++i) {
-				std::swap(mat[j0 * A.m_cols + i], mat[pindex * A.m_cols + i]);
+			for (int i = j + 1; i < n; ++i) {
+				double l = lu[i * n + j] /= pivot;
+				if (l == 0.0)
+					continue;
+				for (int c = j + 1; c < k1; ++c) {
+					lu[i * n + c] -= l * lu[j * n + c];
+				}
 			}
-			std::swap(vec[j0], vec[pindex]);
 		}
 
-		for (int j = j0 + 1; j < A.m_rows; ++j) {
-			if (j != j0) {
-				double k = mat[j * A.m_cols + j0] / pivot;
+		if (k1 == n)
+			break;
 
-				for (int i = 0; i < A.m_cols; ++i) {
-					mat[j * A.m_cols + i] -= k * mat[j0 * A.m_cols + i];
+		// U12 = L11^-1 A12
+		for (int j = k0; j < k1; ++j) {
+			for (int i = j + 1; i < k1; ++i) {
+				double l = lu[i * n + j];
+				for (int c = k1; c < n; ++c) {
+					lu[i * n + c] -= l * lu[j * n + c];
 				}
-				vec[j] -= k * vec[j0];
 			}
 		}
+
+		// A22 -= L21 U12
+		gemm(n - k1, n - k1, k1 - k0, -1.0, lu + k1 * n + k0, n, lu + k0 * n + k1, n, lu + k1 * n + k1, n);
 	}
+}
 
-	Matrix res(b.m_rows, 1);
 
-	res[b.m_rows - 1] = vec[b.m_rows - 1] / mat[A.m_cols * A.m_rows - 1];
+double LUDecomposition::determinant() const
+{
+	double det = m_sign;
+	for (int i = 0; i < m_size; ++i) {
+		det *= m_lu[i * m_size + i];
+	}
 
-	for (int k = b.m_rows - 2; k >= 0; --k) {
-		res[k] = vec[k];
+	return det;
+}
 
-		for (int i = k + 1; i < b.m_rows; ++i) {
-			res[k] -= mat[k * A.m_cols + i] * res[i];
-		}
 
-		res[k] /= mat[k * (A.m_cols + 1)];
+Matrix LUDecomposition::solve(const Matrix & B) const
+{
+	if (B.rows() != m_size)
+		throw std::domain_error("System solving: sizes mismatch");
+
+	Matrix X(B);
+	solve(X.data(), X.columns());
+
+	return X;
+}
+
+
+void LUDecomposition::solve(double * X, int numColumns) const
+{
+	if (m_isSingular)
+		throw std::domain_error("System not solvable");
+
+	const int n = m_size;
+	const double * lu = m_lu.data();
+
+	for (int i = 0; i < n; ++i) {
+		if (m_pivots[i] != i)
+			std::swap_ranges(X + i * numColumns, X + (i + 1) * numColumns, X + m_pivots[i] * numColumns);
 	}
 
-	return res;
+	// L Y = P B, by blocks of rows: the rows above a block go through the product kernel
+	for (int i0 = 0; i0 < n; i0 += LUBlock) {
+		int i1 = std::min(i0 + LUBlock, n);
+		gemm(i1 - i0, numColumns, i0, -1.0, lu + i0 * n, n, X, numColumns, X + i0 * numColumns, numColumns);
+		for (int i = i0 + 1; i < i1; ++i) {
+			for (int j = i0; j < i; ++j) {
+				double l = lu[i * n + j];
+				for (int c = 0; c < numColumns; ++c) {
+					X[i * numColumns + c] -= l * X[j * numColumns + c];
+				}
+			}
+		}
+	}
+
+	// U X = Y, from the last block of rows up
+	for (int i1 = n; i1 > 0; i1 -= LUBlock) {
+		int i0 = std::max(i1 - LUBlock, 0);
+		gemm(i1 - i0, numColumns, n - i1, -1.0, lu + i0 * n + i1, n, X + i1 * numColumns, numColumns, X + i0 * numColumns, numColumns);
+		for (int i = i1 - 1; i >= i0; --i) {
+			for (int j = i + 1; j < i1; ++j) {
+				double u = lu[i * n + j];
+				for (int c = 0; c < numColumns; ++c) {
+					X[i * numColumns + c] -= u * X[j * numColumns + c];
+				}
+			}
+			double pivot = lu[i * n + i];
+			for (int c = 0; c < numColumns; ++c) {
+				X[i * numColumns + c] /= pivot;
+			}
+		}
+	}
 }
 
 
@@ -505,88 +788,199 @@ std::deque<float> TridiagonalMatrix::multi_syst_solve (const std::deque<float> &
 	// Check size!!!!
 	if (l.size() != (unsigned)(nb * matrixSize))
 		return std::deque<float>(); // FIXME : should throw ?
-	std::deque<float> tmp;
-	tmp = l;
-	TridiagonalMatrix b(*this);
-	for (int i = 1; i < matrixSize; i++) {
-		for (int j = 0; j < nb; j++) {
-			tmp[nb * i + j] = tmp[nb * i + j] - tmp[nb * (i - 1) + j] * (float)(b[3 * i] / b[3 * (i - 1) + 1]);
-		}
-		b[3 * i + 1] = b[3 * i + 1] - b[3 * i] * b[3 * (i - 1) + 2] / b[3 * (i - 1) + 1];
-	}
-	for (int j = 0; j < nb; j++) {
-		tmp[nb * (matrixSize - 1) + j] = tmp[nb * (matrixSize - 1) + j] / (float)b[3 * matrixSize - 2];
-	}
 
-	for (int i = matrixSize - 2; i > -1; i--) {
-		for (int j = 0; j < nb; j++) {
-			tmp[nb * i + j] = (tmp[nb * i + j] - tmp[nb * (i + 1) + j] * (float)b[3 * i + 2]) / (float)b[3 * i + 1];
-		}
-	}
-	return tmp;
+	std::vector<float> tmp(l.begin(), l.end());
+	multi_syst_solve(tmp.data(), nb, 1);
+	return std::deque<float>(tmp.begin(), tmp.end());
 }
 
 
 std::deque<float> TridiagonalMatrix::multi_syst_solve_period (const std::deque<float> & l, int nb)
 {
-	std::deque<float> tmp, tmp_period;
 	// Check size!!!!
 	if (l.size() != (unsigned)(nb * matrixSize))
-		return tmp; // FIXME : should throw ?
+		return std::deque<float>(); // FIXME : should throw ?
 
-	// initialization of tmp
-	tmp = l;
-	// initilization of tmp_period
-	tmp_period.push_back((float)a[0]);
-	for (int i = 1; i < matrixSize - 2; ++i) {
-		tmp_period.push_back(0.0);
+	std::vector<float> tmp(l.begin(), l.end());
+	multi_syst_solve_period(tmp.data(), nb, 1);
+	return std::deque<float>(tmp.begin(), tmp.end());
+}
+
+
+namespace {
+
+// Systems below this many components are solved on the calling thread
+const int ParallelSize = 1 << 16;
+
+// Calls solve(j0, j1) on batches of the nb systems, over threadCount threads. The batches are multiples
+// of a cache line, so that the threads share at most the lines at the ends of their batches in each row
+// (the rows are not aligned on lines).
+template <typename T, typename F>
+void forEachBatch (int nb, int matrixSize, unsigned threadCount, const F & solve)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	const int lineSize = 64 / sizeof(T);
+	int batch = (nb + (int)threadCount - 1) / (int)threadCount;
+	batch = (batch + lineSize - 1) / lineSize * lineSize;
+	if (threadCount == 1 || batch >= nb || nb * matrixSize < ParallelSize) {
+		solve(0, nb);
+		return;
 	}
-	tmp_period.push_back((float)a[3 * (matrixSize - 2) + 2]);
-	tmp_period.push_back((float)a[3 * (matrixSize - 1) + 1]);
 
-	float val = (float)a[3 * matrixSize - 1];
-	TridiagonalMatrix b(*this);
-	// solve_period
-	for (int i = 1; i < matrixSize; i++) {
-		// idem non periodique
-		float coeff = (float)(b[3 * i] / b[3 * (i - 1) + 1]);
-		b[3 * i + 1] = b[3 * i + 1] - b[3 * (i - 1) + 2] * coeff;
-		for (int j = 0; j < nb; j++) {
-			tmp[i * nb + j] = tmp[i * nb + j] - tmp[nb * (i - 1) + j] * coeff;
-		}
+	std::vector<std::thread> threads;
+	for (int j0 = batch; j0 < nb; j0 += batch) {
+		threads.push_back(std::thread(solve, j0, std::min(j0 + batch, nb)));
+	}
+	solve(0, batch);
+	for (std::thread & thread : threads) {
+		thread.join();
+	}
+}
 
-		// en plus si i < matrixSize-1
-		if (i < matrixSize - 1) {
-			float coeff2 = val / (float)b[3 * (i - 1) + 1];
-			// en plus - colonne de droite de la matrice
-			tmp_period[i] = tmp_period[i] - tmp_period[i - 1] * coeff;
-			tmp_period[matrixSize - 1] = tmp_period[matrixSize - 1] - tmp_period[i - 1] * coeff2;
-			// en plus - ligne du bas de la matrice
-			val = -(float)b[3 * (i - 1) + 2] * coeff2;
-			// en plus - membre de droite
-			for (int j = 0; j < nb; j++) {
-				tmp[nb * (matrixSize - 1) + j] = tmp[nb * (matrixSize - 1) + j] - tmp[nb * (i - 1) + j] * coeff2;
+
+// Thomas algorithm: the matrix is factored once (what syst_solve does to its copy B), then the systems
+// are swept row by row, the batch of systems of a row being contiguous.
+template <typename T>
+void multiSolve (const double * a, int n, T * l, int nb, unsigned threadCount)
+{
+	if (n <= 0 || nb <= 0)
+		return;
+
+	// coeff[i]: multiple of row i - 1 taken from row i; diag: the diagonal after elimination
+	std::vector<T> coeff(n), upper(n), diag(n);
+	double previous = a[1];
+	diag[0] = (T)previous;
+	for (int i = 1; i < n; ++i) {
+		coeff[i]     = (T)(a[3 * i] / previous);
+		upper[i - 1] = (T)a[3 * (i - 1) + 2];
+		previous     = a[3 * i + 1] - a[3 * i] * a[3 * (i - 1) + 2] / previous;
+		diag[i]      = (T)previous;
+	}
+
+	forEachBatch<T>(nb, n, threadCount, [&](int j0, int j1) {
+		for (int i = 1; i < n; ++i) {
+			T * row = l + nb * i;
+			const T * prev = row - nb;
+			const T c = coeff[i];
+			for (int j = j0; j < j1; ++j) {
+				row[j] = row[j] - prev[j] * c;
 			}
-			// special case i==matrixSize-2
-			if (i == matrixSize - 2) {
-				b[3 * (matrixSize - 1)]     = b[3 * (matrixSize - 1)] + val;
-				b[3 * (matrixSize - 2) + 2] = tmp_period[matrixSize - 2];
-				b[3 * (matrixSize - 1) + 1] = tmp_period[matrixSize - 1];
+		}
+		T * last = l + nb * (n - 1);
+		for (int j = j0; j < j1; ++j) {
+			last[j] = last[j] / diag[n - 1];
+		}
+		for (int i = n - 2; i > -1; --i) {
+			T * row = l + nb * i;
+			const T * next = row + nb;
+			const T u = upper[i], d = diag[i];
+			for (int j = j0; j < j1; ++j) {
+				row[j] = (row[j] - next[j] * u) / d;
+			}
+		}
+	});
+}
+
+
+// Periodic version: the elimination of multi_syst_solve_period, with the matrix part done once
+template <typename T>
+void multiSolvePeriod (const double * a, int n, T * l, int nb, unsigned threadCount)
+{
+	if (n < 3)
+		throw std::domain_error("Periodic tridiagonal system: matrix too small");
+	if (nb <= 0)
+		return;
+
+	// right column of the matrix, as it is eliminated
+	std::vector<T> period(n, T(0));
+	period[0]     = (T)a[0];
+	period[n - 2] = (T)a[3 * (n - 2) + 2];
+	period[n - 1] = (T)a[3 * (n - 1) + 1];
+
+	std::vector<double> b(a, a + 3 * n);
+	std::vector<T> coeff(n), coeff2(n);
+	T val = (T)a[3 * n - 1];
+	for (int i = 1; i < n; ++i) {
+		coeff[i]      = (T)(b[3 * i] / b[3 * (i - 1) + 1]);
+		b[3 * i + 1] = b[3 * i + 1] - b[3 * (i - 1) + 2] * coeff[i];
+		if (i < n - 1) {
+			coeff2[i]     = val / (T)b[3 * (i - 1) + 1];
+			period[i]     = period[i] - period[i - 1] * coeff[i];
+			period[n - 1] = period[n - 1] - period[i - 1] * coeff2[i];
+			val           = -(T)b[3 * (i - 1) + 2] * coeff2[i];
+			if (i == n - 2) {
+				b[3 * (n - 1)]     = b[3 * (n - 1)] + val;
+				b[3 * (n - 2) + 2] = period[n - 2];
+				b[3 * (n - 1) + 1] = period[n - 1];
 			}
 		}
 	}
 
-	for (int j = 0; j < nb; j++) {
-		tmp[nb * (matrixSize - 1) + j] = tmp[nb * (matrixSize - 1) + j] / (float)b[3 * matrixSize - 2];
-		tmp[nb * (matrixSize - 2) + j] = (tmp[nb * (matrixSize - 2) + j] - tmp[nb * (matrixSize - 1) + j] * (float)b[3 * (matrixSize - 2) + 2]) / (float)b[3 * (matrixSize - 2) + 1];
+	std::vector<T> upper(n), diag(n);
+	for (int i = 0; i < n; ++i) {
+		upper[i] = (T)b[3 * i + 2];
+		diag[i]  = (T)b[3 * i + 1];
 	}
 
-	for (int i = matrixSize - 3; i > -1; i--) {
-		for (int j = 0; j < nb; j++) {
-			tmp[nb * i + j] = (tmp[nb * i + j] - tmp[nb * (i + 1) + j] * (float)b[3 * i + 2] - tmp[nb * (matrixSize - 1) + j] * tmp_period[i]) / (float)b[3 * i + 1];
+	forEachBatch<T>(nb, n, threadCount, [&](int j0, int j1) {
+		T * last = l + nb * (n - 1);
+		for (int i = 1; i < n; ++i) {
+			T * row = l + nb * i;
+			const T * prev = row - nb;
+			const T c = coeff[i];
+			for (int j = j0; j < j1; ++j) {
+				row[j] = row[j] - prev[j] * c;
+			}
+			if (i < n - 1) {
+				const T c2 = coeff2[i];
+				for (int j = j0; j < j1; ++j) {
+					last[j] = last[j] - prev[j] * c2;
+				}
+			}
 		}
-	}
-	return tmp;
+
+		T * beforeLast = last - nb;
+		for (int j = j0; j < j1; ++j) {
+			last[j]       = last[j] / diag[n - 1];
+			beforeLast[j] = (beforeLast[j] - last[j] * upper[n - 2]) / diag[n - 2];
+		}
+		for (int i = n - 3; i > -1; --i) {
+			T * row = l + nb * i;
+			const T * next = row + nb;
+			const T u = upper[i], d = diag[i], p = period[i];
+			for (int j = j0; j < j1; ++j) {
+				row[j] = (row[j] - next[j] * u - last[j] * p) / d;
+			}
+		}
+	});
+}
+
+}  // namespace
+
+
+void TridiagonalMatrix::multi_syst_solve (float * l, int nb, unsigned threadCount) const
+{
+	multiSolve(a, matrixSize, l, nb, threadCount);
+}
+
+
+void TridiagonalMatrix::multi_syst_solve (double * l, int nb, unsigned threadCount) const
+{
+	multiSolve(a, matrixSize, l, nb, threadCount);
+}
+
+
+void TridiagonalMatrix::multi_syst_solve_period (float * l, int nb, unsigned threadCount) const
+{
+	multiSolvePeriod(a, matrixSize, l, nb, threadCount);
+}
+
+
+void TridiagonalMatrix::multi_syst_solve_period (double * l, int nb, unsigned threadCount) const
+{
+	multiSolvePeriod(a, matrixSize, l, nb, threadCount);
 }
 
 
@@ -10,6 +10,7 @@
 #endif
 #include <algorithm>
 #include <deque>
+#include <vector>
 
 namespace core {
 
@@ -80,12 +81,18 @@ public:
 	/// Copy constructor.
 	Matrix(const Matrix &);
 
+	/// Move constructor. Takes the components of the other matrix, which is left empty (0 x 0).
+	Matrix(Matrix &&);
+
 	/// Destructor. Nothing special.
 	~Matrix();
 
-	/// Assignment operator.
+	/// Assignment operator. Reuses the components of this matrix if it has the same size.
 	Matrix & operator= (const Matrix & other);
 
+	/// Move assignment operator. Takes the components of the other matrix, which is left empty (0 x 0).
+	Matrix & operator= (Matrix && other);
+
 	/// Set all components of the matrix to 0.
 	Matrix & nullify();
 
@@ -113,11 +120,25 @@ public:
 	int rows() const
 	{ return m_rows; }
 
+	/// Returns the components of the matrix, row by row.
+	const double * data() const
+	{ return m_data; }
+
+	/// Returns the components of the matrix, row by row, with read/write access.
+	double * data()
+	{ return m_data; }
+
 	/// Transpose the current matrix.
-	Matrix transpose() const;
+	Matrix transpose() const &;
+
+	/// Transpose the current matrix, in place: no allocation unless it is neither square nor a vector.
+	Matrix transpose() &&;
 
 	/// Inverse the current matrix.
-	Matrix inverse() const;
+	Matrix inverse() const &;
+
+	/// Inverse the current matrix, into its own components.
+	Matrix inverse() &&;
 
 	/// Addition operator.
 	Matrix & operator+= (const Matrix &);
@@ -128,6 +149,9 @@ public:
 	/// Product operator.
 	friend TGCORE_API Matrix operator* (const Matrix & lhs, const Matrix & rhs);
 
+	/// Product into out, reusing its components if it already has the size of the product.
+	friend TGCORE_API void multiplyInto (Matrix & out, const Matrix & lhs, const Matrix & rhs);
+
 	/// ! @cond EXCLUDE_FROM_PLUGINS_SDK
 	friend TGCORE_API Matrix solve (const Matrix & lhs, const Matrix & rhs);
 
@@ -137,6 +161,9 @@ private:
 	// Matrix(int dim, const double* elems);
 	void init();
 
+	/// Sets the size, reallocating only if the number of components changes. The components are not initialized.
+	void setSize(int cols_, int rows_);
+
 	bool     m_own;
 	int      m_cols, m_rows;
 	double * m_data;
@@ -165,11 +192,66 @@ private:
 /// Product operator.
 TGCORE_API Matrix operator* (const Matrix & lhs, const Matrix & rhs);
 
+/**
+ * Product into caller-owned storage: out = lhs * rhs, without allocating when out already has the size
+ * of the product, e.g. when called again in a loop. out may be lhs or rhs.
+ */
+TGCORE_API void multiplyInto (Matrix & out, const Matrix & lhs, const Matrix & rhs);
+
 /// ! @cond EXCLUDE_FROM_PLUGINS_SDK
 TGCORE_API Matrix solve (const Matrix & A, const Matrix & b);
 
 /// ! @endcond
 
+
+/**
+ * @brief LU factorization with partial pivoting of a square matrix: P A = L U.
+ *
+ * Factor once, then solve for as many right-hand sides as needed, each in O(n^2).
+ * Large matrices are factored by blocks, the updates going through the same kernel as the product.
+ */
+class TGCORE_API LUDecomposition
+{
+public:
+	/**
+	 * Factors A.
+	 * @param A the square matrix to factor. Throws std::domain_error if it is not square.
+	 */
+	explicit LUDecomposition(const Matrix & A);
+
+	/// Returns the dimension of the factored matrix.
+	int size() const
+	{ return m_size; }
+
+	/// Whether a pivot is zero: A is not invertible, and solve() throws.
+	bool isSingular() const
+	{ return m_isSingular; }
+
+	/// Returns the determinant of A.
+	double determinant() const;
+
+	/**
+	 * Solves A X = B.
+	 * @param B the right-hand sides, one per column, with as many rows as A.
+	 * @return X, of the same size as B.
+	 */
+	Matrix solve(const Matrix & B) const;
+
+	/**
+	 * Solves A X = B in place.
+	 * @param X the right-hand sides on input, the solutions on output: size() rows of numColumns components.
+	 * @param numColumns the number of right-hand sides.
+	 */
+	void solve(double * X, int numColumns = 1) const;
+
+private:
+	int                 m_size;
+	bool                m_isSingular;
+	int                 m_sign;       ///< Sign of the permutation.
+	std::vector<double> m_lu;         ///< L below the diagonal (unit diagonal omitted), U above, row by row.
+	std::vector<int>    m_pivots;     ///< Row swapped with row i at step i.
+};
+
 /** @cond EXCLUDE_FROM_PLUGINS_SDK */
 
 /**
@@ -243,6 +325,26 @@ public:
 	 */
 	std::deque<float> multi_syst_solve_period (const std::deque<float> & l, int nb);
 
+	/**
+	 * Solves a*X = l for nb right-hand sides at once, in place, with the layout of the deque version:
+	 * l[nb * i + j] is the component i of the system j.
+	 * The matrix is factored once; the systems are then swept together, contiguous in memory, in batches
+	 * spread over threadCount threads (0: all cores, for large enough problems).
+	 */
+	void multi_syst_solve (float * l, int nb, unsigned threadCount = 0) const;
+
+	/// Same as above, in double precision.
+	void multi_syst_solve (double * l, int nb, unsigned threadCount = 0) const;
+
+	/**
+	 * Periodic version of the above, in place, for a matrix of size 3 or more.
+	 * Throws std::domain_error if the matrix is smaller.
+	 */
+	void multi_syst_solve_period (float * l, int nb, unsigned threadCount = 0) const;
+
+	/// Same as above, in double precision.
+	void multi_syst_solve_period (double * l, int nb, unsigned threadCount = 0) const;
+
 private:
 	///< A contains the non null values of a tridiagonal matrix of  matrixSize lines
 	///< Be carrefull : the first element of A is the top right corner and the last is the bottom left corner of matrix, == 0 if the matrix is really tridiagonal
@@ -7,30 +7,391 @@
 #include "Segment.h"
 #include "../Tools.h"
 #include "Trihedron.h"
+#include "FrameTransform.h"
 //#include <wx/xml/xml.h>
 #include <fstream>
+#include <cmath>
+#include <set>
+#include <utility>
 //#include "../Logger/LogManager.h"
 
 namespace core {
 
-Polygon::Polygon(int n)
+namespace {
+
+/** Returns the vertices without the ones which belong to the segment [previous, next]. */
+Polygon::Vertices withoutAlignedVertices (const Polygon::Vertices & vertices, double epsilon)
+{
+	Polygon::Vertices result;
+	result.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		const Point3 & prev = (i == 0) ? vertices.back() : vertices[i - 1];
+		const Point3 & next = (i + 1 == vertices.size()) ? vertices.front() : vertices[i + 1];
+		core::Segment s(prev, next);
+		if (! s.includes(vertices[i], epsilon))
+			result.push_back(vertices[i]);
+	}
+	return result;
+}
+
+
+/** A vertex of the polygon to triangulate, in its plane. */
+struct Point2D
+{
+	double x, y;
+};
+
+
+// True if the sweep line, going down, meets a before b: higher, or as high and on the left
+inline bool isAbove (const Point2D & a, const Point2D & b)
+{
+	return a.y > b.y || (a.y == b.y && a.x < b.x);
+}
+
+
+// Positive if o, a, b turn counterclockwise
+inline double cross (const Point2D & o, const Point2D & a, const Point2D & b)
+{
+	return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+
+/**
+ * The diagonals which split a counterclockwise simple polygon in y-monotone pieces, with
+ * a sweep line going down (de Berg et al., Computational Geometry, chapter 3).
+ * Edge i goes from vertex i to vertex i + 1. The sweep keeps, ordered from left to right,
+ * the edges which it crosses and which have the polygon on their right, each with its
+ * helper: the last vertex seen between it and the next edge on its right.
+ */
+class MonotonePartition
 {
+public:
+	explicit MonotonePartition(const std::vector<Point2D> & points)
+		: p(points), n(int(points.size())), sweepX(0), sweepY(0), status(EdgeOrder(this)),
+		helper(points.size(), -1), position(points.size())
+	{
+	}
+
+	std::vector<std::pair<int, int> > diagonals()
+	{
+		std::vector<int> events(n);
+		for (int i = 0; i < n; ++i)
+			events[i] = i;
+		std::sort(events.begin(), events.end(), [this](int a, int b) { return isAbove(p[a], p[b]); });
+
+		for (int v : events) {
+			sweepX = p[v].x;
+			sweepY = p[v].y;
+			const int prev = (v + n - 1) % n;
+			const bool prevBelow = isAbove(p[v], p[prev]), nextBelow = isAbove(p[v], p[(v + 1) % n]);
+			const bool convex = cross(p[prev], p[v], p[(v + 1) % n]) > 0;
+			if (prevBelow && nextBelow) {
+				if (! convex) {                      // split vertex: joined to the helper on its left
+					const int left = leftEdge();
+					if (left >= 0) {
+						result.push_back(std::make_pair(v, helper[left]));
+						helper[left] = v;
+					}
+				}
+				insert(v);                           // start vertex, or split vertex
+			} else if (! prevBelow && ! nextBelow) {
+				close(prev, v);                      // end vertex, or merge vertex
+				if (! convex)
+					updateLeft(v);
+			} else if (! prevBelow) {
+				close(prev, v);                      // on the left chain: the polygon is on its right
+				insert(v);
+			} else
+				updateLeft(v);                       // on the right chain
+		}
+		return result;
+	}
+
+private:
+	struct EdgeOrder
+	{
+		explicit EdgeOrder(const MonotonePartition * partition) : partition(partition) { }
+
+		bool operator() (int a, int b) const
+		{
+			const double xa = partition->xAt(a), xb = partition->xAt(b);
+			return xa < xb || (xa == xb && a < b);
+		}
+
+		const MonotonePartition * partition;
+	};
+
+	// x of edge e on the sweep line, or of the current vertex for e = -1
+	double xAt (int e) const
+	{
+		if (e < 0)
+			return sweepX;
+		const Point2D & a = p[e];
+		const Point2D & b = p[(e + 1) % n];
+		if (a.y == b.y)
+			return std::max(std::min(a.x, b.x), std::min(std::max(a.x, b.x), sweepX));
+		return a.x + (sweepY - a.y) * (b.x - a.x) / (b.y - a.y);
+	}
+
+	bool isMerge (int v) const
+	{
+		const int prev = (v + n - 1) % n, next = (v + 1) % n;
+		return isAbove(p[prev], p[v]) && isAbove(p[next], p[v]) && cross(p[prev], p[v], p[next]) <= 0;
+	}
+
+	void insert (int v)
+	{
+		position[v] = status.insert(v).first;
+		helper[v]   = v;
+	}
+
+	// The edge which ends at v leaves the sweep, joined to its helper if it is a merge vertex
+	void close (int e, int v)
+	{
+		if (helper[e] < 0)
+			return;
+		if (isMerge(helper[e]))
+			result.push_back(std::make_pair(v, helper[e]));
+		status.erase(position[e]);
+		helper[e] = -1;
+	}
+
+	// v becomes the helper of the edge on its left, joined to the previous one if it is a merge vertex
+	void updateLeft (int v)
+	{
+		const int left = leftEdge();
+		if (left < 0)
+			return;
+		if (isMerge(helper[left]))
+			result.push_back(std::make_pair(v, helper[left]));
+		helper[left] = v;
+	}
+
+	// The edge directly on the left of the current vertex, -1 if none (not a simple polygon)
+	int leftEdge () const
+	{
+		std::set<int, EdgeOrder>::const_iterator it = status.lower_bound(-1);
+		if (it == status.begin())
+			return -1;
+		return *--it;
+	}
+
+	const std::vector<Point2D> & p;
+	const int n;
+	double sweepX, sweepY;
+	std::set<int, EdgeOrder> status;
+	std::vector<int> helper;                          // of the edges in the status, -1 for the others
+	std::vector<std::set<int, EdgeOrder>::iterator> position;
+	std::vector<std::pair<int, int> > result;
+};
+
+
+/**
+ * Splits a counterclockwise polygon along diagonals which do not cross: returns the
+ * pieces, as their vertices, counterclockwise. Each vertex sorts its neighbours by angle;
+ * a piece turns, at each of its vertices, to the next neighbour clockwise.
+ */
+std::vector<std::vector<int> > splitPolygon (const std::vector<Point2D> & p, const std::vector<std::pair<int, int> > & diagonals)
+{
+	const int n = int(p.size());
+	std::vector<std::vector<int> > neighbours(n);
 	for (int i = 0; i < n; ++i) {
-		vertices.push_back(Point3());
+		neighbours[i].push_back((i + n - 1) % n);
+		neighbours[i].push_back((i + 1) % n);
+	}
+	for (const std::pair<int, int> & d : diagonals) {
+		neighbours[d.first].push_back(d.second);
+		neighbours[d.second].push_back(d.first);
 	}
+
+	// the half-edges out of the polygon, towards the previous vertex, are already used
+	std::vector<std::vector<bool> > used(n);
+	for (int i = 0; i < n; ++i) {
+		std::vector<int> & around = neighbours[i];
+		std::vector<double> angle(around.size());
+		std::vector<int> order(around.size());
+		for (size_t k = 0; k < around.size(); ++k) {
+			angle[k] = std::atan2(p[around[k]].y - p[i].y, p[around[k]].x - p[i].x);
+			order[k] = int(k);
+		}
+		std::sort(order.begin(), order.end(), [&angle](int a, int b) { return angle[a] < angle[b]; });
+		std::vector<int> sorted(around.size());
+		for (size_t k = 0; k < around.size(); ++k)
+			sorted[k] = around[order[k]];
+		around.swap(sorted);
+		used[i].resize(around.size());
+		for (size_t k = 0; k < around.size(); ++k)
+			used[i][k] = around[k] == (i + n - 1) % n;
+	}
+
+	std::vector<std::vector<int> > pieces;
+	for (int start = 0; start < n; ++start) {
+		for (size_t k0 = 0; k0 < neighbours[start].size(); ++k0) {
+			if (used[start][k0])
+				continue;
+			std::vector<int> piece;
+			int u = start;
+			size_t k = k0;
+			while (! used[u][k]) {
+				used[u][k] = true;
+				piece.push_back(u);
+				const int v = neighbours[u][k];
+				const std::vector<int> & around = neighbours[v];
+				const size_t back = std::find(around.begin(), around.end(), u) - around.begin();
+				k = (back + around.size() - 1) % around.size();
+				u = v;
+			}
+			pieces.push_back(piece);
+		}
+	}
+	return pieces;
 }
 
 
-Polygon::Polygon(const Vertices & pts)
+// Adds the triangle a, b, c, counterclockwise
+inline void addTriangle (const std::vector<Point2D> & p, int a, int b, int c, std::vector<int> & triangles)
 {
-	vertices.clear();
-	for (Vertices::const_iterator it = pts.begin(); it != pts.end(); ++it) {
-		vertices.push_back(*it);
+	if (cross(p[a], p[b], p[c]) < 0)
+		std::swap(b, c);
+	triangles.push_back(a);
+	triangles.push_back(b);
+	triangles.push_back(c);
+}
+
+
+/**
+ * Triangulates a y-monotone counterclockwise polygon in linear time, once sorted: the
+ * vertices from the top down, with a stack of the ones which still miss triangles
+ * (de Berg et al., Computational Geometry, chapter 3).
+ */
+void triangulateMonotone (const std::vector<Point2D> & p, const std::vector<int> & piece, std::vector<int> & triangles)
+{
+	const int m = int(piece.size());
+	if (m < 3)
+		return;
+	int top = 0, bottom = 0;
+	for (int k = 1; k < m; ++k) {
+		if (isAbove(p[piece[k]], p[piece[top]]))
+			top = k;
+		if (isAbove(p[piece[bottom]], p[piece[k]]))
+			bottom = k;
+	}
+
+	// counterclockwise, the left chain goes down from the top
+	std::vector<std::pair<int, bool> > u;    // vertex, on the left chain
+	u.reserve(m);
+	for (int k = top; k != bottom; k = (k + 1) % m)
+		u.push_back(std::make_pair(piece[k], true));
+	for (int k = bottom; k != top; k = (k + 1) % m)
+		u.push_back(std::make_pair(piece[k], false));
+	std::sort(u.begin(), u.end(), [&p](const std::pair<int, bool> & a, const std::pair<int, bool> & b) {
+		return isAbove(p[a.first], p[b.first]);
+	});
+
+	std::vector<std::pair<int, bool> > stack;
+	stack.push_back(u[0]);
+	stack.push_back(u[1]);
+	for (int j = 2; j < m - 1; ++j) {
+		if (u[j].second != stack.back().second) {
+			// on the other chain: it sees all the stack
+			while (stack.size() > 1) {
+				const int t = stack.back().first;
+				stack.pop_back();
+				addTriangle(p, u[j].first, t, stack.back().first, triangles);
+			}
+			stack.clear();
+			stack.push_back(u[j - 1]);
+			stack.push_back(u[j]);
+		} else {
+			// on the same chain: it sees the stack while the diagonals are in the polygon
+			std::pair<int, bool> last = stack.back();
+			stack.pop_back();
+			while (! stack.empty()) {
+				const double turn = cross(p[u[j].first], p[last.first], p[stack.back().first]);
+				if (u[j].second ? turn >= 0 : turn <= 0)
+					break;
+				addTriangle(p, u[j].first, last.first, stack.back().first, triangles);
+				last = stack.back();
+				stack.pop_back();
+			}
+			stack.push_back(last);
+			stack.push_back(u[j]);
+		}
+	}
+	// the bottom sees all the stack
+	const int last = u[m - 1].first;
+	while (stack.size() > 1) {
+		const int t = stack.back().first;
+		stack.pop_back();
+		addTriangle(p, last, t, stack.back().first, triangles);
+	}
+}
+
+
+/**
+ * Triangulates a simple polygon: returns three indices of points per triangle, turning as
+ * the polygon. The points are projected along the main axis of the normal of Newell; a
+ * clockwise polygon is mirrored, which turns it counterclockwise with the same indices.
+ */
+std::vector<int> triangulateIndices (const Polygon::Vertices & points)
+{
+	std::vector<int> triangles;
+	const int n = int(points.size());
+	if (n < 3)
+		return triangles;
+
+	Vector3 normal;
+	for (int i = 0; i < n; ++i) {
+		const Point3 & a = points[i];
+		const Point3 & b = points[(i + 1) % n];
+		normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+		normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+		normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+	}
+	int coordToIgnore = 2;
+	if (std::abs(normal[0]) > std::abs(normal[1]) && std::abs(normal[0]) > std::abs(normal[2]))
+		coordToIgnore = 0;
+	else if (std::abs(normal[1]) > std::abs(normal[2]))
+		coordToIgnore = 1;
+	const int ix = (coordToIgnore + 1) % 3, iy = (coordToIgnore + 2) % 3;
+	const double mirror = (normal[coordToIgnore] < 0) ? -1 : 1;
+
+	std::vector<Point2D> p(n);
+	for (int i = 0; i < n; ++i) {
+		p[i].x = mirror * points[i][ix];
+		p[i].y = points[i][iy];
 	}
+
+	triangles.reserve(3 * (n - 2));
+	const std::vector<std::vector<int> > pieces = splitPolygon(p, MonotonePartition(p).diagonals());
+	for (const std::vector<int> & piece : pieces)
+		triangulateMonotone(p, piece, triangles);
+	return triangles;
+}
+
+}  // namespace
+
+
+Polygon::Polygon(int n)
+	: vertices(n > 0 ? n : 0), projectionValid(false)
+{
+}
+
+
+Polygon::Polygon(const Vertices & pts)
+	: vertices(pts), projectionValid(false)
+{
+}
+
+
+Polygon::Polygon(const std::list<Point3> & pts)
+	: vertices(pts.begin(), pts.end()), projectionValid(false)
+{
 }
 
 
 Polygon::Polygon(const EllipseBoundingBox & ellipse, int nSeg)
+	: projectionValid(false)
 {
 
 	Point3 center = Vector3(ellipse.upperLeft + ellipse.lowerRigth) / 2.0f;
@@ -48,27 +409,26 @@ Polygon::Polygon(const EllipseBoundingBox & ellipse, int nSeg)
 	Point3 newUL  = trihedron.xformFrom(core::Trihedron(), ellipse.upperLeft);
 	Point3 newLR  = trihedron.xformFrom(core::Trihedron(), ellipse.lowerRigth);
 
-	float radiusA = abs((newUL[0] - newLR[0]) / 2.0f);
-	float radiusB = abs((newUL[1] - newLR[1]) / 2.0f);
+	float radiusA = std::abs((newUL[0] - newLR[0]) / 2.0f);
+	float radiusB = std::abs((newUL[1] - newLR[1]) / 2.0f);
 	if (radiusA == 0 || radiusB == 0)
 		return; // empty polygon
 
 
 	// compute coord and transform the result on the ellipse trihedron
+	const core::FrameTransform toAbsolute(trihedron, core::Trihedron());
+	vertices.reserve(nSeg);
 	for (int i = 0; i < nSeg; ++i) {
 		float x = radiusA * sin((double(i) / double(nSeg)) * (IGT_PI * 2.0));
 		float y = radiusB * cos((double(i) / double(nSeg)) * (IGT_PI * 2.0));
-		vertices.push_back(trihedron.xformTo(core::Trihedron(), Point3(x, y, 0.0f)));
+		vertices.push_back(toAbsolute.xform(Point3(x, y, 0.0f)));
 	}
 }
 
 
 Polygon::Polygon(const Polygon & other)
+	: vertices(other.vertices), projectionValid(false)
 {
-	vertices.clear();
-	for (Vertices::const_iterator it = other.vertices.begin(); it != other.vertices.end(); ++it) {
-		vertices.push_back(*it);
-	}
 }
 
 
@@ -76,10 +436,8 @@ Polygon & Polygon::operator= (const Polygon & other)
 {
 	if (this == &other)
 		return *this;
-	vertices.clear();
-	for (Vertices::const_iterator it = other.vertices.begin(); it != other.vertices.end(); ++it) {
-		vertices.push_back(*it);
-	}
+	vertices = other.vertices;
+	invalidateProjection();
 	return *this;
 }
 
@@ -90,39 +448,23 @@ void Polygon::resize (int n)
 		vertices.clear();
 	else
 		vertices.resize(n);
+	invalidateProjection();
 }
 
 
 float Polygon::getArea() const
 {
-	// Use vector here, easier for random acces
-	std::vector<Point3> verticesOrdered;
-	for (Vertices::const_iterator it = vertices.begin(); it != vertices.end(); ++it) {
-		verticesOrdered.push_back(*it);
-	}
 	////Stokes
 	float surface           = 0.0;
-	unsigned int nbVertices = (unsigned int)(verticesOrdered.size());
-	float * DX = new float[nbVertices];
-	float * DY = new float[nbVertices];
+	unsigned int nbVertices = (unsigned int)(vertices.size());
 	for (unsigned int i = 0; i < nbVertices; ++i) {
-		unsigned int a = (i + 1) % nbVertices;
-		unsigned int b = (i + nbVertices - 1) % nbVertices;
-		if (a > nbVertices || b > nbVertices) {  // Shoult not be here
-			DX[i] = 0;
-			DY[i] = 0;
-			continue;
-		}
-		DX[i] = (verticesOrdered[a][0] - verticesOrdered[b][0]) / 2;
-		DY[i] = (verticesOrdered[a][1] - verticesOrdered[b][1]) / 2;
-	}
-
-	for (unsigned int j = 0; j < nbVertices; ++j) {
-		surface += (verticesOrdered[j][0] * DY[j] - verticesOrdered[j][1] * DX[j]);
+		const Point3 & a = vertices[(i + 1) % nbVertices];
+		const Point3 & b = vertices[(i + nbVertices - 1) % nbVertices];
+		float DX = float((a[0] - b[0]) / 2);
+		float DY = float((a[1] - b[1]) / 2);
+		surface += (vertices[i][0] * DY - vertices[i][1] * DX);
 	}
-	delete[] DX;
-	delete[] DY;
-	return abs(surface / 2);
+	return std::abs(surface / 2);
 }
 
 
@@ -131,19 +473,10 @@ float Polygon::getPerimeter() const
 	float perimeter = 0.0f;
 	if (vertices.size() < 3) // not a polygon
 		return 0.0f;
-	for (Vertices::const_iterator it = vertices.begin(); it != vertices.end();) {
-		Point3 p = *it;
-		++it;
-		if (it == vertices.end()) {
-			Point3 firstVertex = *(vertices.begin());
-			Vector3 v          = firstVertex - p;
-			perimeter += v.length();
-			break;
-		} else {
-			Point3 NextV = *it;
-			Vector3 v    = NextV - p;
-			perimeter += v.length();
-		}
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		const Point3 & next = (i + 1 == vertices.size()) ? vertices.front() : vertices[i + 1];
+		Vector3 v = next - vertices[i];
+		perimeter += v.length();
 	}
 	return perimeter;
 }
@@ -155,104 +488,94 @@ float isLeft (std::pair<Point3, Point3> segment, Point3 p)
 }
 
 
-bool Polygon::isIn (const Point3 & p) const
+Point3 Polygon::project (const Point3 & p, int coordToIgnore)
 {
-	if (vertices.size() < 3)
-		return false;
-	if (isInPolygonVertices(p))
-		return true;
-	int wn = 0;
+	if (coordToIgnore == 0)
+		return Point3(p[1], p[2], 0.0f);
+	if (coordToIgnore == 1)
+		return Point3(p[0], p[2], 0.0f);
+	return Point3(p[0], p[1], 0.0f);
+}
 
-	std::list<Point3>::const_iterator itPt = vertices.begin();
-	Point3 origin = *itPt;
-	++itPt;
-	Point3 p1     = *itPt;
-	++itPt;
-	Point3 p2     = *itPt;
-	Vector3 v1(p1 - origin);
-	Vector3 v2(p2 - origin);
-	core::Segment s1(p1, origin);
-	core::Segment s2(p2, origin);
 
-	while (s1.isParallel(s2)) {  // find the 2 vector wich are not parrallel to compute normal
-		++itPt;
+const Polygon::Projection & Polygon::getProjection() const
+{
+	if (projectionValid.load(std::memory_order_acquire))
+		return projection;
+	std::lock_guard<std::mutex> lock(projectionMutex);
+	if (projectionValid.load(std::memory_order_relaxed))
+		return projection;
+
+	// needs 3 vertices at least, isIn checks before
+	Projection & pr = projection;
+	pr.origin = vertices[0];
+	pr.p1     = vertices[1];
+	pr.p2     = vertices[2];
+	size_t third = 2;
+	Vector3 v1(pr.p1 - pr.origin);
+	Vector3 v2(pr.p2 - pr.origin);
+	core::Segment s1(pr.p1, pr.origin);
+	core::Segment s2(pr.p2, pr.origin);
 
-		if (itPt == vertices.end()) {
+	while (s1.isParallel(s2)) {  // find the 2 vector wich are not parrallel to compute normal
+		++third;
+		if (third == vertices.size()) {
 			// here all points are on the same line
 			break;
 		} else {
-			Point3 thirdVertex = *itPt;
-			s2 = core::Segment(thirdVertex, origin);
-			v2 = Vector3(thirdVertex - origin);
+			Point3 thirdVertex = vertices[third];
+			s2 = core::Segment(thirdVertex, pr.origin);
+			v2 = Vector3(thirdVertex - pr.origin);
 		}
-
 	}
 
 	Vector3 normale = v1 ^ v2;
-	if (normale == Point3()) {  // polygon line(v1 and v2 are parallel)
+	pr.isLine = (normale == Point3());  // polygon line(v1 and v2 are parallel)
+	pr.projected.clear();
+	if (! pr.isLine) {
+		pr.normal = normale.normalise();
+		pr.plane  = core::Plane(pr.normal, pr.origin);
+
+		// projection of the plane, on the 2D plane the nearest
+		pr.coordToIgnore = (std::abs(normale[0]) <= std::abs(normale[1])) ? 1 : 0;
+		if (std::abs(normale[pr.coordToIgnore]) <= std::abs(normale[2]))
+			pr.coordToIgnore = 2;
+
+		pr.projected.reserve(vertices.size());
+		for (const Point3 & v : vertices)
+			pr.projected.push_back(project(v, pr.coordToIgnore));
+	}
+	projectionValid.store(true, std::memory_order_release);
+	return projection;
+}
+
+
+bool Polygon::isIn (const Point3 & p) const
+{
+	if (vertices.size() < 3)
+		return false;
+	if (isInPolygonVertices(p))
+		return true;
+	int wn = 0;
+
+	const Projection & pr = getProjection();
+	if (pr.isLine) {
 		// FIXME : take the segment the longer, not v1 and v2
-		if (! Segment(origin, p1).includes(p) && ! Segment(origin, p2).includes(p))
+		if (! Segment(pr.origin, pr.p1).includes(p) && ! Segment(pr.origin, pr.p2).includes(p))
 			return false;
 		else
 			return true;
 	}
-	core::Plane polygonPlane(normale.normalise(), origin);
-	if (! polygonPlane.includes(p))
+	if (! pr.plane.includes(p))
 		return false;                           // important, test before projection
 
-	// projection of the plane and the point, on the 2D plane the nearest
-	int coordToIgnore = (abs(normale[0]) <= abs(normale[1])) ? 1 : 0;
-	if (abs(normale[coordToIgnore]) <= abs(normale[2]))
-		coordToIgnore = 2;
-
-	Point3 newP;  // projection of p on plan
-	if (coordToIgnore == 0)
-		newP = Point3(p[1], p[2], 0.0f);
-	if (coordToIgnore == 1)
-		newP = Point3(p[0], p[2], 0.0f);
-	if (coordToIgnore == 2)
-		newP = Point3(p[0], p[1], 0.0f);
-
-	std::list<Point3> newVertices;  // vertices Projected
-	for (std::list<Point3>::const_iterator it2 = vertices.begin(); it2 != vertices.end(); ++it2) {
-		Point3 newVertex;
-		if (coordToIgnore == 0)
-			newVertex = Point3((*it2)[1], (*it2)[2], 0.0f);
-		if (coordToIgnore == 1)
-			newVertex = Point3((*it2)[0], (*it2)[2], 0.0f);
-		if (coordToIgnore == 2)
-			newVertex = Point3((*it2)[0], (*it2)[1], 0.0f);
-		newVertices.push_back(newVertex);
-	}
-
-	/////////////////////////////////
-	// Method of change frame (too expensive)
-
-	// Vector3 v2Perp = normale^v1;//perpendicular to v1
-	// core::Trihedron polygonTrihedron (origin, v1.normalise(), v2Perp.normalise(),normale.normalise());
-	// core::Trihedron base;
-
-	// Point3 newP = base.xformTo(polygonTrihedron, p);
-	// if (newP[2] != 0) return false;
-
-	// std::list<Point3> newVertices;//vertices in polygon plan
-	// for (std::list<Point3>::const_iterator it2 = vertices.begin(); it2 != vertices.end(); ++it2)
-	// {
-	//	newVertices.push_back(base.xformTo(polygonTrihedron, *it2));
-	// }
-	///////////////////////////////////
-
+	Point3 newP = project(p, pr.coordToIgnore);  // projection of p on plan
 
 	//// loop through all edges of the polygon
-	for (Vertices::const_iterator it3 = newVertices.begin(); it3 != newVertices.end();) {
-		Point3 current = *it3;
-		++it3;
-		Point3 next;
-		if (it3 == newVertices.end())
-			next = *(newVertices.begin());
-		else {
-			next = *it3;
-		}
+	const Vertices & newVertices = pr.projected;
+	for (size_t i = 0; i < newVertices.size(); ++i) {
+		const Point3 & current = newVertices[i];
+		const Point3 & next    = (i + 1 == newVertices.size()) ? newVertices.front() : newVertices[i + 1];
 		Segment s(current, next);
 		if (s.includes(newP) || (newP.isClose(current)) || (newP.isClose(next)))
 			return true;
@@ -276,16 +599,80 @@ bool Polygon::isIn (const Point3 & p) const
 
 bool Polygon::isIn (const Segment & s) const
 {
-	const int NBPOINTS = 50;
-	for (float t = 0; t < 1; t += 1 / float(NBPOINTS)) {
-		Point3 p = (1 - t) * s.from() + t * s.to();
-		if (! isIn(p))
+	// the ends in the polygon, so in its plane, as all the segment
+	if (! isIn(s.from()) || ! isIn(s.to()))
+		return false;
+	const Projection & pr = getProjection();
+	if (pr.isLine)
+		return true;  // all the vertices on a line: the polygon is a segment
+
+	const Point3 a = project(s.from(), pr.coordToIgnore), b = project(s.to(), pr.coordToIgnore);
+	const size_t n = pr.projected.size();
+	std::vector<double> cuts(1, 0.0);
+	for (size_t i = 0; i < n; ++i)
+		addCuts(a, b, pr.projected[i], pr.projected[(i + 1) % n], cuts);
+	cuts.push_back(1.0);
+	std::sort(cuts.begin(), cuts.end());
+
+	// The crossings of the edges with the line of the segment give the winding number all along it: up to
+	// the sign, the sum of the crossings before t. A vertex on the line counts as on its right, so that an
+	// edge which only touches the line crosses it twice or not at all.
+	const double abx = b[0] - a[0], aby = b[1] - a[1], length2 = abx * abx + aby * aby;
+	std::vector<std::pair<double, int> > crossings;
+	for (size_t i = 0; i < n && length2 > 0; ++i) {
+		const Point3 & c = pr.projected[i];
+		const Point3 & d = pr.projected[(i + 1) % n];
+		const double sc = abx * (c[1] - a[1]) - aby * (c[0] - a[0]);
+		const double sd = abx * (d[1] - a[1]) - aby * (d[0] - a[0]);
+		if ((sc > 0) != (sd > 0)) {
+			const double u = sc / (sc - sd);
+			const double x = c[0] + u * (d[0] - c[0]) - a[0], y = c[1] + u * (d[1] - c[1]) - a[1];
+			crossings.push_back(std::make_pair((x * abx + y * aby) / length2, sc > 0 ? 1 : -1));
+		}
+	}
+	std::sort(crossings.begin(), crossings.end());
+
+	// each piece between two cuts is all in or all out, as its middle: in if it winds, otherwise only if
+	// it runs along an edge, which the point test tells
+	size_t next = 0;
+	int winding = 0;
+	for (size_t k = 0; k + 1 < cuts.size(); ++k) {
+		if (cuts[k + 1] <= cuts[k])
+			continue;
+		const double t = 0.5 * (cuts[k] + cuts[k + 1]);
+		for (; next < crossings.size() && crossings[next].first <= t; ++next)
+			winding += crossings[next].second;
+		if (winding == 0 && ! isIn((1 - t) * s.from() + t * s.to()))
 			return false;
 	}
 	return true;
 }
 
 
+void Polygon::addCuts (const Point3 & a, const Point3 & b, const Point3 & c, const Point3 & d, std::vector<double> & cuts)
+{
+	const double abx = b[0] - a[0], aby = b[1] - a[1];
+	const double acx = c[0] - a[0], acy = c[1] - a[1];
+	const double cdx = d[0] - c[0], cdy = d[1] - c[1];
+	const double length2 = abx * abx + aby * aby;
+	if (length2 == 0)
+		return;
+
+	// a + t (b - a) = c + u (d - c)
+	const double denominator = abx * cdy - aby * cdx;
+	if (denominator != 0) {
+		const double t = (acx * cdy - acy * cdx) / denominator;
+		const double u = (acx * aby - acy * abx) / denominator;
+		if (t >= 0 && t <= 1 && u >= 0 && u <= 1)
+			cuts.push_back(t);
+	}
+	// c close to the segment, when it is parallel to the edge or passes near its end
+	const double t = std::max(0.0, std::min(1.0, (acx * abx + acy * aby) / length2));
+	if (std::abs(t * abx - acx) < IGT_EPSILON && std::abs(t * aby - acy) < IGT_EPSILON)
+		cuts.push_back(t);
+}
+
+
 bool Polygon::isIn (const Plane & p, float epsilon) const
 {
 
@@ -303,55 +690,9 @@ bool Polygon::isIn (const Plane & p, float epsilon) const
 // we compare the order of points, and if it's the same points
 bool Polygon::operator== (const Polygon & other) const
 {
-	std::list<Point3> newVertices, newOherVertices;
-
 	/////delete points not neccessary(points i belonging to segment [i-1,i+1])
-	Point3 prev, next;
-
-	// check if points are belonging to segment
-	for (std::list<Point3>::const_iterator currentIt = vertices.begin(); currentIt != vertices.end(); ++currentIt) {
-		Point3 curr = *currentIt;
-		std::list<Point3>::const_iterator prevIt = currentIt;
-		std::list<Point3>::const_iterator nextIt = currentIt;
-		++nextIt;
-
-		if (currentIt == vertices.begin()) {
-			prevIt = --vertices.end();
-			prev   = *(prevIt);
-		} else {
-			--prevIt;
-			prev = *(prevIt);
-		}
-		if (nextIt == vertices.end()) {
-			next = *(vertices.begin());
-		} else
-			next = *nextIt;
-		core::Segment s(prev, next);
-		if (! s.includes(curr))
-			newVertices.push_back(curr);
-	}
-
-	for (std::list<Point3>::const_iterator currentIt = other.vertices.begin(); currentIt != other.vertices.end(); ++currentIt) {
-		Point3 curr = *currentIt;
-		std::list<Point3>::const_iterator prevIt = currentIt;
-		std::list<Point3>::const_iterator nextIt = currentIt;
-		++nextIt;
-
-		if (currentIt == other.vertices.begin()) {
-			prevIt = --other.vertices.end();
-			prev   = *(prevIt);
-		} else {
-			--prevIt;
-			prev = *(prevIt);
-		}
-		if (nextIt == other.vertices.end()) {
-			next = *(other.vertices.begin());
-		} else
-			next = *nextIt;
-		core::Segment s(prev, next);
-		if (! s.includes(curr))
-			newOherVertices.push_back(curr);
-	}
+	Vertices newVertices     = withoutAlignedVertices(vertices, IGT_EPSILON);
+	Vertices newOherVertices = withoutAlignedVertices(other.vertices, IGT_EPSILON);
 
 	if (newVertices.size() != newOherVertices.size())
 		return false;
@@ -396,55 +737,9 @@ bool Polygon::operator== (const Polygon & other) const
 
 bool Polygon::isClose (const Polygon & other, float epsilon)
 {
-	std::list<Point3> newVertices, newOherVertices;
-
 	/////delete points not neccessary(points i belonging to segment [i-1,i+1])
-	Point3 prev, next;
-
-	// check if points are belonging to segment
-	for (std::list<Point3>::const_iterator currentIt = vertices.begin(); currentIt != vertices.end(); ++currentIt) {
-		Point3 curr = *currentIt;
-		std::list<Point3>::const_iterator prevIt = currentIt;
-		std::list<Point3>::const_iterator nextIt = currentIt;
-		++nextIt;
-
-		if (currentIt == vertices.begin()) {
-			prevIt = --vertices.end();
-			prev   = *(prevIt);
-		} else {
-			--prevIt;
-			prev = *(prevIt);
-		}
-		if (nextIt == vertices.end()) {
-			next = *(vertices.begin());
-		} else
-			next = *nextIt;
-		core::Segment s(prev, next);
-		if (! s.includes(curr, epsilon))
-			newVertices.push_back(curr);
-	}
-
-	for (std::list<Point3>::const_iterator currentIt = other.vertices.begin(); currentIt != other.vertices.end(); ++currentIt) {
-		Point3 curr = *currentIt;
-		std::list<Point3>::const_iterator prevIt = currentIt;
-		std::list<Point3>::const_iterator nextIt = currentIt;
-		++nextIt;
-
-		if (currentIt == other.vertices.begin()) {
-			prevIt = --other.vertices.end();
-			prev   = *(prevIt);
-		} else {
-			--prevIt;
-			prev = *(prevIt);
-		}
-		if (nextIt == other.vertices.end()) {
-			next = *(other.vertices.begin());
-		} else
-			next = *nextIt;
-		core::Segment s(prev, next);
-		if (! s.includes(curr, epsilon))
-			newOherVertices.push_back(curr);
-	}
+	Vertices newVertices     = withoutAlignedVertices(vertices, epsilon);
+	Vertices newOherVertices = withoutAlignedVertices(other.vertices, epsilon);
 
 	if (newVertices.size() != newOherVertices.size())
 		return false;
@@ -495,22 +790,13 @@ bool Polygon::operator!= (const Polygon & other) const
 
 void Polygon::addVertex (const Point3 & p, int index)
 {
-	if (index <= 0) {
-		vertices.push_front(p);
-		return;
-	}
-	if (index >= int(vertices.size())) {
-		vertices.push_back(p);
-		return;
-	}
-	std::list<Point3>::iterator it = vertices.begin();
-	for (int i = 0; i < index; ++i) {
-		++it;
-	}
-	if (it == vertices.end())
+	if (index <= 0)
+		vertices.insert(vertices.begin(), p);
+	else if (index >= int(vertices.size()))
 		vertices.push_back(p);
 	else
-		vertices.insert(it, p);
+		vertices.insert(vertices.begin() + index, p);
+	invalidateProjection();
 }
 
 
@@ -518,37 +804,25 @@ void Polygon::deleteVertex (int index)
 {
 	if (index < 0 || index >= int(vertices.size()))
 		return;
-	std::list<Point3>::iterator it = vertices.begin();
-	for (int i = 0; i < index; ++i) {
-		++it;
-	}
-	if (it != vertices.end())
-		vertices.erase(it);
+	vertices.erase(vertices.begin() + index);
+	invalidateProjection();
 }
 
 
 void Polygon::deleteVertex (const Point3 & p, float epsilon)
 {
-	for (std::list<Point3>::iterator it = vertices.begin(); it != vertices.end(); ++it) {
-		if ((*it).isClose(p, epsilon)) {
-			vertices.erase(it);
-			return;
-		}
-	}
+	int index = getIndex(p, epsilon);
+	if (index >= 0)
+		deleteVertex(index);
 }
 
 
 void Polygon::replaceVertex (const Point3 & oldP, const Point3 & newP, float epsilon)
 {
-
-	for (std::list<Point3>::iterator it = vertices.begin(); it != vertices.end(); ++it) {
-		if ((*it).isClose(oldP, epsilon)) {
-			*it = newP;
-			// it = vertices.erase(it);
-			// vertices.insert(it, newP);
-			// std::replace(it, ++it, oldP, newP);
-			return;
-		}
+	int index = getIndex(oldP, epsilon);
+	if (index >= 0) {
+		vertices[index] = newP;
+		invalidateProjection();
 	}
 }
 
@@ -556,14 +830,15 @@ void Polygon::replaceVertex (const Point3 & oldP, const Point3 & newP, float eps
 void Polygon::deleteAllVertices()
 {
 	vertices.clear();
+	invalidateProjection();
 }
 
 
 std::ostream & operator<< (std::ostream & out, const core::Polygon & poly)
 {
 	out << "Points " << int(poly.vertices.size()) << std::endl;
-	for (std::list<Point3>::const_iterator it = poly.vertices.begin(); it != poly.vertices.end(); ++it) {
-		out << "P " << (*it) << std::endl;
+	for (const Point3 & p : poly.vertices) {
+		out << "P " << p << std::endl;
 	}
 	return out;
 }
@@ -591,41 +866,33 @@ std::istream & operator>> (std::istream & is, Polygon & poly)
 		is >> p;
 		poly.vertices.push_back(p);
 	}
+	poly.invalidateProjection();
 	return is;
 }
 
 
-Point3 & Polygon::operator[] (int index)
+const Point3 & Polygon::operator[] (int index) const
 {
-	int i = 0;
-	for (Vertices::iterator it = vertices.begin(); it != vertices.end(); ++it) {
-		if (i == index)
-			return *it;
-		++i;
-	}
-	throw IGTIndexOutOfBounds("Polygon", index, int(vertices.size()));
+	if (index < 0 || index >= int(vertices.size()))
+		throw IGTIndexOutOfBounds("Polygon", index, int(vertices.size()));
+	return vertices[index];
 }
 
 
-const Point3 & Polygon::operator[] (int index) const
+void Polygon::setVertex (int index, const Point3 & p)
 {
-	int i = 0;
-	for (Vertices::const_iterator it = vertices.begin(); it != vertices.end(); ++it) {
-		if (i == index)
-			return *it;
-		++i;
-	}
-	throw IGTIndexOutOfBounds("Polygon", index, int(vertices.size()));
+	if (index < 0 || index >= int(vertices.size()))
+		throw IGTIndexOutOfBounds("Polygon", index, int(vertices.size()));
+	vertices[index] = p;
+	invalidateProjection();
 }
 
 
 int Polygon::getIndex (const Point3 & v, float epsilon) const
 {
-	int index = 0;
-	for (Vertices::const_iterator it = vertices.begin(); it != vertices.end(); ++it) {
-		if ((*it).isClose(v, epsilon))
-			return index;
-		++index;
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		if (vertices[i].isClose(v, epsilon))
+			return int(i);
 	}
 	return -1;
 }
@@ -644,10 +911,7 @@ bool Polygon::isInPolygonVertices (const Point3 & v, float epsilon) const
 
 Point3 Polygon::getGravityCenter() const
 {
-	std::list<Point3> verticesCopy;
-	for (std::list<Point3>::const_iterator it = vertices.begin(); it != vertices.end(); ++it) {
-		verticesCopy.push_back(*it);
-	}
+	Vertices verticesCopy(vertices);
 	Point3 firstVertex = *(verticesCopy.begin());
 	Point3 lastVertex  = *(--vertices.end());
 	if (firstVertex == lastVertex)
@@ -689,7 +953,7 @@ BoundingBox Polygon::getBoundingBox() const
 	Point3 upperBound = *vertices.begin();
 	Point3 lowerBound = *vertices.begin();
 
-	for (std::list<Point3>::const_iterator it = ++vertices.begin(); it != vertices.end(); ++it) {
+	for (Vertices::const_iterator it = vertices.begin() + 1; it != vertices.end(); ++it) {
 		if (lowerBound[0] > (*it)[0])
 			lowerBound[0] = (*it)[0];
 		if (lowerBound[1] > (*it)[1])
@@ -716,7 +980,7 @@ BoundingBox Polygon::getBoundingRectangle (core::Vector3 & u, core::Vector3 & v)
 	if (vertices.empty())
 		return BoundingBox();                  // less than 2 points
 	Point3 firstVertex = *(vertices.begin());
-	std::list<Point3>::const_iterator secondIt = vertices.begin();
+	Vertices::const_iterator secondIt = vertices.begin();
 	++secondIt;
 	if (secondIt == vertices.end())
 		return BoundingBox();                             // less than 2 points
@@ -736,7 +1000,7 @@ BoundingBox Polygon::getBoundingRectangle (core::Vector3 & u, core::Vector3 & v)
 	float maxU = 0;
 	float maxV = 0;
 
-	for (std::list<Point3>::const_iterator it = ++vertices.begin(); it != vertices.end(); ++it) {  // todo avoid second too point
+	for (Vertices::const_iterator it = vertices.begin() + 1; it != vertices.end(); ++it) {  // todo avoid second too point
 		Point3 currentVertex   = *it;
 		Vector3 currentSegment = currentVertex - firstVertex;
 
@@ -793,7 +1057,8 @@ BoundingBox Polygon::getBoundingRectangle (core::Vector3 & u, core::Vector3 & v)
 
 void Polygon::reversePoints()
 {
-	vertices.reverse();
+	std::reverse(vertices.begin(), vertices.end());
+	invalidateProjection();
 }
 
 
@@ -841,7 +1106,7 @@ bool Polygon::getNormal (Vector3 & normal) const
 	if (vertices.empty())
 		return false;                  // less than 3 points
 	Point3 firstVertex = *(vertices.begin());
-	std::list<Point3>::const_iterator secondIt = vertices.begin();
+	Vertices::const_iterator secondIt = vertices.begin();
 	++secondIt;
 	if (secondIt == vertices.end())
 		return false;                             // less than 3 points
@@ -877,7 +1142,7 @@ bool Polygon::getOrientedNormal (Vector3 & normal) const
 	if (vertices.empty())
 		return false;                  // less than 3 points
 	Point3 firstVertex = *(vertices.begin());
-	std::list<Point3>::const_iterator secondIt = vertices.begin();
+	Vertices::const_iterator secondIt = vertices.begin();
 	++secondIt;
 	if (secondIt == vertices.end())
 		return false;                             // less than 3 points
@@ -912,90 +1177,24 @@ bool Polygon::getOrientedNormal (Vector3 & normal) const
 
 std::vector<Triangle> Polygon::triangulate (const std::list<Point3> & points) const
 {
-	// TODO: not optimized for the moment
-	// only ear are computed(not yet reflex and convex point)
-	std::vector<Triangle> triangles;
-
-	std::vector<Point3> remainingPoints;
-	std::vector<Point3> earsPoints;
-	int cpt = 0;
-	/// if the polygon is convex, easy triangulation to do(connect one point to all others, except neighbourg)
-
-	// prefere to work with vector to use random access
-	for (std::list<Point3>::const_iterator it = points.begin(); it != points.end(); ++it, ++cpt) {
-		remainingPoints.push_back(*it);
-	}
-
-	for (int i = 0; i < int(remainingPoints.size()); ++i) {
-		if (isEar(remainingPoints, remainingPoints[i]))
-			earsPoints.push_back(remainingPoints[i]);
-	}
-
-	while (int(remainingPoints.size()) > 3) {
-		if (int(earsPoints.size()) == 0)
-			return triangles; /// should not be here
-
-		unsigned firstEarIndex = 0;
-		for (unsigned i = 0; i < remainingPoints.size(); ++i) {
-			if (earsPoints[0] == remainingPoints[i])
-				firstEarIndex = i;
-		}
-
-		// Add the triangle with the ear to the output list of triangles.
-		Point3 prevOfEar, nextOfEar;
-		if (firstEarIndex == 0)
-			prevOfEar = remainingPoints[remainingPoints.size() - 1];
-		else
-			prevOfEar = remainingPoints[firstEarIndex - 1];  // point juste before the ear
-
-		Point3 earPt = earsPoints[0];                        // == remainingPoints[firstEarIndex];
-
-		if (firstEarIndex == remainingPoints.size() - 1)
-			nextOfEar = remainingPoints[0];
-		else
-			nextOfEar = remainingPoints[firstEarIndex + 1];
-		triangles.push_back(core::Triangle(prevOfEar, earPt, nextOfEar));
-
-		// Remove the vertex corresponding to the ear.
-		std::vector<Point3>::iterator firstEarIterator = std::find(remainingPoints.begin(), remainingPoints.end(), earPt);
-		remainingPoints.erase(firstEarIterator);
-
-
-		if (int(remainingPoints.size()) == 3)
-			break;
+	return triangulate(Vertices(points.begin(), points.end()));
+}
 
-		// Removal of the ear can cause an adjacent vertex to become an ear or to stop being an ear.
-		earsPoints.erase(earsPoints.begin());
-		// Check the previous and the next vertex
-		// if the previous point was an ear
-		std::vector<Point3>::iterator earPrev = std::find(earsPoints.begin(), earsPoints.end(), prevOfEar);
-		if (earPrev != earsPoints.end()) {  // if == earsPoints.end() the previous was not a ear
-			// check that the previous point is still an ear
-			if (! isEar(remainingPoints, prevOfEar))
-				earsPoints.erase(earPrev); // prevOfEar is no longer an ear
-		} else {
-			// check if it can become an ear
-			if (isEar(remainingPoints, prevOfEar))
-				earsPoints.push_back(prevOfEar);
-		}
 
-		// if the next point was an ear
-		std::vector<Point3>::iterator earNext = std::find(earsPoints.begin(), earsPoints.end(), nextOfEar);
-		if (earNext != earsPoints.end()) {
-			// check that the next point is still an ear
-			if (! isEar(remainingPoints, nextOfEar))
-				earsPoints.erase(earNext);
-		} else {
-			// check if it can become an ear
-			if (isEar(remainingPoints, nextOfEar))
-				earsPoints.push_back(nextOfEar); // nextOfEar is no longer an ear
-		}
-	}
+std::vector<Triangle> Polygon::triangulate (const Vertices & points) const
+{
+	const std::vector<int> indices = triangulateIndices(points);
+	std::vector<Triangle> triangles;
+	triangles.reserve(indices.size() / 3);
+	for (size_t k = 0; k < indices.size(); k += 3)
+		triangles.push_back(core::Triangle(points[indices[k]], points[indices[k + 1]], points[indices[k + 2]]));
+	return triangles;
+}
 
-	if (remainingPoints.size() == 3)
-		triangles.push_back(core::Triangle(remainingPoints[0], remainingPoints[1], remainingPoints[2]));
 
-	return triangles;
+std::vector<int> Polygon::getTriangleIndices() const
+{
+	return triangulateIndices(vertices);
 }
 
 
@@ -1003,14 +1202,9 @@ std::vector<Point3> Polygon::getIntersection (const Plane & plane) const
 {
 	std::vector<Point3> result;
 	try {
-		for (Vertices::const_iterator it = vertices.begin(); it != vertices.end();) {
-			Point3 p = *it;
-			++it;
-			Point3 next;
-			if (it == vertices.end())
-				next = *(vertices.begin());
-			else
-				next = *it;
+		for (size_t i = 0; i < vertices.size(); ++i) {
+			const Point3 & p    = vertices[i];
+			const Point3 & next = (i + 1 == vertices.size()) ? vertices.front() : vertices[i + 1];
 
 			Segment s(p, next);
 			if (s.in(plane)) {
@@ -16,6 +16,8 @@
 #include <vector>
 #include <deque>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 
 //class wxXmlNode;
 
@@ -36,23 +38,27 @@ class Triangle;
 /**
  * @brief Polygon is a tool to represent a closed piece of plan.
  *
- * Polygon is a list of points in a plane.
+ * Polygon is a list of points in a plane, stored contiguously.
+ * The plane of the polygon and its vertices projected in 2D, used by isIn(), are
+ * computed at the first query and kept until the vertices change.
  */
 class TGCORE_API Polygon
 {
 
 public:
-	typedef std::list<Point3> Vertices;  // Points container ordered
+	typedef std::vector<Point3> Vertices;  // Points container ordered
 
 	friend TGCORE_API std::ostream & operator<< (std::ostream &, const Polygon &);
 
 	friend TGCORE_API std::istream & operator>> (std::istream &, Polygon &);
 
+	friend class PolygonQuery;
+
 	/**
 	 * Default constructor.<br>
 	 * Set default values
 	 */
-	Polygon() { }
+	Polygon() : projectionValid(false) { }
 
 	/**
 	 * Default constructor.<br>
@@ -65,6 +71,11 @@ public:
 	 */
 	explicit Polygon(const Vertices & pts);  // points are sorted, cannot modify this list later
 
+	/**
+	 * Constructor from a list of points, as the vertices were stored before.
+	 */
+	explicit Polygon(const std::list<Point3> & pts);
+
 	/**
 	 * Constructor from 4 points(upperLeft, lowerleft, upperRigth and lowerRigth) to get an ellipse sampled in nSeg segment
 	 */
@@ -83,16 +94,17 @@ public:
 	Polygon & operator= (const Polygon &);
 
 	/**
-	 * operator [].<br>
-	 * Nothing special.
+	 * operator [] const.<br>
+	 * Read only: use setVertex to move a vertex.
+	 * @throw IGTIndexOutOfBounds if index is not in [0, size()[.
 	 */
-	Point3 & operator[] (int index);
+	const Point3 & operator[] (int index) const;
 
 	/**
-	 * operator [] const.<br>
-	 * Nothing special.
+	 * Moves the vertex at index to p, and drops the cached projection.
+	 * @throw IGTIndexOutOfBounds if index is not in [0, size()[.
 	 */
-	const Point3 & operator[] (int index) const;  // avoid because there is a loop on the list of points
+	void setVertex (int index, const Point3 & p);
 
 	size_t size() const { return vertices.size(); }
 
@@ -115,7 +127,12 @@ public:
 	bool isIn (const Point3 &) const;
 
 	/**
-	 * Return true if the segment is in the polygon
+	 * Return true if the segment is in the polygon: all its points are in it, as isIn(const Point3 &).
+	 * The segment is cut where it crosses the edges, or passes close to a vertex; each piece
+	 * is then all in or all out, which its middle tells. The winding number of the pieces follows
+	 * from the crossings sorted along the segment: O(n log n) for n vertices, plus one point test
+	 * for each piece which does not wind (along an edge, or the first one out). Exact but for the
+	 * IGT_EPSILON margin.
 	 */
 	bool isIn (const Segment &) const;
 
@@ -191,10 +208,20 @@ public:
 
 	/** Return a vector of triangle, result of the triangulation of the polygon created by points
 	 * Be carrefull : parameters "points" must not be "periodic"(first element and last one have to be different)
-	 * (Not optimized function)
+	 * The polygon must be simple: n points give n - 2 triangles, in O(n log n).
 	 */
 	std::vector<Triangle> triangulate (const std::list<Point3> & points) const;
 
+	/** Same as above, from contiguous points. */
+	std::vector<Triangle> triangulate (const Vertices & points) const;
+
+	/**
+	 * Returns the triangulation of the polygon as an index buffer in getVertices(): three
+	 * indices per triangle, which turns as the polygon. The polygon must be simple and not
+	 * periodic; its n vertices give n - 2 triangles, in O(n log n).
+	 */
+	std::vector<int> getTriangleIndices() const;
+
 	// float							getOrientedAngle (const Point3& prev, const Point3& current, const Point3& next)const;
 
 	/** Reverse the order of vertices.*/
@@ -204,8 +231,7 @@ public:
 
 	bool isEar (const std::vector<Point3> & points, const Point3 & currentPt) const;
 
-	/** Get the gravity center of the polygon.
-	 * Function is very slow.
+	/** Get the gravity center of the polygon, from its triangulation.
 	 */
 	virtual Point3 getGravityCenter() const;
 
@@ -249,8 +275,44 @@ public:
 	//virtual void loadFromXmlNode (wxXmlNode *);
 
 protected:
+	/**
+	 * Drops the cached projection. To call after any change of the vertices,
+	 * including in derived classes.
+	 */
+	void invalidateProjection() { projectionValid = false; }
+
 	/** List ordered of all points  */
 	Vertices vertices;
+
+private:
+	/** The plane of the polygon and the vertices projected on it, as isIn() needs them. */
+	struct Projection
+	{
+		Projection() : isLine(true), plane(Vector3(0, 0, 1), Point3()), coordToIgnore(2) { }
+
+		bool isLine;            // all the vertices are aligned: only origin, p1 and p2 are relevant
+		Point3 origin, p1, p2;  // the first vertex, and the two which define the normal with it
+		Vector3 normal;         // normalised
+		Plane plane;
+		int coordToIgnore;      // the coordinate dropped to project in 2D
+		Vertices projected;     // vertices in 2D, with a null last coordinate
+	};
+
+	/** Returns the projection, computed at the first call after a change. Thread safe. */
+	const Projection & getProjection() const;
+
+	/** Projects the point p in 2D, like the vertices. */
+	static Point3 project (const Point3 & p, int coordToIgnore);
+
+	/**
+	 * Adds to cuts the positions t in [0, 1] on [a, b] of its crossing with the edge [c, d],
+	 * and of its closest point to c, if closer than IGT_EPSILON. All in 2D.
+	 */
+	static void addCuts (const Point3 & a, const Point3 & b, const Point3 & c, const Point3 & d, std::vector<double> & cuts);
+
+	mutable Projection projection;
+	mutable std::atomic<bool> projectionValid;
+	mutable std::mutex projectionMutex;
 };
 
 
@@ -0,0 +1,245 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "PolygonQuery.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace core {
+
+namespace {
+
+// Cells per side: 2 sqrt(n) for n edges, about 4 cells per edge
+const int MaxGridSize = 512;
+
+// Below this many points, starting threads costs more than it saves
+const int ParallelSize = 1 << 14;
+
+}  // namespace
+
+
+PolygonQuery::PolygonQuery(const Polygon & polygon)
+	: vertices(polygon.getVertices()), isLine(true), plane(Vector3(0, 0, 1), Point3()), coordToIgnore(2),
+	xMin(0), xMax(-1), yMin(0), yMax(-1), xScale(0), yScale(0), gridSize(0)
+{
+	if (vertices.size() < 3)
+		return;  // never in, see isIn
+
+	const Polygon::Projection & projection = polygon.getProjection();
+	isLine = projection.isLine;
+	origin = projection.origin;
+	p1     = projection.p1;
+	p2     = projection.p2;
+	if (isLine)
+		return;
+	plane         = projection.plane;
+	coordToIgnore = projection.coordToIgnore;
+
+	// the edges, and the bounds of the polygon
+	const Polygon::Vertices & projected = projection.projected;
+	const int n = int(projected.size());
+	edges.resize(n);
+	xMin = xMax = projected[0][0];
+	yMin = yMax = projected[0][1];
+	for (int i = 0; i < n; ++i) {
+		const Point3 & current = projected[i];
+		const Point3 & next    = projected[(i + 1) % n];
+		Edge & e = edges[i];
+		e.x0     = current[0];
+		e.y0     = current[1];
+		e.x1     = next[0];
+		e.y1     = next[1];
+		// twice the margin of Segment::includes, for the rounding of its projection
+		e.xMin   = std::min(e.x0, e.x1) - 2 * IGT_EPSILON;
+		e.xMax   = std::max(e.x0, e.x1) + 2 * IGT_EPSILON;
+		xMin     = std::min(xMin, e.x0);
+		xMax     = std::max(xMax, e.x0);
+		yMin     = std::min(yMin, e.y0);
+		yMax     = std::max(yMax, e.y0);
+	}
+	xMin -= 2 * IGT_EPSILON;
+	xMax += 2 * IGT_EPSILON;
+	yMin -= 2 * IGT_EPSILON;
+	yMax += 2 * IGT_EPSILON;
+
+	gridSize = std::min(MaxGridSize, 2 * int(std::ceil(std::sqrt(double(n)))));
+	xScale   = gridSize / (xMax - xMin);
+	yScale   = gridSize / (yMax - yMin);
+
+	// Edge i goes in the cells of its rows which its columns cross, and in the ones on their right,
+	// unless it crosses all the rows of the cell: then it only counts in the winding number of the
+	// cell. The margins keep the cells of the points close to an edge or a vertex in the first case.
+	cellWinding.assign(gridSize * gridSize, 0);
+	std::vector<int> cellSize(gridSize * gridSize, 0);
+	for (int pass = 0; pass < 2; ++pass) {
+		for (int i = 0; i < n; ++i) {
+			const Edge & e = edges[i];
+			const double lo = std::min(e.y0, e.y1), hi = std::max(e.y0, e.y1);
+			const int firstColumn = column(e.xMin - IGT_EPSILON), lastColumn = column(e.xMax + IGT_EPSILON);
+			for (int r = row(lo - 2 * IGT_EPSILON); r <= row(hi + 2 * IGT_EPSILON); ++r) {
+				const bool crossesRow = lo < yMin + r / yScale - IGT_EPSILON && hi > yMin + (r + 1) / yScale + IGT_EPSILON;
+				for (int c = firstColumn; c < gridSize; ++c) {
+					const int k = r * gridSize + c;
+					if (c > lastColumn && crossesRow) {
+						if (pass == 0)
+							cellWinding[k] += (e.y1 > e.y0) ? 1 : -1;
+					}
+					else if (pass == 0)
+						++cellSize[k];
+					else
+						cellEdges[cellStart[k] + --cellSize[k]] = i;
+				}
+			}
+		}
+		if (pass == 0) {
+			cellStart.assign(gridSize * gridSize + 1, 0);
+			for (int k = 0; k < gridSize * gridSize; ++k)
+				cellStart[k + 1] = cellStart[k] + cellSize[k];
+			cellEdges.resize(cellStart.back());
+		}
+	}
+}
+
+
+bool PolygonQuery::isIn (const Point3 & p) const
+{
+	if (vertices.size() < 3)
+		return false;
+	if (isLine)
+		return isInLine(p);
+
+	// a point close to a vertex or in the plane projects in the bounds
+	const Point3 newP = Polygon::project(p, coordToIgnore);
+	const double x = newP[0], y = newP[1];
+	if (! (x >= xMin && x <= xMax && y >= yMin && y <= yMax))
+		return false;
+	const int k = row(y) * gridSize + column(x);
+	const int * begin = cellEdges.data() + cellStart[k];
+	const int * end   = cellEdges.data() + cellStart[k + 1];
+
+	// the vertices close to p are all in its cell, as the edges they start
+	for (const int * i = begin; i != end; ++i) {
+		if (vertices[*i].isClose(p))
+			return true;
+	}
+	if (! plane.includes(p))
+		return false;                           // important, test before projection
+
+	// Polygon::isIn counts the crossings of the horizontal of P on its right. There are as many up
+	// as down crossings in all, so the crossings on its left give the same number, negated.
+	int left = cellWinding[k];
+	for (const int * i = begin; i != end; ++i) {
+		const Edge & e = edges[*i];
+		if (x >= e.xMin && x <= e.xMax) {
+			// Segment::includes and Vector3::isClose, in 2D
+			const double dx = e.x1 - e.x0, dy = e.y1 - e.y0;
+			const double t  = ((x - e.x0) * dx + (y - e.y0) * dy) / (dx * dx + dy * dy);
+			if (t >= 0.0 && t <= 1.0 && std::abs(dx * t + e.x0 - x) < IGT_EPSILON && std::abs(dy * t + e.y0 - y) < IGT_EPSILON)
+				return true;
+			if ((std::abs(x - e.x0) < IGT_EPSILON && std::abs(y - e.y0) < IGT_EPSILON)
+			    || (std::abs(x - e.x1) < IGT_EPSILON && std::abs(y - e.y1) < IGT_EPSILON))
+				return true;
+		}
+		if (e.y0 <= y) {
+			if (e.y1 > y) {  // an upward crossing
+				if (float((e.x1 - e.x0) * (y - e.y0) - (x - e.x0) * (e.y1 - e.y0)) <= 0) // not P left of edge
+					++left;
+			}
+		} else {
+			if (e.y1 <= y) {  // an downward crossing
+				if (float((e.x1 - e.x0) * (y - e.y0) - (x - e.x0) * (e.y1 - e.y0)) >= 0) // not P right of edge
+					--left;
+			}
+		}
+	}
+	return left != 0;
+}
+
+
+void PolygonQuery::isIn (const Point3 * points, int count, bool * inside, unsigned threadCount) const
+{
+	if (count <= 0)
+		return;
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	auto test = [&](int i0, int i1) {
+		for (int i = i0; i < i1; ++i)
+			inside[i] = isIn(points[i]);
+	};
+
+	// batches of 64 results: the threads share at most the cache lines at their ends (inside is not aligned)
+	int batch = (count + (int)threadCount - 1) / (int)threadCount;
+	batch = (batch + 63) / 64 * 64;
+	if (threadCount == 1 || batch >= count || count < ParallelSize) {
+		test(0, count);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (int i0 = batch; i0 < count; i0 += batch) {
+		threads.push_back(std::thread(test, i0, std::min(i0 + batch, count)));
+	}
+	test(0, batch);
+	for (std::thread & thread : threads) {
+		thread.join();
+	}
+}
+
+
+bool PolygonQuery::isIn (const Segment & s) const
+{
+	// as Polygon::isIn(const Segment &)
+	if (! isIn(s.from()) || ! isIn(s.to()))
+		return false;
+	if (isLine)
+		return true;
+
+	// the cells close to the segment, row by row: their edges are the only ones which it may meet
+	const Point3 a = Polygon::project(s.from(), coordToIgnore), b = Polygon::project(s.to(), coordToIgnore);
+	const double yLow = std::min(a[1], b[1]), yHigh = std::max(a[1], b[1]);
+	std::vector<double> cuts(1, 0.0);
+	for (int r = row(yLow - 2 * IGT_EPSILON); r <= row(yHigh + 2 * IGT_EPSILON); ++r) {
+		double x0 = a[0], x1 = b[0];
+		if (a[1] != b[1]) {
+			const double y0 = std::max(yLow, yMin + r / yScale) - 2 * IGT_EPSILON;
+			const double y1 = std::min(yHigh, yMin + (r + 1) / yScale) + 2 * IGT_EPSILON;
+			const double t0 = std::max(0.0, std::min(1.0, (y0 - a[1]) / (b[1] - a[1])));
+			const double t1 = std::max(0.0, std::min(1.0, (y1 - a[1]) / (b[1] - a[1])));
+			x0 = a[0] + t0 * (b[0] - a[0]);
+			x1 = a[0] + t1 * (b[0] - a[0]);
+		}
+		const int lastColumn = column(std::max(x0, x1) + 2 * IGT_EPSILON);
+		for (int c = column(std::min(x0, x1) - 2 * IGT_EPSILON); c <= lastColumn; ++c) {
+			const int k = r * gridSize + c;
+			for (int j = cellStart[k]; j < cellStart[k + 1]; ++j) {
+				const Edge & e = edges[cellEdges[j]];
+				Polygon::addCuts(a, b, Point3(e.x0, e.y0, 0), Point3(e.x1, e.y1, 0), cuts);
+			}
+		}
+	}
+	cuts.push_back(1.0);
+	std::sort(cuts.begin(), cuts.end());
+	for (size_t k = 0; k + 1 < cuts.size(); ++k) {
+		const double t = 0.5 * (cuts[k] + cuts[k + 1]);
+		if (cuts[k + 1] > cuts[k] && ! isIn((1 - t) * s.from() + t * s.to()))
+			return false;
+	}
+	return true;
+}
+
+
+bool PolygonQuery::isInLine (const Point3 & p) const
+{
+	for (const Point3 & v : vertices) {
+		if (v.isClose(p))
+			return true;
+	}
+	// FIXME : take the segment the longer, not v1 and v2
+	return Segment(origin, p1).includes(p) || Segment(origin, p2).includes(p);
+}
+
+
+}  // namespace core
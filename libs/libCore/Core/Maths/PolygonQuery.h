@@ -0,0 +1,90 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef PolygonQueryH
+#define PolygonQueryH
+
+#include "../../libCore.h"
+#include "Polygon.h"
+#include "Segment.h"
+
+#include <vector>
+
+namespace core {
+
+/**
+ * @brief A polygon prepared for many point-in-polygon tests.
+ *
+ * The plane, the 2D projection and a grid of the edges are computed once, at
+ * construction. Each cell of the grid keeps the edges which cross it, the few others
+ * on its left which may cross its rows, and the winding number of the edges on its
+ * left which cross all its rows. A query only looks at the edges of the cell of the
+ * point, instead of all of them. The answers are the same as Polygon::isIn(const Point3 &).
+ *
+ * The query is a snapshot: changes of the polygon after the construction are not seen.
+ */
+class TGCORE_API PolygonQuery
+{
+public:
+	/**
+	 * Constructor.
+	 * @param polygon the polygon to query, copied.
+	 */
+	explicit PolygonQuery(const Polygon & polygon);
+
+	/**
+	 * Returns true if the point is in the polygon, on its edges included,
+	 * as Polygon::isIn(const Point3 &).
+	 */
+	bool isIn (const Point3 & p) const;
+
+	/**
+	 * Tests count points at once, over several threads.
+	 * @param points the points to test,
+	 * @param count the number of points,
+	 * @param inside set to isIn(points[i]), for each point,
+	 * @param threadCount the number of threads, 0 for as many as the hardware runs.
+	 */
+	void isIn (const Point3 * points, int count, bool * inside, unsigned threadCount=0) const;
+
+	/**
+	 * Returns true if the segment is in the polygon, as Polygon::isIn(const Segment &),
+	 * from the edges in the cells which the segment crosses only.
+	 */
+	bool isIn (const Segment & s) const;
+
+private:
+	/** An edge of the projected polygon. */
+	struct Edge
+	{
+		double x0, y0, x1, y1;  // from (x0, y0) to (x1, y1)
+		double xMin, xMax;      // with the margin of the tests on edges
+	};
+
+	/** Returns the row of the grid of y, and the column of x. */
+	int row (double y) const { return std::max(0, std::min(gridSize - 1, int((y - yMin) * yScale))); }
+
+	int column (double x) const { return std::max(0, std::min(gridSize - 1, int((x - xMin) * xScale))); }
+
+	/** The test when all the vertices are aligned, as Polygon::isIn does. */
+	bool isInLine (const Point3 & p) const;
+
+	Polygon::Vertices vertices;
+	bool isLine;
+	Point3 origin, p1, p2;
+	Plane plane;
+	int coordToIgnore;
+
+	double xMin, xMax, yMin, yMax;  // bounds of the projected polygon, with the margin
+	double xScale, yScale;          // cells per unit
+	int gridSize;                   // number of rows, and of columns
+	std::vector<Edge> edges;        // edge i starts at vertex i
+	std::vector<int> cellStart;     // the edges of cell k are cellEdges[cellStart[k]] to cellEdges[cellStart[k + 1]]
+	std::vector<int> cellEdges;
+	std::vector<int> cellWinding;   // winding number of the edges left of cell k which cross all its rows
+};
+
+
+}  // namespace core
+#endif  // PolygonQueryH
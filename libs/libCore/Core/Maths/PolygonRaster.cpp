@@ -0,0 +1,215 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "PolygonRaster.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace core {
+
+namespace {
+
+/** An edge of the polygon, in pixels. */
+struct ScanEdge
+{
+	double x0, y0, x1, y1;
+	double lo, hi;  // y range
+	int dir;        // 1 going down the rows, -1 going up
+};
+
+
+// Sets the pixels of the row from x = xa to x = xb, with the margin of Polygon::isIn
+void fillSpan (bool * row, int width, double xa, double xb)
+{
+	const double first = std::max(0.0, std::ceil(xa - IGT_EPSILON));
+	const double last  = std::min(width - 1.0, std::floor(xb + IGT_EPSILON));
+	if (first <= last)
+		std::fill(row + int(first), row + int(last) + 1, true);
+}
+
+
+// Adds the signed area between the edge and the left of the image, to each pixel of the rows it
+// crosses: their sum along a row, from the left, is then the covered part of the pixels. The edge
+// is in the rows, and in columns 0 to width.
+void accumulate (double * acc, int stride, int height, double x0, double y0, double x1, double y1)
+{
+	if (y0 == y1)
+		return;
+	double dir = 1;
+	if (y0 > y1) {
+		std::swap(x0, x1);
+		std::swap(y0, y1);
+		dir = -1;
+	}
+	const double dxdy = (x1 - x0) / (y1 - y0);
+	const int rowEnd  = std::min(height, int(std::ceil(y1)));
+	for (int r = std::max(0, int(std::floor(y0))); r < rowEnd; ++r) {
+		const double ya = std::max(double(r), y0), yb = std::min(r + 1.0, y1);
+		const double xa = x0 + (ya - y0) * dxdy, xb = x0 + (yb - y0) * dxdy;
+		const double d  = (yb - ya) * dir;
+		double * line   = acc + r * stride;
+
+		const double xl = std::min(xa, xb), xr = std::max(xa, xb);
+		const int xli = int(std::floor(xl)), xri = int(std::ceil(xr));
+		if (xri <= xli + 1) {
+			// in one column: the trapezoid on its right
+			const double xm = 0.5 * (xa + xb) - xli;
+			line[xli]     += d - d * xm;
+			line[xli + 1] += d * xm;
+		} else {
+			// across columns: a triangle in the first, the same slice in the middle ones, the rest in the last
+			const double s  = 1 / (xr - xl);
+			const double fl = xl - xli;
+			const double fr = xr - xri + 1;
+			const double a0 = 0.5 * s * (1 - fl) * (1 - fl);
+			const double am = 0.5 * s * fr * fr;
+			line[xli] += d * a0;
+			if (xri == xli + 2)
+				line[xli + 1] += d * (1 - a0 - am);
+			else {
+				const double a1 = s * (1.5 - fl);
+				line[xli + 1] += d * (a1 - a0);
+				for (int xi = xli + 2; xi < xri - 1; ++xi)
+					line[xi] += d * s;
+				const double a2 = a1 + (xri - xli - 3) * s;
+				line[xri - 1] += d * (1 - a2 - am);
+			}
+			line[xri] += d * am;
+		}
+	}
+}
+
+}  // namespace
+
+
+void rasterize (const Polygon & polygon, Mask & mask)
+{
+	const int width = int(mask.width()), height = int(mask.height());
+	if (width == 0 || height == 0)
+		return;
+	mask.fill(false);
+	const Polygon::Vertices & vertices = polygon.getVertices();
+	const int n = int(vertices.size());
+	if (n < 3)
+		return;  // as Polygon::isIn
+
+	// the edge table, by first row
+	std::vector<ScanEdge> edges(n);
+	double yMin = vertices[0][1], yMax = vertices[0][1];
+	for (int i = 0; i < n; ++i) {
+		const Point3 & current = vertices[i];
+		const Point3 & next    = vertices[(i + 1) % n];
+		ScanEdge & e = edges[i];
+		e.x0  = current[0];
+		e.y0  = current[1];
+		e.x1  = next[0];
+		e.y1  = next[1];
+		e.lo  = std::min(e.y0, e.y1);
+		e.hi  = std::max(e.y0, e.y1);
+		e.dir = (e.y1 > e.y0) ? 1 : -1;
+		yMin  = std::min(yMin, e.lo);
+		yMax  = std::max(yMax, e.hi);
+	}
+	std::sort(edges.begin(), edges.end(), [](const ScanEdge & a, const ScanEdge & b) { return a.lo < b.lo; });
+
+	const double firstRow = std::max(0.0, std::ceil(yMin - IGT_EPSILON));
+	const double lastRow  = std::min(height - 1.0, std::floor(yMax + IGT_EPSILON));
+	if (firstRow > lastRow)
+		return;
+
+	bool * pixels = &mask[0];
+	std::vector<const ScanEdge *> active;
+	std::vector<std::pair<double, int> > crossings;
+	size_t nextEdge = 0;
+	for (int y = int(firstRow); y <= int(lastRow); ++y) {
+		// the edges close to the row
+		while (nextEdge < edges.size() && edges[nextEdge].lo - IGT_EPSILON <= y) {
+			active.push_back(&edges[nextEdge++]);
+		}
+		active.erase(std::remove_if(active.begin(), active.end(), [y](const ScanEdge * e) { return e->hi + IGT_EPSILON < y; }),
+			active.end());
+
+		bool * row = pixels + y * width;
+		crossings.clear();
+		for (const ScanEdge * e : active) {
+			if (e->lo <= y && y < e->hi) {
+				// crosses the row, with the rule of Polygon::isIn
+				crossings.push_back(std::make_pair(e->x0 + (y - e->y0) * (e->x1 - e->x0) / (e->y1 - e->y0), e->dir));
+			} else {
+				// only touches it: the pixels on the part of the edge close to the row are on the boundary
+				double xa = e->x0, xb = e->x1;
+				if (e->y0 != e->y1) {
+					const double ta = std::max(0.0, std::min(1.0, (y - IGT_EPSILON - e->y0) / (e->y1 - e->y0)));
+					const double tb = std::max(0.0, std::min(1.0, (y + IGT_EPSILON - e->y0) / (e->y1 - e->y0)));
+					xa = e->x0 + ta * (e->x1 - e->x0);
+					xb = e->x0 + tb * (e->x1 - e->x0);
+				}
+				fillSpan(row, width, std::min(xa, xb), std::max(xa, xb));
+			}
+		}
+
+		// the spans of non-zero winding number, their ends included
+		std::sort(crossings.begin(), crossings.end());
+		int winding = 0;
+		for (size_t k = 0; k + 1 < crossings.size(); ++k) {
+			winding += crossings[k].second;
+			if (winding != 0)
+				fillSpan(row, width, crossings[k].first, crossings[k + 1].first);
+		}
+	}
+}
+
+
+void rasterizeCoverage (const Polygon & polygon, Image<float> & coverage)
+{
+	const int width = int(coverage.width()), height = int(coverage.height());
+	if (width == 0 || height == 0)
+		return;
+	coverage.fill(0.0f);
+	const Polygon::Vertices & vertices = polygon.getVertices();
+	const int n = int(vertices.size());
+	if (n < 3)
+		return;
+
+	// pixel (x, y) covers [x, x + 1[ x [y, y + 1[ here, and two more columns for the right ends of the edges
+	const int stride = width + 2;
+	std::vector<double> acc(size_t(stride) * height, 0.0);
+	for (int i = 0; i < n; ++i) {
+		const double x0 = vertices[i][0] + 0.5, y0 = vertices[i][1] + 0.5;
+		const double x1 = vertices[(i + 1) % n][0] + 0.5, y1 = vertices[(i + 1) % n][1] + 0.5;
+
+		// cut the edge at the left and right sides of the image; the parts out of it move on
+		// the sides: on the left, they still cover the whole rows, on the right, nothing
+		double t[4] = { 0.0, 1.0, 1.0, 1.0 };
+		int cuts = 1;
+		for (double side : { 0.0, double(width) }) {
+			if ((x0 - side) * (x1 - side) < 0)
+				t[cuts++] = (side - x0) / (x1 - x0);
+		}
+		if (cuts == 3 && t[1] > t[2])
+			std::swap(t[1], t[2]);
+		t[cuts] = 1.0;
+		for (int k = 0; k < cuts; ++k) {
+			const double xa = std::max(0.0, std::min(double(width), x0 + t[k] * (x1 - x0)));
+			const double xb = std::max(0.0, std::min(double(width), x0 + t[k + 1] * (x1 - x0)));
+			accumulate(acc.data(), stride, height, xa, y0 + t[k] * (y1 - y0), xb, y0 + t[k + 1] * (y1 - y0));
+		}
+	}
+
+	float * pixels = &coverage[0];
+	for (int y = 0; y < height; ++y) {
+		const double * line = acc.data() + y * stride;
+		float * row = pixels + y * width;
+		double sum = 0;
+		for (int x = 0; x < width; ++x) {
+			sum += line[x];
+			row[x] = float(std::min(1.0, std::abs(sum)));
+		}
+	}
+}
+
+
+}  // namespace core
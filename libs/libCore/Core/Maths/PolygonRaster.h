@@ -0,0 +1,38 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef PolygonRasterH
+#define PolygonRasterH
+
+#include "../../libCore.h"
+#include "Polygon.h"
+#include "../Image.h"
+
+namespace core {
+
+/**
+ * Fills a mask with a polygon, row by row.
+ * The polygon is in pixels of the mask: x for the columns, y for the rows, z is ignored.
+ * Pixel (x, y) is set if the point (x, y) is in the polygon (non-zero winding, as
+ * Polygon::isIn) or on its edges, with the IGT_EPSILON margin of Polygon::isIn.
+ * The cost is the size of the mask, which is cleared first, plus the edges crossing each row
+ * (sorted by crossing), plus a sort of the edges once.
+ * @param polygon the polygon, which may be partly or totally out of the mask,
+ * @param mask the mask to fill: all its pixels are set.
+ */
+TGCORE_API void rasterize (const Polygon & polygon, Mask & mask);
+
+/**
+ * Fills an image with the part of each pixel covered by a polygon, between 0 and 1.
+ * The polygon is in pixels of the image, as rasterize(const Polygon &, Mask &): pixel (x, y)
+ * is the square of side 1 centered on (x, y). The coverage is exact for simple polygons; where
+ * a polygon overlaps itself, the winding number is clamped to 1.
+ * @param polygon the polygon, which may be partly or totally out of the image,
+ * @param coverage the image to fill: all its pixels are set.
+ */
+TGCORE_API void rasterizeCoverage (const Polygon & polygon, Image<float> & coverage);
+
+
+}  // namespace core
+#endif  // PolygonRasterH
@@ -67,7 +67,7 @@ bool Triangle::intersectIn2Points (const Plane & p, std::deque<Point3> & interse
 		int nbIntersectionVertices           = 0;
 
 		Point3 firstVertex                   = *(vertices.begin());
-		std::list<Point3>::iterator secondIt = vertices.begin();
+		Vertices::iterator secondIt           = vertices.begin();
 		++secondIt;
 		Point3 secondVertex                  = *secondIt;
 		Point3 thirdVertex                   = vertices.back();
@@ -220,7 +220,7 @@ bool Triangle::getIntersection (const core::Line & line, core::Point3 & result,
 double Triangle::getArea() const
 {
 	Point3 firstVertex = *(vertices.begin());
-	std::list<Point3>::const_iterator secondIt = vertices.begin();
+	Vertices::const_iterator secondIt = vertices.begin();
 	++secondIt;
 	Point3 secondVertex  = *secondIt;
 	Point3 thirdVertex   = vertices.back();
@@ -238,7 +238,7 @@ double Triangle::getArea() const
 Point3 Triangle::getGravityCenter() const
 {
 	Point3 firstVertex = *(vertices.begin());
-	std::list<Point3>::const_iterator secondIt = vertices.begin();
+	Vertices::const_iterator secondIt = vertices.begin();
 	++secondIt;
 	Point3 secondVertex = *secondIt;
 	Point3 thirdVertex  = vertices.back();
@@ -0,0 +1,177 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseCalibration.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+/** Prior variance of the offset, per unit of measurement variance: as good as unknown */
+const double OffsetPrior = 1e8;
+
+/**
+* Smallest 1 - h P h the downdate divides by. The last observations of the offset leave it near 0 (as 1 / OffsetPrior):
+* taking them out would cancel most of the digits, so the remaining observations are refitted instead.
+*/
+const double DowndateMin = 1e-4;
+
+} // namespace
+
+MuseCalibration::MuseCalibration() {
+    clear();
+}
+
+void MuseCalibration::setRotationEnabled(bool isRotationEnabled) {
+    m_isRotationEnabled = isRotationEnabled;
+    refit();
+}
+
+void MuseCalibration::setRotationDamping(double damping) {
+    m_rotationDamping = damping;
+    refit();
+}
+
+bool MuseCalibration::addObservation(const core::Vector3& theoreticalFocus, const core::Vector3& observedFocus) {
+    if (m_observations.empty())
+        m_reference = theoreticalFocus;
+    Observation observation = { theoreticalFocus, observedFocus, true };
+    if (m_outlierThreshold > 0 && m_numAccepted >= 3) {
+        double residual = (observedFocus - theoreticalFocus - getOffset(theoreticalFocus)).length();
+        observation.isAccepted = residual <= std::max(m_outlierThreshold, 3 * getRMSResidual());
+    }
+    m_observations.push_back(observation);
+    if (observation.isAccepted) {
+        update(observation);
+        ++m_numAccepted;
+    }
+    return observation.isAccepted;
+}
+
+void MuseCalibration::removeLastObservation() {
+    if (m_observations.empty())
+        return;
+    Observation observation = m_observations.back();
+    m_observations.pop_back();
+    if (m_observations.empty())
+        m_reference = core::Vector3(0, 0, 0);
+    if (observation.isAccepted) {
+        --m_numAccepted;
+        if (m_numAccepted == 0 || !downdate(observation))
+            refit();
+    }
+}
+
+void MuseCalibration::clear() {
+    m_observations.clear();
+    m_reference = core::Vector3(0, 0, 0);
+    refit();
+}
+
+core::Vector3 MuseCalibration::getOffset(const core::Vector3& theoreticalFocus) const {
+    return m_offset + (m_rotation ^ (theoreticalFocus - m_reference));
+}
+
+core::Vector3 MuseCalibration::getOffsetUncertainty(const core::Vector3& theoreticalFocus) const {
+    // variance of each row of A x: a P at
+    double noise = getNoise();
+    core::Vector3 uncertainty;
+    for (int axis = 0; axis < 3; ++axis) {
+        core::VecN<6> h = getRow(theoreticalFocus, axis);
+        uncertainty[axis] = noise * std::sqrt(std::max(core::dot(h, m_covariance * h), 0.0));
+    }
+    return uncertainty;
+}
+
+double MuseCalibration::getRMSResidual() const {
+    if (m_numAccepted == 0)
+        return 0;
+    return std::sqrt(getSumSquaredResiduals() / m_numAccepted);
+}
+
+double MuseCalibration::getSumSquaredResiduals() const {
+    // the recursion also sums the distance of the state to the prior, weighted by the prior precision
+    double priorSquares = (m_offset * m_offset) / OffsetPrior;
+    if (m_isRotationEnabled && m_rotationDamping > 0)
+        priorSquares += m_rotationDamping * (m_rotation * m_rotation);
+    else if (m_isRotationEnabled)
+        priorSquares += (m_rotation * m_rotation) / OffsetPrior;
+    return std::max(m_sumSquares - priorSquares, 0.0);
+}
+
+core::VecN<6> MuseCalibration::getRow(const core::Vector3& theoreticalFocus, int axis) const {
+    // offset + rotation x p, with p relative to the reference
+    core::Vector3 p = theoreticalFocus - m_reference;
+    core::VecN<6> h;
+    h[axis] = 1;
+    h[3 + (axis + 1) % 3] = p[(axis + 2) % 3];
+    h[3 + (axis + 2) % 3] = -p[(axis + 1) % 3];
+    return h;
+}
+
+void MuseCalibration::update(const Observation& observation) {
+    core::Vector3 y = observation.observedFocus - observation.theoreticalFocus;
+    for (int axis = 0; axis < 3; ++axis) {
+        // gain P h / (1 + h P h), innovation y - h x
+        core::VecN<6> h = getRow(observation.theoreticalFocus, axis);
+        core::VecN<6> Ph = m_covariance * h;
+        double s = 1 + core::dot(h, Ph);
+        double innovation = y[axis] - core::dot(h, m_state);
+        m_state += Ph * (innovation / s);
+        m_covariance -= Ph * core::transpose(Ph) / s;
+        m_sumSquares += innovation * innovation / s;
+    }
+    updateOffset();
+}
+
+bool MuseCalibration::downdate(const Observation& observation) {
+    core::Vector3 y = observation.observedFocus - observation.theoreticalFocus;
+    for (int axis = 2; axis >= 0; --axis) {
+        // inverse of update: P h is the gain it applied, 1 - h P h = 1 / (1 + h P h) before it
+        core::VecN<6> h = getRow(observation.theoreticalFocus, axis);
+        core::VecN<6> Ph = m_covariance * h;
+        double s = 1 - core::dot(h, Ph);
+        if (!(s >= DowndateMin))
+            return false;
+        double residual = y[axis] - core::dot(h, m_state);
+        m_state -= Ph * (residual / s);
+        m_covariance += Ph * core::transpose(Ph) / s;
+        m_sumSquares -= residual * residual / s;
+    }
+    updateOffset();
+    return true;
+}
+
+void MuseCalibration::refit() {
+    // prior: offset unknown, rotation 0 with the damping as precision, or exactly 0 when disabled
+    m_state.fill(0);
+    m_covariance.fill(0);
+    for (int i = 0; i < 6; ++i) {
+        if (i < 3 || (m_isRotationEnabled && m_rotationDamping <= 0))
+            m_covariance(i, i) = OffsetPrior;
+        else
+            m_covariance(i, i) = m_isRotationEnabled ? 1 / m_rotationDamping : 0;
+    }
+    m_sumSquares = 0;
+    m_numAccepted = 0;
+    for (const Observation& observation : m_observations) {
+        if (observation.isAccepted) {
+            update(observation);
+            ++m_numAccepted;
+        }
+    }
+    updateOffset();
+}
+
+void MuseCalibration::updateOffset() {
+    m_offset = core::Vector3(m_state[0], m_state[1], m_state[2]);
+    m_rotation = core::Vector3(m_state[3], m_state[4], m_state[5]);
+}
+
+double MuseCalibration::getNoise() const {
+    int degrees = 3 * m_numAccepted - (m_isRotationEnabled ? 6 : 3);
+    if (degrees <= 0)
+        return m_measurementNoise;
+    return std::max(m_measurementNoise, std::sqrt(getSumSquaredResiduals() / degrees));
+}
@@ -0,0 +1,146 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSECALIBRATION_H
+#define MUSECALIBRATION_H
+
+#include "../libs/libCore/Core/Maths/MatN.h"
+#include "../libs/libCore/Core/Maths/Vector3.h"
+#include <vector>
+
+/**
+* @brief Calibration of the Muse System from many observations: pairs of theoretical focus (uncalibrated, from the
+* settings) and focus observed by Thermoguide.
+*
+* The calibration is the least-squares fit of observed = theoretical + offset, or, with the rotation enabled,
+* observed = theoretical + offset + rotation x (theoretical - reference), for a small rotation (in radians) about
+* the first theoretical focus. The rotation is damped (see setRotationDamping) so that it stays near 0 until the
+* observations are spread enough to tell it from the offset.
+*
+* The fit is a recursive least-squares (Kalman) state: the offset and rotation, and their covariance. Each axis of
+* an observation is folded in with a rank-one update of the 6x6 covariance, and removed with the matching
+* downdate: adding or removing an observation takes constant time, whatever the length of the session. The
+* covariance gives the uncertainty of the calibration. An observation further from the current fit than the
+* outlier threshold is rejected (kept, but not used), once there are enough observations to trust the fit.
+*/
+class MuseCalibration
+{
+public:
+    /** An observation, and whether it is used in the fit */
+    struct Observation
+    {
+        core::Vector3 theoreticalFocus;
+        core::Vector3 observedFocus;
+        bool isAccepted;
+    };
+
+    /** Constructor. No observation, offset only. */
+    MuseCalibration();
+
+    /** Destructor */
+    ~MuseCalibration() = default;
+
+    /** Fits a rotation as well as the offset. Refits the observations so far. */
+    void setRotationEnabled(bool isRotationEnabled);
+    bool isRotationEnabled() const { return m_isRotationEnabled; }
+
+    /**
+    * Damping of the rotation, in mm^2: as if one observation at sqrt(damping) mm from the reference had no
+    * rotation (default 100). Refits the observations so far.
+    */
+    void setRotationDamping(double damping);
+
+    /** Standard deviation (mm) of the observed foci on each axis, the least the uncertainty is scaled by (default 1 mm) */
+    void setMeasurementNoise(double noise) { m_measurementNoise = noise; }
+
+    /**
+    * Residual (mm) above which an observation is an outlier: the larger of threshold and 3 times the RMS
+    * residual of the fit. Applies once three observations are accepted, from the fourth on. 0 disables the
+    * rejection (default 3 mm).
+    */
+    void setOutlierThreshold(double threshold) { m_outlierThreshold = threshold; }
+
+    /** Adds an observation and refits. Returns false if it was rejected as an outlier. */
+    bool addObservation(const core::Vector3& theoreticalFocus, const core::Vector3& observedFocus);
+
+    /** Removes the last observation (e.g. entered with wrong settings) and refits */
+    void removeLastObservation();
+
+    /** Removes all the observations */
+    void clear();
+
+    /** Whether at least one observation is accepted */
+    bool isCalibrated() const { return m_numAccepted > 0; }
+
+    /** Offset to add to the theoretical focus, at the reference */
+    const core::Vector3& getOffset() const { return m_offset; }
+
+    /** Offset to add to theoreticalFocus, rotation included */
+    core::Vector3 getOffset(const core::Vector3& theoreticalFocus) const;
+
+    /** Rotation vector (radians), 0 unless enabled */
+    const core::Vector3& getRotation() const { return m_rotation; }
+
+    /**
+    * Standard deviation (mm) of the offset to add to theoreticalFocus on each axis, rotation included. Scaled by
+    * the larger of the measurement noise and the scatter of the observations around the fit.
+    */
+    core::Vector3 getOffsetUncertainty(const core::Vector3& theoreticalFocus) const;
+
+    /** Standard deviation of the offset at the reference */
+    core::Vector3 getOffsetUncertainty() const { return getOffsetUncertainty(m_reference); }
+
+    /** Center of the rotation: the theoretical focus of the first observation */
+    const core::Vector3& getReference() const { return m_reference; }
+
+    /** RMS distance (mm) between the observed foci and the fit, over the accepted observations */
+    double getRMSResidual() const;
+
+    const std::vector<Observation>& getObservations() const { return m_observations; }
+    int getNumAccepted() const { return m_numAccepted; }
+    int getNumRejected() const { return int(m_observations.size()) - m_numAccepted; }
+
+private:
+    /** Folds in the observation, one rank-one update per axis */
+    void update(const Observation& observation);
+
+    /**
+    * Takes the observation, the last one folded in, back out. Returns false, with the state partly downdated,
+    * if that is ill-conditioned: the caller must refit.
+    */
+    bool downdate(const Observation& observation);
+
+    /** Restarts from the prior, and folds in the accepted observations again */
+    void refit();
+
+    /** Row axis of the observation matrix for an observation at theoreticalFocus: offset = A (offset, rotation) */
+    core::VecN<6> getRow(const core::Vector3& theoreticalFocus, int axis) const;
+
+    /** Copies the state to m_offset and m_rotation */
+    void updateOffset();
+
+    /** Sum of the squared distances between the observed foci and the fit */
+    double getSumSquaredResiduals() const;
+
+    /** Scale of the uncertainty (mm): the larger of the measurement noise and the scatter */
+    double getNoise() const;
+
+    std::vector<Observation> m_observations;
+    int m_numAccepted = 0;
+    bool m_isRotationEnabled = false;
+    double m_rotationDamping = 100.0;
+    double m_outlierThreshold = 3.0;
+    double m_measurementNoise = 1.0;
+
+    // recursive least-squares state: (offset, rotation) and its covariance, per unit of measurement variance
+    core::VecN<6> m_state;
+    core::MatN<6, 6> m_covariance;
+    double m_sumSquares = 0;            // weighted sum of the squared innovations
+
+    core::Vector3 m_reference;
+    core::Vector3 m_offset;
+    core::Vector3 m_rotation;
+};
+
+#endif // MUSECALIBRATION_H
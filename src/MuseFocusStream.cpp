@@ -0,0 +1,92 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseFocusStream.h"
+#include <algorithm>
+
+MuseFocusStream::MuseFocusStream(size_t capacity) : m_head(0), m_isNotified(false), m_window(1) {
+    size_t size = 2;
+    while (size < capacity)
+        size *= 2;
+    m_mask = size - 1;
+    m_slots.reset(new Slot[size]);
+    for (size_t i = 0; i < size; ++i)
+        m_slots[i].sequence.store(0, std::memory_order_relaxed);
+}
+
+void MuseFocusStream::push(const core::Vector3& focus) {
+    uint64_t position = m_head.load(std::memory_order_relaxed);
+    Slot& slot = m_slots[position & m_mask];
+    slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.x.store(focus[0], std::memory_order_relaxed);
+    slot.y.store(focus[1], std::memory_order_relaxed);
+    slot.z.store(focus[2], std::memory_order_relaxed);
+    slot.sequence.store(2 * position + 2, std::memory_order_release);
+    m_head.store(position + 1, std::memory_order_seq_cst);
+
+    // sequentially consistent with update(), which clears the flag before loading the head: either it reads
+    // this sample, or the consumer is notified again
+    if (m_notifier && !m_isNotified.exchange(true, std::memory_order_seq_cst))
+        m_notifier();
+}
+
+bool MuseFocusStream::update() {
+    bool isUpdated = false;
+    m_isNotified.store(false, std::memory_order_seq_cst);
+    uint64_t head = m_head.load(std::memory_order_seq_cst);
+    while (m_tail < head) {
+        // the producer has lapped us: the oldest samples are gone
+        if (head - m_tail > m_mask + 1) {
+            m_dropped += head - (m_mask + 1) - m_tail;
+            m_tail = head - (m_mask + 1);
+        }
+
+        // read the slot, then check that the producer did not overwrite it meanwhile
+        Slot& slot = m_slots[m_tail & m_mask];
+        uint64_t expected = 2 * m_tail + 2;
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        core::Vector3 focus(slot.x.load(std::memory_order_relaxed), slot.y.load(std::memory_order_relaxed),
+            slot.z.load(std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+        const uint64_t position = m_tail++;
+        if (before != expected || after != expected) {
+            ++m_dropped;
+            continue;
+        }
+
+        // by position, so that the dropped samples do not shift the phase
+        if ((position - m_decimationOrigin) % m_decimation != 0)
+            continue;
+        m_window[m_windowNext] = focus;
+        m_windowNext = (m_windowNext + 1) % m_window.size();
+        m_windowCount = std::min(m_windowCount + 1, m_window.size());
+        isUpdated = true;
+    }
+
+    if (isUpdated) {
+        core::Vector3 sum;
+        for (size_t i = 0; i < m_windowCount; ++i)
+            sum += m_window[i];
+        m_estimate = sum / (double)m_windowCount;
+    }
+    return isUpdated;
+}
+
+void MuseFocusStream::setDecimation(unsigned decimation) {
+    m_decimation = std::max(decimation, 1u);
+}
+
+void MuseFocusStream::setAveraging(unsigned averaging) {
+    m_window.assign(std::max(averaging, 1u), core::Vector3());
+    m_windowNext = m_windowCount = 0;
+}
+
+void MuseFocusStream::clear() {
+    std::fill(m_window.begin(), m_window.end(), core::Vector3());
+    m_windowNext = m_windowCount = 0;
+    m_decimationOrigin = m_tail;
+    m_estimate = core::Vector3();
+}
@@ -0,0 +1,100 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSEFOCUSSTREAM_H
+#define MUSEFOCUSSTREAM_H
+
+#include "../libs/libCore/Core/Maths/Vector3.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+* @brief Stream of observed foci from a single producer thread (e.g. per-slice MR thermometry, at hundreds
+* of Hz) to a single consumer (the model), reduced to one estimate of the focus.
+*
+* The producer pushes samples into a lock-free ring buffer and never blocks: when the consumer lags behind,
+* the oldest samples are overwritten (drop-oldest backpressure) and counted as dropped. Each slot carries a
+* sequence number, so the consumer detects a slot overwritten while it was being read and skips it.
+*
+* The consumer calls update() at its own pace. It keeps every decimation-th sample, by position in the stream
+* whether the others were read or dropped, and estimates the focus as the mean of the last averaging kept
+* samples. A consumer on another thread (e.g. a Qt event loop) is woken up by the notifier (see setNotifier),
+* called at most once between two updates.
+*/
+class MuseFocusStream
+{
+public:
+    /** Constructor. The capacity is rounded up to a power of two. */
+    explicit MuseFocusStream(size_t capacity = 1024);
+
+    /** Destructor */
+    ~MuseFocusStream() = default;
+
+    /** Producer: adds an observed focus. Never blocks, but for the notifier. */
+    void push(const core::Vector3& focus);
+
+    /**
+    * Called by push, on the producer's thread, for the first sample pushed since the last update(): the
+    * consumer then has pending samples. Set before the producer starts.
+    */
+    void setNotifier(std::function<void()> notifier) { m_notifier = notifier; }
+
+    /**
+    * Consumer: takes all the pending samples. Returns true if they changed the estimate (that is, if at least
+    * one sample was kept), false if there was nothing new.
+    */
+    bool update();
+
+    /** Consumer: the current estimate of the focus */
+    const core::Vector3& getEstimate() const { return m_estimate; }
+
+    /** Consumer: keep one sample every decimation samples (1 keeps them all) */
+    void setDecimation(unsigned decimation);
+
+    /** Consumer: number of kept samples averaged in the estimate (1 for the latest sample only) */
+    void setAveraging(unsigned averaging);
+
+    /**
+    * Consumer: forgets the estimate and the averaging window (pending samples are kept). The next sample
+    * read is kept, whatever the decimation.
+    */
+    void clear();
+
+    size_t getCapacity() const { return m_mask + 1; }
+
+    /** Number of samples pushed so far. Thread-safe. */
+    uint64_t getNumPushed() const { return m_head.load(std::memory_order_acquire); }
+
+    /** Consumer: number of samples overwritten before they were read */
+    uint64_t getNumDropped() const { return m_dropped; }
+
+private:
+    /** One sample. The fields are atomics so that an overwritten slot is a detected condition, not a data race. */
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;     // 2 * (position + 1) once written, odd while being written
+        std::atomic<double> x, y, z;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    std::atomic<uint64_t> m_head;           // next position to write, owned by the producer
+    std::function<void()> m_notifier;
+    std::atomic<bool> m_isNotified;         // set by push when it calls the notifier, cleared by update
+
+    // consumer side
+    uint64_t m_tail = 0;                    // next position to read
+    uint64_t m_dropped = 0;
+    uint64_t m_decimationOrigin = 0;        // position of a kept sample, the phase of the decimation
+    unsigned m_decimation = 1;
+    std::vector<core::Vector3> m_window;    // last kept samples, circular
+    size_t m_windowNext = 0;
+    size_t m_windowCount = 0;
+    core::Vector3 m_estimate;
+};
+
+#endif // MUSEFOCUSSTREAM_H
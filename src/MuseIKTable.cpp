@@ -0,0 +1,240 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseIKTable.h"
+#include "../libs/libCore/Core/Tools.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+namespace {
+
+/** Identifies the file format */
+const char IKTABLE_MAGIC[8] = { 'M', 'U', 'S', 'E', 'I', 'K', 'T', '1' };
+
+/** Largest number of nodes along an axis accepted from a file: 0.1 mm over the whole workspace */
+const int IKTABLE_MAX_DIM = 4096;
+
+} // namespace
+
+MuseIKTable::MuseIKTable(const MuseInverseKinematics& ik) : m_ik(ik) {}
+
+void MuseIKTable::build(const core::Vector3& min, const core::Vector3& max, double spacing, unsigned threadCount) {
+    m_origin = min;
+    m_spacing = spacing;
+    for (int d = 0; d < 3; ++d)
+        m_dims[d] = std::max(2, (int)std::ceil((max[d] - min[d]) / spacing - 1e-9) + 1);
+    m_settings.assign(getNumNodes() * MuseDOF::Count, 0.0f);
+
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // Every node is solved from the same seed (the default settings), so that neighbouring nodes tend to
+    // land on the same branch of solutions and interpolate well.
+    const double seed[MuseDOF::Count] = { 0, 0, 0, 20, 0, 0 };
+
+    // each thread solves every threadCount-th z slice
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.push_back(std::thread([this, t, threadCount, &seed]() {
+            for (int k = (int)t; k < m_dims[2]; k += (int)threadCount) {
+                for (int j = 0; j < m_dims[1]; ++j) {
+                    for (int i = 0; i < m_dims[0]; ++i) {
+                        core::Vector3 focus = m_origin + core::Vector3(i, j, k) * m_spacing;
+                        MuseIKResult res = m_ik.solve(focus, seed, core::Vector3());
+                        float* settings = &m_settings[(((size_t)k * m_dims[1] + j) * m_dims[0] + i) * MuseDOF::Count];
+                        for (int s = 0; s < MuseDOF::Count; ++s)
+                            settings[s] = res.converged ? (float)res.settings[s] : std::numeric_limits<float>::quiet_NaN();
+                    }
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+}
+
+void MuseIKTable::build(double spacing, unsigned threadCount) {
+    // bounding box of the foci reached over a coarse sweep of the limits (the trolleys and the L-slider
+    // act linearly, so their extreme values are enough)
+    const int steps[MuseDOF::Count] = { 9, 37, 5, 3, 2, 2 };
+    std::vector<double> values[MuseDOF::Count];
+    size_t n = 1;
+    for (int d = 0; d < MuseDOF::Count; ++d) {
+        MuseDOF::Index dof = MuseDOF::Index(d);
+        for (int s = 0; s < steps[d]; ++s)
+            values[d].push_back(m_ik.getMin(dof) + (m_ik.getMax(dof) - m_ik.getMin(dof)) * s / (steps[d] - 1));
+        n *= steps[d];
+    }
+    std::vector<double> sweep[MuseDOF::Count];
+    for (int d = 0; d < MuseDOF::Count; ++d)
+        sweep[d].resize(n);
+    for (size_t s = 0; s < n; ++s) {
+        size_t rest = s;
+        for (int d = 0; d < MuseDOF::Count; ++d) {
+            sweep[d][s] = values[d][rest % steps[d]];
+            rest /= steps[d];
+        }
+    }
+    MuseSettingsArrays settings = { sweep[MuseDOF::Psi].data(), sweep[MuseDOF::Theta].data(), sweep[MuseDOF::Alpha].data(),
+        sweep[MuseDOF::LSlider].data(), sweep[MuseDOF::XTrolley].data(), sweep[MuseDOF::ZTrolley].data() };
+    std::vector<double> x(n), y(n), z(n);
+    m_ik.getKinematics().calcScannerFocus(n, settings, core::Vector3(), x.data(), y.data(), z.data());
+
+    core::Vector3 min(*std::min_element(x.begin(), x.end()), *std::min_element(y.begin(), y.end()), *std::min_element(z.begin(), z.end()));
+    core::Vector3 max(*std::max_element(x.begin(), x.end()), *std::max_element(y.begin(), y.end()), *std::max_element(z.begin(), z.end()));
+    core::Vector3 margin(spacing, spacing, spacing);
+    build(min - margin, max + margin, spacing, threadCount);
+}
+
+std::vector<double> MuseIKTable::signature(const MuseInverseKinematics& ik) {
+    const MuseKinematics& k = ik.getKinematics();
+    std::vector<double> sig;
+    sig.push_back(k.getXFocus());
+    sig.push_back(k.getYFocus());
+    sig.push_back(k.getZFocus());
+    sig.push_back(k.getLNull());
+    sig.push_back(k.getXCent());
+    sig.push_back(k.getYCent());
+    sig.push_back(k.getZCent());
+    for (int d = 0; d < MuseDOF::Count; ++d) {
+        sig.push_back(ik.getMin(MuseDOF::Index(d)));
+        sig.push_back(ik.getMax(MuseDOF::Index(d)));
+        sig.push_back(ik.getWeight(MuseDOF::Index(d)));
+    }
+    sig.push_back(ik.getTolerance());
+    return sig;
+}
+
+bool MuseIKTable::save(const std::string& fileName) const {
+    std::ofstream file(fileName.c_str(), std::ios::binary);
+    if (!file)
+        return false;
+
+    std::vector<double> sig = signature(m_ik);
+    unsigned sigSize = (unsigned)sig.size();
+    file.write(IKTABLE_MAGIC, sizeof(IKTABLE_MAGIC));
+    file.write((const char*)&sigSize, sizeof(sigSize));
+    file.write((const char*)sig.data(), sig.size() * sizeof(double));
+    file.write((const char*)&m_origin[0], 3 * sizeof(double));
+    file.write((const char*)&m_spacing, sizeof(m_spacing));
+    file.write((const char*)m_dims, sizeof(m_dims));
+    file.write((const char*)m_settings.data(), m_settings.size() * sizeof(float));
+    return file.good();
+}
+
+bool MuseIKTable::load(const std::string& fileName) {
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    if (!file)
+        return false;
+
+    char magic[sizeof(IKTABLE_MAGIC)];
+    unsigned sigSize = 0;
+    file.read(magic, sizeof(magic));
+    file.read((char*)&sigSize, sizeof(sigSize));
+    std::vector<double> sig = signature(m_ik);
+    if (!file || std::memcmp(magic, IKTABLE_MAGIC, sizeof(magic)) || sigSize != sig.size())
+        return false;
+    std::vector<double> fileSig(sigSize);
+    file.read((char*)fileSig.data(), sigSize * sizeof(double));
+    if (!file || fileSig != sig)
+        return false;  // built for another configuration
+
+    core::Vector3 origin;
+    double spacing;
+    int dims[3];
+    file.read((char*)&origin[0], 3 * sizeof(double));
+    file.read((char*)&spacing, sizeof(spacing));
+    file.read((char*)dims, sizeof(dims));
+    if (!file || !(spacing > 0) || !std::isfinite(spacing) || !std::isfinite(origin[0]) || !std::isfinite(origin[1]) ||
+        !std::isfinite(origin[2]))
+        return false;
+    for (int d = 0; d < 3; ++d) {
+        if (dims[d] < 2 || dims[d] > IKTABLE_MAX_DIM)
+            return false;
+    }
+
+    // the nodes must fill the rest of the file exactly, before allocating them (in 64 bits: a 32-bit size_t
+    // overflows for the largest grids, which then can't be allocated anyway)
+    const uint64_t numSettings = (uint64_t)dims[0] * dims[1] * dims[2] * MuseDOF::Count;
+    if (numSettings > std::numeric_limits<size_t>::max() / sizeof(float))
+        return false;
+    const std::streamoff start = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streamoff end = file.tellg();
+    if (start < 0 || (uint64_t)(end - start) != numSettings * sizeof(float))
+        return false;
+    file.seekg(start);
+    std::vector<float> settings((size_t)numSettings);
+    file.read((char*)settings.data(), settings.size() * sizeof(float));
+    if (!file)
+        return false;
+
+    m_origin = origin;
+    m_spacing = spacing;
+    std::copy(dims, dims + 3, m_dims);
+    m_settings.swap(settings);
+    return true;
+}
+
+MuseIKResult MuseIKTable::lookup(const core::Vector3& scannerFocus, const core::Vector3& calibration) const {
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    // the calibration translates the scanner focus by (-x, y, z), see MuseKinematics::calcScannerFocus
+    core::Vector3 uncalibrated = scannerFocus - core::Vector3(-calibration[0], calibration[1], calibration[2]);
+    core::Vector3 position = (uncalibrated - m_origin) / m_spacing;
+
+    // cell containing the focus, and position within the cell
+    int cell[3];
+    double factor[3];
+    bool isInside = isValid();
+    for (int d = 0; d < 3 && isInside; ++d) {
+        cell[d] = (int)std::floor(position[d]);
+        isInside = cell[d] >= 0 && cell[d] < m_dims[d] - 1;
+        factor[d] = position[d] - cell[d];
+    }
+
+    double settings[MuseDOF::Count];
+    bool isInterpolated = isInside;
+    for (int s = 0; s < MuseDOF::Count && isInterpolated; ++s) {
+        int i = cell[0], j = cell[1], k = cell[2];
+        double values[8] = { node(i, j, k)[s], node(i, j, k + 1)[s], node(i, j + 1, k)[s], node(i, j + 1, k + 1)[s],
+            node(i + 1, j, k)[s], node(i + 1, j, k + 1)[s], node(i + 1, j + 1, k)[s], node(i + 1, j + 1, k + 1)[s] };
+        if (s == MuseDOF::Theta) {
+            // a full turn: nodes on both sides of 0/360 are close, unwrap them around the first one
+            for (int v = 1; v < 8; ++v)
+                values[v] += 360.0 * std::round((values[0] - values[v]) / 360.0);
+        }
+        settings[s] = core::interpTriLinear<double>(values[0], values[1], values[2], values[3], values[4], values[5],
+            values[6], values[7], factor[0], factor[1], factor[2]);
+        isInterpolated = !std::isnan(settings[s]);  // NaN if one of the nodes is not reachable
+    }
+    if (isInterpolated) {
+        // back within the limits of theta, if unwrapping took it out
+        double& theta = settings[MuseDOF::Theta];
+        if (theta < m_ik.getMin(MuseDOF::Theta) && theta + 360.0 <= m_ik.getMax(MuseDOF::Theta))
+            theta += 360.0;
+        else if (theta > m_ik.getMax(MuseDOF::Theta) && theta - 360.0 >= m_ik.getMin(MuseDOF::Theta))
+            theta -= 360.0;
+    }
+
+    MuseIKResult result;
+    if (isInterpolated) {
+        result = m_ik.refine(scannerFocus, settings, calibration);
+        result.converged = result.error < m_tolerance;
+    }
+    if (!result.converged) {
+        // outside the table, at the edge of the workspace, or across two branches of solutions
+        const double seed[MuseDOF::Count] = { 0, 0, 0, 20, 0, 0 };
+        result = m_ik.solve(scannerFocus, isInterpolated ? settings : seed, calibration);
+    }
+
+    result.solveTimeUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    return result;
+}
@@ -0,0 +1,104 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSEIKTABLE_H
+#define MUSEIKTABLE_H
+
+#include "MuseInverseKinematics.h"
+#include <string>
+#include <vector>
+
+/**
+* @brief Precomputed inverse kinematics over a 3D grid of desired foci.
+*
+* Each grid node stores the settings solved by MuseInverseKinematics for that scanner focus, or nothing
+* if the focus is not reachable. A lookup interpolates the settings of the eight nodes around the desired
+* focus (core::interpTriLinear, theta unwrapped across 0/360), then refines them with one Newton step. The
+* result is accepted if its focus is within the lookup tolerance of the desired focus (see setTolerance).
+* Otherwise (the cell straddles the edge of the workspace, or two branches of solutions) the lookup falls
+* back to a full solve seeded with the interpolated settings.
+*
+* The calibration only translates the scanner focus, so the table is built without calibration and the
+* desired focus is shifted at lookup time: a calibration change does not require a rebuild. The table does
+* depend on the transducer geometry, the limits and the weights of the solver; these are stored with the
+* table on disk and checked when it is loaded (see isBuiltFor).
+*
+* The table keeps a copy of the solver: changes of the limits afterwards require a new table. Lookups
+* interpolate the settings solved from the fixed seed of build (the default settings), whatever the current
+* settings: among the solutions, they favour the one nearest that seed. MuseTargetingModel uses the table
+* as an optional cache, see MuseTargetingModel::setIKTableFile.
+*/
+class MuseIKTable
+{
+public:
+    /** Constructor. The table is empty until built or loaded. */
+    explicit MuseIKTable(const MuseInverseKinematics& ik);
+
+    /** Destructor */
+    ~MuseIKTable() = default;
+
+    /**
+    * Solves every node of the grid, in parallel.
+    *
+    * @param min Scanner focus of the first node
+    * @param max Scanner focus bounding the grid; the last node may lie beyond, by less than spacing
+    * @param spacing Distance between nodes, in mm
+    * @param threadCount Number of threads, 0 to use all cores
+    */
+    void build(const core::Vector3& min, const core::Vector3& max, double spacing, unsigned threadCount = 0);
+
+    /** Builds the table over the whole workspace of the default Muse System settings limits. */
+    void build(double spacing, unsigned threadCount = 0);
+
+    /** Writes the table to a binary file. Returns false if the file can't be written. */
+    bool save(const std::string& fileName) const;
+
+    /**
+    * Reads the table from a binary file written by save. Returns false if the file can't be read, was
+    * built with another geometry, other limits or other weights, or its grid is invalid (spacing not
+    * positive, more than 4096 nodes along an axis, or not as many nodes as the file holds).
+    */
+    bool load(const std::string& fileName);
+
+    /** Whether the table was built or loaded */
+    bool isValid() const { return !m_settings.empty(); }
+
+    /** Whether the table was built for the geometry, limits, weights and tolerance of ik */
+    bool isBuiltFor(const MuseInverseKinematics& ik) const { return signature(ik) == signature(m_ik); }
+
+    /**
+    * A refined lookup is accepted if its focus is closer than tolerance (in mm) to the desired focus, otherwise
+    * the lookup falls back to a full solve (default 0.01 mm, well below what the operator can set).
+    */
+    void setTolerance(double tolerance) { m_tolerance = tolerance; }
+    double getTolerance() const { return m_tolerance; }
+
+    /**
+    * Suggested settings for the desired scanner focus (see MuseInverseKinematics::solve). converged means
+    * within the lookup tolerance if the refined interpolation was accepted, within the solver's otherwise.
+    */
+    MuseIKResult lookup(const core::Vector3& scannerFocus, const core::Vector3& calibration) const;
+
+    /** The solver used to build and refine the table. */
+    const MuseInverseKinematics& getSolver() const { return m_ik; }
+
+    size_t getNumNodes() const { return (size_t)m_dims[0] * m_dims[1] * m_dims[2]; }
+
+private:
+    MuseInverseKinematics m_ik;
+    double m_tolerance = 0.01;
+    core::Vector3 m_origin;
+    double m_spacing = 1.0;
+    int m_dims[3] = { 0, 0, 0 };
+    /** Settings of each node (MuseDOF::Count floats, x fastest), NaN if the node is not reachable */
+    std::vector<float> m_settings;
+
+    /** Settings stored at node (i, j, k) */
+    const float* node(int i, int j, int k) const { return &m_settings[(((size_t)k * m_dims[1] + j) * m_dims[0] + i) * MuseDOF::Count]; }
+
+    /** Solver configuration the table depends on, as stored in the file header */
+    static std::vector<double> signature(const MuseInverseKinematics& ik);
+};
+
+#endif // MUSEIKTABLE_H
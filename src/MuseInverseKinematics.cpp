@@ -0,0 +1,190 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseInverseKinematics.h"
+#include "../libs/libCore/Core/Tools.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+/**
+* Solves the 3x3 system A y = b by Cramer's rule. A is symmetric positive definite here, so replacing row k
+* by b is the same as replacing column k.
+*/
+core::Vector3 solve3(const core::Matrix3& A, const core::Vector3& b) {
+    double det = core::determinant(A);
+    core::Vector3 y;
+    for (int k = 0; k < 3; ++k) {
+        core::Matrix3 Ak(A);
+        Ak[k] = b;
+        y[k] = core::determinant(Ak) / det;
+    }
+    return y;
+}
+
+/** Outer product v v^T */
+core::Matrix3 outer(const core::Vector3& v) {
+    return core::Matrix3(v * v[0], v * v[1], v * v[2]);
+}
+
+} // namespace
+
+MuseInverseKinematics::MuseInverseKinematics(const MuseKinematics& kinematics) : m_kinematics(kinematics) {
+    // these are the default Muse System Settings limits
+    setLimits(MuseDOF::Psi, 0, 40);
+    setLimits(MuseDOF::Theta, 0, 360);
+    setLimits(MuseDOF::Alpha, -10, 10);
+    setLimits(MuseDOF::LSlider, 0, 40);
+    setLimits(MuseDOF::XTrolley, -20, 20);
+    setLimits(MuseDOF::ZTrolley, -20, 20);
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        m_weight[i] = 1.0;
+}
+
+void MuseInverseKinematics::setLimits(MuseDOF::Index dof, double min, double max) {
+    m_min[dof] = min;
+    m_max[dof] = max;
+}
+
+void MuseInverseKinematics::setWeight(MuseDOF::Index dof, double weight) {
+    m_weight[dof] = std::max(weight, 0.0);
+}
+
+MuseIKResult MuseInverseKinematics::solve(const core::Vector3& scannerFocus, const double initial[MuseDOF::Count],
+    const core::Vector3& calibration) const {
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    double q[MuseDOF::Count];
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        q[i] = core::getValueInRange(initial[i], m_min[i], m_max[i]);
+
+    MuseIKResult result;
+    iterate(scannerFocus, q, calibration, m_maxIterations, result);
+
+    // The limits make the problem non-convex: the solve can stop on a limit while the focus is reachable
+    // from elsewhere. Restart from the middle of the ranges, with theta turned by a quarter of its range
+    // each time, and keep the best solution.
+    for (int restart = 1; restart < 4 && !result.converged; ++restart) {
+        for (int i = 0; i < MuseDOF::Count; ++i)
+            q[i] = (m_weight[i] > 0) ? 0.5 * (m_min[i] + m_max[i]) : core::getValueInRange(initial[i], m_min[i], m_max[i]);
+        if (m_weight[MuseDOF::Theta] > 0) {
+            double range = m_max[MuseDOF::Theta] - m_min[MuseDOF::Theta];
+            double theta = core::getValueInRange(initial[MuseDOF::Theta], m_min[MuseDOF::Theta], m_max[MuseDOF::Theta]);
+            q[MuseDOF::Theta] = m_min[MuseDOF::Theta] + fmod(theta - m_min[MuseDOF::Theta] + 0.25 * restart * range, range);
+        }
+        MuseIKResult retry;
+        iterate(scannerFocus, q, calibration, m_maxIterations, retry);
+        retry.iterations += result.iterations;
+        if (retry.error < result.error)
+            result = retry;
+        else
+            result.iterations = retry.iterations;
+    }
+
+    result.solveTimeUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    return result;
+}
+
+MuseIKResult MuseInverseKinematics::refine(const core::Vector3& scannerFocus, const double settings[MuseDOF::Count],
+    const core::Vector3& calibration) const {
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    double q[MuseDOF::Count];
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        q[i] = core::getValueInRange(settings[i], m_min[i], m_max[i]);
+
+    MuseIKResult result;
+    iterate(scannerFocus, q, calibration, 1, result);
+
+    result.solveTimeUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    return result;
+}
+
+void MuseInverseKinematics::iterate(const core::Vector3& scannerFocus, double q[MuseDOF::Count],
+    const core::Vector3& calibration, int maxIterations, MuseIKResult& result) const {
+
+    core::Vector3 jacobian[MuseDOF::Count];
+    core::Vector3 focus = m_kinematics.calcScannerFocus(q, calibration, jacobian);
+    core::Vector3 e = scannerFocus - focus;
+    double error = e.length();
+
+    // Levenberg-Marquardt damping: small near the solution (Gauss-Newton), large when a step fails
+    double lambda = 1e-3;
+    for (int it = 0; it < maxIterations && error >= m_tolerance; ++it) {
+        double dq[MuseDOF::Count];
+        calcStep(q, jacobian, e, lambda, dq);
+
+        double qNew[MuseDOF::Count];
+        for (int i = 0; i < MuseDOF::Count; ++i)
+            qNew[i] = core::getValueInRange(q[i] + dq[i], m_min[i], m_max[i]);
+        core::Vector3 jacobianNew[MuseDOF::Count];
+        core::Vector3 focusNew = m_kinematics.calcScannerFocus(qNew, calibration, jacobianNew);
+        core::Vector3 eNew = scannerFocus - focusNew;
+        double errorNew = eNew.length();
+        ++result.iterations;
+
+        if (errorNew < error) {
+            std::copy(qNew, qNew + MuseDOF::Count, q);
+            std::copy(jacobianNew, jacobianNew + MuseDOF::Count, jacobian);
+            focus = focusNew;
+            e = eNew;
+            error = errorNew;
+            lambda = std::max(lambda * 0.3, 1e-9);
+        }
+        else {
+            lambda *= 10.0;
+            if (lambda > 1e6)  // no descent direction within the limits: the focus is not reachable
+                break;
+        }
+    }
+
+    std::copy(q, q + MuseDOF::Count, result.settings);
+    result.scannerFocus = focus;
+    result.error = error;
+    result.converged = error < m_tolerance;
+}
+
+void MuseInverseKinematics::calcStep(const double q[MuseDOF::Count], const core::Vector3 jacobian[MuseDOF::Count],
+    const core::Vector3& e, double lambda, double dq[MuseDOF::Count]) const {
+
+    bool isFree[MuseDOF::Count];
+    for (int i = 0; i < MuseDOF::Count; ++i) {
+        isFree[i] = m_weight[i] > 0;
+        dq[i] = 0;
+    }
+
+    // residual left to the free DOFs once the clamped ones have moved to their limit
+    core::Vector3 r = e;
+    for (int pass = 0; pass <= MuseDOF::Count; ++pass) {
+        // dq = W J^T (J W J^T + lambda I)^-1 r, over the free DOFs
+        core::Matrix3 A;
+        A[0][0] = A[1][1] = A[2][2] = lambda;
+        for (int i = 0; i < MuseDOF::Count; ++i) {
+            if (isFree[i])
+                A += outer(jacobian[i]) * m_weight[i];
+        }
+        core::Vector3 y = solve3(A, r);
+
+        bool isClamped = false;
+        for (int i = 0; i < MuseDOF::Count; ++i) {
+            if (!isFree[i])
+                continue;
+            dq[i] = m_weight[i] * (jacobian[i] * y);
+            double bounded = core::getValueInRange(q[i] + dq[i], m_min[i], m_max[i]);
+            if (bounded != q[i] + dq[i]) {
+                // move this DOF to its limit and hand the rest of the residual to the others
+                dq[i] = bounded - q[i];
+                r -= jacobian[i] * dq[i];
+                isFree[i] = false;
+                isClamped = true;
+            }
+        }
+        if (!isClamped)
+            return;
+    }
+}
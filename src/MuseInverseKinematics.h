@@ -0,0 +1,103 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSEINVERSEKINEMATICS_H
+#define MUSEINVERSEKINEMATICS_H
+
+#include "MuseKinematics.h"
+
+/** Outcome of one inverse kinematics solve. */
+struct MuseIKResult
+{
+    double settings[MuseDOF::Count] = {};  // solution, indexed by MuseDOF::Index
+    core::Vector3 scannerFocus;            // scanner focus reached by the solution
+    double error = 0;                      // distance between the reached and the desired focus, in mm
+    int iterations = 0;
+    bool converged = false;                // error is below the tolerance
+    double solveTimeUs = 0;                // wall-clock time of the solve, in microseconds
+};
+
+/**
+* @brief Iterative inverse kinematics of the Muse System.
+*
+* Finds the six Muse System settings that bring the scanner focus onto a desired position, starting from
+* an initial guess (typically the current settings). The system has six degrees of freedom for three
+* equations, so each iteration is a damped least-squares (Levenberg-Marquardt) step on the analytic
+* Jacobian of MuseKinematics. Among all the solutions it favours the one closest to the initial guess,
+* in the metric given by the per-DOF weights.
+*
+* The limits of each degree of freedom are enforced at every step: a DOF that would leave its range is
+* clamped and the step is recomputed with the remaining DOFs. If the solve stops on a limit short of the
+* desired focus, it is restarted from a few other seeds.
+*/
+class MuseInverseKinematics
+{
+public:
+    /**
+    * Constructor. Uses the default Muse System limits (see MuseTargetingSettings) and unit weights.
+    * The kinematics are copied.
+    */
+    explicit MuseInverseKinematics(const MuseKinematics& kinematics);
+
+    /** Destructor */
+    ~MuseInverseKinematics() = default;
+
+    /** Allowed range of a degree of freedom */
+    void setLimits(MuseDOF::Index dof, double min, double max);
+
+    /**
+    * Relative freedom of a degree of freedom: the larger the weight, the more it moves. A weight of 0 locks
+    * the degree of freedom to its initial value.
+    */
+    void setWeight(MuseDOF::Index dof, double weight);
+
+    /** The solve stops when the focus is closer than tolerance (in mm) to the desired focus. */
+    void setTolerance(double tolerance) { m_tolerance = tolerance; }
+
+    void setMaxIterations(int maxIterations) { m_maxIterations = maxIterations; }
+
+    double getMin(MuseDOF::Index dof) const { return m_min[dof]; }
+    double getMax(MuseDOF::Index dof) const { return m_max[dof]; }
+    double getWeight(MuseDOF::Index dof) const { return m_weight[dof]; }
+    double getTolerance() const { return m_tolerance; }
+    const MuseKinematics& getKinematics() const { return m_kinematics; }
+
+    /**
+    * Solves for the settings reaching a desired scanner focus.
+    *
+    * @param scannerFocus Desired focus, in scanner coordinates (see MuseKinematics::calcScannerFocus)
+    * @param initial Initial guess, indexed by MuseDOF::Index. Clamped to the limits.
+    * @param calibration Offset between the observed and theoretical focus
+    */
+    MuseIKResult solve(const core::Vector3& scannerFocus, const double initial[MuseDOF::Count],
+        const core::Vector3& calibration) const;
+
+    /**
+    * One Newton (damped least-squares) step from the given settings towards the desired scanner focus,
+    * within the limits. Used to refine an approximate solution, e.g. from a lookup table.
+    */
+    MuseIKResult refine(const core::Vector3& scannerFocus, const double settings[MuseDOF::Count],
+        const core::Vector3& calibration) const;
+
+private:
+    MuseKinematics m_kinematics;
+    double m_min[MuseDOF::Count];
+    double m_max[MuseDOF::Count];
+    double m_weight[MuseDOF::Count];
+    double m_tolerance = 1e-6;
+    int m_maxIterations = 50;
+
+    /**
+    * Computes a bounded damped least-squares step dq for the residual e, given the Jacobian at q.
+    * DOFs that would leave their range are clamped and excluded from the step.
+    */
+    void calcStep(const double q[MuseDOF::Count], const core::Vector3 jacobian[MuseDOF::Count],
+        const core::Vector3& e, double lambda, double dq[MuseDOF::Count]) const;
+
+    /** Runs at most maxIterations damped least-squares iterations from q, updating q and the result. */
+    void iterate(const core::Vector3& scannerFocus, double q[MuseDOF::Count], const core::Vector3& calibration,
+        int maxIterations, MuseIKResult& result) const;
+};
+
+#endif // MUSEINVERSEKINEMATICS_H
@@ -0,0 +1,288 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseKinematics.h"
+#include "../libs/libCore/Core/Tools.h"
+#include <cmath>
+
+#if defined(__AVX__)
+#  define MUSEKINEMATICS_AVX 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define MUSEKINEMATICS_SSE2 1
+#endif
+#if defined(MUSEKINEMATICS_AVX) || defined(MUSEKINEMATICS_SSE2)
+#  include <immintrin.h>
+#endif
+
+namespace {
+
+#if defined(MUSEKINEMATICS_AVX)
+/** 4 doubles per register */
+struct PackAVX
+{
+    typedef __m256d type;
+    enum { width = 4 };
+    static type load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, type v) { _mm256_storeu_pd(p, v); }
+    static type set1(double d) { return _mm256_set1_pd(d); }
+    static type add(type a, type b) { return _mm256_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm256_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm256_mul_pd(a, b); }
+    static type div(type a, type b) { return _mm256_div_pd(a, b); }
+    static type neg(type a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+    static type round(type a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static type eq(type a, type b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static type ge(type a, type b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+    static type maskOr(type a, type b) { return _mm256_or_pd(a, b); }
+    static type select(type mask, type a, type b) { return _mm256_blendv_pd(b, a, mask); }
+    static type negIf(type mask, type a) { return _mm256_xor_pd(a, _mm256_and_pd(mask, _mm256_set1_pd(-0.0))); }
+};
+#endif
+
+#if defined(MUSEKINEMATICS_SSE2)
+/** 2 doubles per register */
+struct PackSSE2
+{
+    typedef __m128d type;
+    enum { width = 2 };
+    static type load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, type v) { _mm_storeu_pd(p, v); }
+    static type set1(double d) { return _mm_set1_pd(d); }
+    static type add(type a, type b) { return _mm_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm_mul_pd(a, b); }
+    static type div(type a, type b) { return _mm_div_pd(a, b); }
+    static type neg(type a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+    /** To the nearest integer, for |a| < 2^51: SSE2 has no rounding instruction */
+    static type round(type a) {
+        const type magic = _mm_set1_pd(6755399441055744.0);  // 1.5 * 2^52
+        return _mm_sub_pd(_mm_add_pd(a, magic), magic);
+    }
+    static type eq(type a, type b) { return _mm_cmpeq_pd(a, b); }
+    static type ge(type a, type b) { return _mm_cmpge_pd(a, b); }
+    static type maskOr(type a, type b) { return _mm_or_pd(a, b); }
+    static type select(type mask, type a, type b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+    static type negIf(type mask, type a) { return _mm_xor_pd(a, _mm_and_pd(mask, _mm_set1_pd(-0.0))); }
+};
+#endif
+
+/** Returns a view of the settings starting at index i. */
+MuseSettingsArrays offsetSettings(const MuseSettingsArrays& s, size_t i) {
+    MuseSettingsArrays res = { s.psi + i, s.theta + i, s.alpha + i, s.LSlider + i, s.XTrolley + i, s.ZTrolley + i };
+    return res;
+}
+
+/**
+* Computes cos and sin of angles in degrees, in the registers: the angle is reduced by quadrants of 90 degrees
+* (exactly, in degrees), and the remainder, within +-pi/4 radians, goes through the minimax polynomials of the
+* Cephes library. Within a few ulps of the C library, but not bit-identical to it.
+*/
+template <class P>
+void cosSinDegrees(typename P::type deg, typename P::type& c, typename P::type& s) {
+    typedef typename P::type V;
+    // deg = 90 q + r, |r| <= 45
+    const V q = P::round(P::mul(deg, P::set1(1.0 / 90.0)));
+    const V x = P::mul(P::sub(deg, P::mul(q, P::set1(90.0))), P::set1(core::IGT_PI / 180.0));
+    const V x2 = P::mul(x, x);
+
+    V ps = P::set1(1.58962301576546568060E-10);
+    ps = P::add(P::mul(ps, x2), P::set1(-2.50507477628578072866E-8));
+    ps = P::add(P::mul(ps, x2), P::set1(2.75573136213857245213E-6));
+    ps = P::add(P::mul(ps, x2), P::set1(-1.98412698295895385996E-4));
+    ps = P::add(P::mul(ps, x2), P::set1(8.33333333332211858878E-3));
+    ps = P::add(P::mul(ps, x2), P::set1(-1.66666666666666307295E-1));
+    const V sinX = P::add(x, P::mul(P::mul(x, x2), ps));
+
+    V pc = P::set1(-1.13585365213876817300E-11);
+    pc = P::add(P::mul(pc, x2), P::set1(2.08757008419747316778E-9));
+    pc = P::add(P::mul(pc, x2), P::set1(-2.75573141792967388112E-7));
+    pc = P::add(P::mul(pc, x2), P::set1(2.48015872888517045348E-5));
+    pc = P::add(P::mul(pc, x2), P::set1(-1.38888888888730564116E-3));
+    pc = P::add(P::mul(pc, x2), P::set1(4.16666666666665929218E-2));
+    const V cosX = P::add(P::sub(P::set1(1.0), P::mul(P::set1(0.5), x2)), P::mul(P::mul(x2, x2), pc));
+
+    // quadrant q mod 4, from 0 to 3 (q / 4 - 0.375 is never halfway between two integers)
+    const V q4 = P::mul(P::sub(P::mul(q, P::set1(0.25)), P::round(P::sub(P::mul(q, P::set1(0.25)), P::set1(0.375)))),
+        P::set1(4.0));
+    const V isQ1 = P::eq(q4, P::set1(1.0)), isQ2 = P::eq(q4, P::set1(2.0)), isQ3 = P::eq(q4, P::set1(3.0));
+    const V isOdd = P::maskOr(isQ1, isQ3);
+    // sin(90 q + r): sin r, cos r, -sin r, -cos r; cos(90 q + r): cos r, -sin r, -cos r, sin r
+    s = P::negIf(P::ge(q4, P::set1(2.0)), P::select(isOdd, cosX, sinX));
+    c = P::negIf(P::maskOr(isQ1, isQ2), P::select(isOdd, sinX, cosX));
+}
+
+/**
+* SIMD forward kinematics. Every product of MuseKinematics::calcScannerFocus is evaluated in the same order,
+* including the products by the 0 and 1 entries of the rotations; only the trig differs (see cosSinDegrees).
+* Returns the number of settings processed (a multiple of the register width).
+*/
+template <class P>
+size_t scannerFocusKernel(size_t n, const MuseSettingsArrays& settings, const core::Vector3& calibration,
+    const MuseKinematics& k, double* x, double* y, double* z) {
+
+    typedef typename P::type V;
+    const V zero = P::set1(0.0);
+    const V one = P::set1(1.0);
+    const V minusOne = P::set1(-1.0);
+    const V xFocus = P::set1(k.getXFocus());
+    const V yFocus = P::set1(k.getYFocus());
+    const V zFocus = P::set1(k.getZFocus());
+    const V xCent = P::set1(k.getXCent());
+    const V yCent = P::set1(k.getYCent());
+    const V zCent = P::set1(k.getZCent());
+    const V cal0 = P::set1(calibration[0]);
+    const V cal1 = P::set1(calibration[1]);
+    const V cal2 = P::set1(calibration[2]);
+
+    size_t i = 0;
+    for (; i + P::width <= n; i += P::width) {
+        V cPsi, sPsi, cAlpha, sAlpha, cTheta, sTheta;
+        cosSinDegrees<P>(P::load(settings.psi + i), cPsi, sPsi);
+        cosSinDegrees<P>(P::load(settings.alpha + i), cAlpha, sAlpha);
+        cosSinDegrees<P>(P::load(settings.theta + i), cTheta, sTheta);
+
+        // R_alpha.dot(np.transpose(xyzin))
+        V t0 = P::add(P::add(P::mul(cAlpha, xFocus), P::mul(zero, yFocus)), P::mul(P::neg(sAlpha), zFocus));
+        V t1 = P::add(P::add(P::mul(zero, xFocus), P::mul(one, yFocus)), P::mul(zero, zFocus));
+        V t2 = P::add(P::add(P::mul(sAlpha, xFocus), P::mul(zero, yFocus)), P::mul(cAlpha, zFocus));
+        // xyzf_scanner2B = np.add(xyzf_scanner2A, (R_psi.dot(...)))
+        V b0 = P::add(xCent, P::add(P::add(P::mul(one, t0), P::mul(zero, t1)), P::mul(zero, t2)));
+        V b1 = P::add(yCent, P::add(P::add(P::mul(zero, t0), P::mul(cPsi, t1)), P::mul(sPsi, t2)));
+        V b2 = P::add(P::add(P::load(settings.LSlider + i), zCent),
+            P::add(P::add(P::mul(zero, t0), P::mul(P::neg(sPsi), t1)), P::mul(cPsi, t2)));
+        // xyzf_scanner2C = R_theta.dot(xyzf_scanner2B)
+        V c0 = P::add(P::add(P::mul(cTheta, b0), P::mul(zero, b1)), P::mul(sTheta, b2));
+        V c1 = P::add(P::add(P::mul(zero, b0), P::mul(one, b1)), P::mul(zero, b2));
+        V c2 = P::add(P::add(P::mul(P::neg(sTheta), b0), P::mul(zero, b1)), P::mul(cTheta, b2));
+        // xyzf_scanner = np.add(xyzf_scanner1, xyzf_scanner2)
+        P::store(x + i, P::add(P::mul(minusOne, P::sub(cal0, P::load(settings.XTrolley + i))), c0));
+        P::store(y + i, P::add(cal1, c1));
+        P::store(z + i, P::add(P::sub(cal2, P::load(settings.ZTrolley + i)), c2));
+    }
+    return i;
+}
+
+} // namespace
+
+MuseKinematics::MuseKinematics() {} // keep default geometry
+
+core::Vector3 MuseKinematics::calcScannerFocus(double psi, double theta, double alpha,
+    double LSlider, double XTrolley, double ZTrolley, const core::Vector3& calibration) const {
+
+    core::Matrix3 R_psi = rotationPsi(core::degToRad(psi));
+    core::Matrix3 R_alpha = rotationAlpha(core::degToRad(alpha));
+    core::Matrix3 R_theta = rotationTheta(core::degToRad(theta));
+
+    // xyzf_scanner1 = np.transpose(np.array([[-(par.xoff - par.xtrolley), par.yoff, par.zoff - par.ztrolley]]))
+    core::Vector3 xyzf_scanner1(
+        -1.0 * (calibration[0] - XTrolley),
+        calibration[1],
+        calibration[2] - ZTrolley);
+    // xyzf_scanner2A = np.transpose(np.array([[x_cent, y_cent, par.Lslider + z_cent]]))
+    core::Vector3 xyzf_scanner2A(m_xcent, m_ycent, LSlider + m_zcent);
+    // xyzin = np.reshape(xyzin, (1, 3))
+    core::Vector3 xyzin(m_xFocus, m_yFocus, m_zFocus);
+    // xyzf_scanner2B = np.add(xyzf_scanner2A, (R_psi.dot(R_alpha.dot(np.transpose(xyzin)))))
+    core::Vector3 xyzf_scanner2B = xyzf_scanner2A + R_psi * (R_alpha * xyzin);
+    // xyzf_scanner2C = R_theta.dot(xyzf_scanner2B)
+    // xyzf_scanner = np.add(xyzf_scanner1, xyzf_scanner2)
+    return xyzf_scanner1 + R_theta * xyzf_scanner2B;
+}
+
+core::Vector3 MuseKinematics::calcScannerFocus(const double settings[MuseDOF::Count], const core::Vector3& calibration,
+    core::Vector3 jacobian[MuseDOF::Count]) const {
+
+    double psiRadians = core::degToRad(settings[MuseDOF::Psi]);
+    double alphaRadians = core::degToRad(settings[MuseDOF::Alpha]);
+    double thetaRadians = core::degToRad(settings[MuseDOF::Theta]);
+    core::Matrix3 R_psi = rotationPsi(psiRadians);
+    core::Matrix3 R_alpha = rotationAlpha(alphaRadians);
+    core::Matrix3 R_theta = rotationTheta(thetaRadians);
+
+    // derivatives of the rotations with respect to their angle, in radians
+    double cPsi = cos(psiRadians), sPsi = sin(psiRadians);
+    double cAlpha = cos(alphaRadians), sAlpha = sin(alphaRadians);
+    double cTheta = cos(thetaRadians), sTheta = sin(thetaRadians);
+    core::Matrix3 dR_psi(
+        0.0, 0.0, 0.0,
+        0.0, -sPsi, cPsi,
+        0.0, -cPsi, -sPsi);
+    core::Matrix3 dR_alpha(
+        -sAlpha, 0.0, -cAlpha,
+        0.0, 0.0, 0.0,
+        cAlpha, 0.0, -sAlpha);
+    core::Matrix3 dR_theta(
+        -sTheta, 0.0, cTheta,
+        0.0, 0.0, 0.0,
+        -cTheta, 0.0, -sTheta);
+
+    core::Vector3 xyzf_scanner1(
+        -1.0 * (calibration[0] - settings[MuseDOF::XTrolley]),
+        calibration[1],
+        calibration[2] - settings[MuseDOF::ZTrolley]);
+    core::Vector3 xyzf_scanner2A(m_xcent, m_ycent, settings[MuseDOF::LSlider] + m_zcent);
+    core::Vector3 xyzin(m_xFocus, m_yFocus, m_zFocus);
+    core::Vector3 alphaFocus = R_alpha * xyzin;
+    core::Vector3 xyzf_scanner2B = xyzf_scanner2A + R_psi * alphaFocus;
+
+    const double perDegree = core::IGT_PI / 180.0;
+    jacobian[MuseDOF::Psi] = R_theta * (dR_psi * alphaFocus) * perDegree;
+    jacobian[MuseDOF::Theta] = dR_theta * xyzf_scanner2B * perDegree;
+    jacobian[MuseDOF::Alpha] = R_theta * (R_psi * (dR_alpha * xyzin)) * perDegree;
+    jacobian[MuseDOF::LSlider] = R_theta * core::Vector3(0.0, 0.0, 1.0);
+    jacobian[MuseDOF::XTrolley] = core::Vector3(1.0, 0.0, 0.0);
+    jacobian[MuseDOF::ZTrolley] = core::Vector3(0.0, 0.0, -1.0);
+
+    return xyzf_scanner1 + R_theta * xyzf_scanner2B;
+}
+
+core::Vector3 MuseKinematics::calcTheoreticalFocus(double psi, double theta, double alpha,
+    double LSlider, double XTrolley, double ZTrolley, const core::Vector3& calibration) const {
+
+    core::Vector3 xyzf_scanner = calcScannerFocus(psi, theta, alpha, LSlider, XTrolley, ZTrolley, calibration);
+
+    // MMK question: in Python MuseTargeting,
+    // xyzRAH = ['R', 'P', 'H']  # Changed L to R
+    // xyzRAHneg = ['L', 'A', 'F']  # Changed R to L
+    return core::Vector3(
+        -1 * std::round(xyzf_scanner[0]), // why?
+        std::round(xyzf_scanner[1]),
+        std::round(xyzf_scanner[2]));
+}
+
+void MuseKinematics::calcScannerFocus(size_t n, const MuseSettingsArrays& settings, const core::Vector3& calibration,
+    double* x, double* y, double* z) const {
+
+    size_t done = 0;
+#if defined(MUSEKINEMATICS_AVX)
+    done = scannerFocusKernel<PackAVX>(n, settings, calibration, *this, x, y, z);
+#elif defined(MUSEKINEMATICS_SSE2)
+    done = scannerFocusKernel<PackSSE2>(n, settings, calibration, *this, x, y, z);
+#endif
+    // remaining settings (or all of them, without SIMD)
+    calcScannerFocusScalar(n - done, offsetSettings(settings, done), calibration, x + done, y + done, z + done);
+}
+
+void MuseKinematics::calcScannerFocusScalar(size_t n, const MuseSettingsArrays& settings, const core::Vector3& calibration,
+    double* x, double* y, double* z) const {
+
+    for (size_t i = 0; i < n; ++i) {
+        core::Vector3 f = calcScannerFocus(settings.psi[i], settings.theta[i], settings.alpha[i],
+            settings.LSlider[i], settings.XTrolley[i], settings.ZTrolley[i], calibration);
+        x[i] = f[0];
+        y[i] = f[1];
+        z[i] = f[2];
+    }
+}
+
+const char* MuseKinematics::simdKernelName() {
+#if defined(MUSEKINEMATICS_AVX)
+    return "AVX";
+#elif defined(MUSEKINEMATICS_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
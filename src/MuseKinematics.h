@@ -0,0 +1,177 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSEKINEMATICS_H
+#define MUSEKINEMATICS_H
+
+#include "../libs/libCore/Core/Maths/Vector3.h"
+#include "../libs/libCore/Core/Maths/Matrix3.h"
+#include <cstddef>
+
+/** Index of the six Muse System degrees of freedom, in the order used throughout Muse Targeting. */
+struct MuseDOF
+{
+    enum Index {
+        Psi = 0,
+        Theta,
+        Alpha,
+        LSlider,
+        XTrolley,
+        ZTrolley,
+        Count
+    };
+};
+
+/**
+* @brief Structure-of-arrays view over N Muse System settings, used by the batch kinematics.
+*
+* The arrays are owned by the caller and must each hold at least N values.
+*/
+struct MuseSettingsArrays
+{
+    const double* psi;
+    const double* theta;
+    const double* alpha;
+    const double* LSlider;
+    const double* XTrolley;
+    const double* ZTrolley;
+};
+
+/**
+* @brief Forward kinematics of the Muse System transducer.
+*
+* Computes the geometric focus in scanner coordinates from the six Muse System settings (psi, theta and
+* alpha in degrees, L-slider, X-trolley and Z-trolley in mm) and the current calibration offset.
+*
+* This class holds no UI and does not depend on Qt. All intermediate rotations and vectors are fixed-size
+* core::Matrix3/core::Vector3 values living on the stack, so a call performs no heap allocation and can be
+* used in tight loops (workspace sweeps, reach checking, inverse kinematics).
+*
+* The calculations were translated directly from Muse Targeting v7 (Python).
+*/
+class MuseKinematics
+{
+public:
+    /** Constructor. Uses the default Muse System transducer geometry. */
+    MuseKinematics();
+
+    /** Destructor */
+    ~MuseKinematics() = default;
+
+    /**
+    * Geometric focus in scanner coordinates (xyzf_scanner in Muse Targeting Python), not rounded.
+    *
+    * @param psi Psi setting, in degrees
+    * @param theta Theta setting, in degrees
+    * @param alpha Alpha setting, in degrees
+    * @param LSlider L-slider setting, in mm
+    * @param XTrolley X-trolley setting, in mm
+    * @param ZTrolley Z-trolley setting, in mm
+    * @param calibration Offset between the observed and theoretical focus
+    */
+    core::Vector3 calcScannerFocus(double psi, double theta, double alpha,
+        double LSlider, double XTrolley, double ZTrolley, const core::Vector3& calibration) const;
+
+    /**
+    * Scanner focus and its analytic Jacobian.
+    *
+    * @param settings The six settings, indexed by MuseDOF::Index
+    * @param calibration Offset between the observed and theoretical focus
+    * @param jacobian Receives the derivative of the scanner focus with respect to each setting (indexed by
+    *  MuseDOF::Index), per degree for the angles and per mm for the L-slider and trolleys.
+    */
+    core::Vector3 calcScannerFocus(const double settings[MuseDOF::Count], const core::Vector3& calibration,
+        core::Vector3 jacobian[MuseDOF::Count]) const;
+
+    /**
+    * Theoretical focus as displayed by Muse Targeting: the scanner focus rounded to the nearest mm, with
+    * x negated (see calcScannerFocus for the parameters).
+    */
+    core::Vector3 calcTheoreticalFocus(double psi, double theta, double alpha,
+        double LSlider, double XTrolley, double ZTrolley, const core::Vector3& calibration) const;
+
+    /**
+    * Batch version of calcScannerFocus over n settings in structure-of-arrays layout. Writes the n scanner
+    * foci to x, y and z. Uses the AVX or SSE2 kernel when the build enables it (see simdKernelName),
+    * otherwise falls back to calcScannerFocusScalar. The default build runs the SSE2 kernel on x64 and the
+    * scalar one elsewhere; the AVX kernel needs the MUSE_ENABLE_AVX CMake option (AVX2 and FMA builds).
+    * The kernels compute cos and sin in the registers as well, with polynomials a few ulps from the C
+    * library, and the compiler may contract the scalar products and sums into multiply-adds (e.g.
+    * -ffp-contract=fast with FMA) but not the intrinsics: their foci match calcScannerFocus to about
+    * 1e-12 mm, not bit for bit. The scalar fallback calls calcScannerFocus, so it gives its results.
+    */
+    void calcScannerFocus(size_t n, const MuseSettingsArrays& settings, const core::Vector3& calibration,
+        double* x, double* y, double* z) const;
+
+    /** Scalar reference for the batch kinematics: calls calcScannerFocus for each of the n settings. */
+    void calcScannerFocusScalar(size_t n, const MuseSettingsArrays& settings, const core::Vector3& calibration,
+        double* x, double* y, double* z) const;
+
+    /** Name of the SIMD kernel used by the batch kinematics: "AVX", "SSE2" or "scalar". */
+    static const char* simdKernelName();
+
+    /** Transducer geometry */
+    double getXFocus() const { return m_xFocus; }
+    double getYFocus() const { return m_yFocus; }
+    double getZFocus() const { return m_zFocus; }
+    double getLNull() const { return m_Lnull; }
+    double getXCent() const { return m_xcent; }
+    double getYCent() const { return m_ycent; }
+    double getZCent() const { return m_zcent; }
+
+    /** Rotation matrices used by the Muse System, angles in radians. */
+    static core::Matrix3 rotationPsi(double psiRadians);
+    static core::Matrix3 rotationAlpha(double alphaRadians);
+    static core::Matrix3 rotationTheta(double thetaRadians);
+
+private:
+    /** other Muse System variables from MuseTargeting Python */
+    double m_xFocus = 0.0;    // default focus of transducer?
+    double m_yFocus = 0.0;    // default focus of transducer?
+    double m_zFocus = 106.8;  // default focus of transducer?
+    double m_Lnull  = 20.2;
+    double m_xcent  = 0;
+    double m_ycent  = -55;
+    double m_zcent  = -1.0 * (m_zFocus + m_Lnull);
+};
+
+// --- Inlines ----------------------------------------------------------------
+
+inline core::Matrix3 MuseKinematics::rotationPsi(double psiRadians) {
+    //R_psi = np.array(
+        //[[1.0, 0.0, 0.0], [0.0, math.cos(math.radians(par.psi)), math.sin(math.radians(par.psi))],
+        //[0.0, -math.sin(math.radians(par.psi)), math.cos(math.radians(par.psi))]] )
+    double c = cos(psiRadians);
+    double s = sin(psiRadians);
+    return core::Matrix3(
+        1.0, 0.0, 0.0,
+        0.0, c, s,
+        0.0, -s, c);
+}
+
+inline core::Matrix3 MuseKinematics::rotationAlpha(double alphaRadians) {
+    //R_alpha = np.array(
+        //[[math.cos(math.radians(par.alpha)), 0.0, -math.sin(math.radians(par.alpha))], [0.0, 1.0, 0.0],
+        //[math.sin(math.radians(par.alpha)), 0.0, math.cos(math.radians(par.alpha))]] )
+    double c = cos(alphaRadians);
+    double s = sin(alphaRadians);
+    return core::Matrix3(
+        c, 0.0, -s,
+        0.0, 1.0, 0.0,
+        s, 0.0, c);
+}
+
+inline core::Matrix3 MuseKinematics::rotationTheta(double thetaRadians) {
+    //R_theta = np.array(
+        //[[math.cos(math.radians(par.theta)), 0.0, math.sin(math.radians(par.theta))], [0.0, 1.0, 0.0],
+        //[-math.sin(math.radians(par.theta)), 0.0, math.cos(math.radians(par.theta))]] )
+    double c = cos(thetaRadians);
+    double s = sin(thetaRadians);
+    return core::Matrix3(
+        c, 0.0, s,
+        0.0, 1.0, 0.0,
+        -s, 0.0, c);
+}
+
+#endif // MUSEKINEMATICS_H
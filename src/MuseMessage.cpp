@@ -0,0 +1,140 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseMessage.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+void writeUInt(uint8_t* p, uint64_t value, int size) {
+    for (int i = 0; i < size; ++i)
+        p[i] = uint8_t(value >> (8 * i));
+}
+
+uint64_t readUInt(const uint8_t* p, int size) {
+    uint64_t value = 0;
+    for (int i = 0; i < size; ++i)
+        value |= uint64_t(p[i]) << (8 * i);
+    return value;
+}
+
+} // namespace
+
+const uint8_t MuseMessage::Version;
+const size_t MuseMessage::HeaderSize;
+const size_t MuseMessage::MaxSize;
+const char* const MuseMessage::ServerName = "MuseTargeting";
+
+MuseMessage MuseMessage::makeFocus(Type type, const core::Vector3& focus) {
+    MuseMessage message;
+    message.type = type;
+    for (int i = 0; i < 3; ++i)
+        message.values[i] = focus[i];
+    return message;
+}
+
+MuseMessage MuseMessage::makeSettings(Type type, const SettingsSnapshot& settings) {
+    MuseMessage message;
+    message.type = type;
+    std::memcpy(message.values, settings.values, sizeof(message.values));
+    return message;
+}
+
+SettingsSnapshot MuseMessage::getSettings() const {
+    SettingsSnapshot settings;
+    std::memcpy(settings.values, values, sizeof(settings.values));
+    return settings;
+}
+
+int MuseMessage::getNumValues(uint8_t type) {
+    switch (type) {
+    case ObservedFocus:
+    case DesiredFocus:
+        return 3;
+    case CurrentSettings:
+    case SuggestedSettings:
+        return MuseDOF::Count;
+    case Reset:
+    case Ping:
+    case Pong:
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+size_t MuseMessage::encode(uint8_t* buffer) const {
+    buffer[0] = 'M';
+    buffer[1] = 'T';
+    buffer[2] = Version;
+    buffer[3] = type;
+    writeUInt(buffer + 4, sequence, 4);
+    writeUInt(buffer + 8, timestamp, 8);
+    int numValues = getNumValues(type);
+    for (int i = 0; i < numValues; ++i) {
+        uint64_t bits;
+        std::memcpy(&bits, &values[i], sizeof(bits));
+        writeUInt(buffer + HeaderSize + 8 * i, bits, 8);
+    }
+    return HeaderSize + 8 * numValues;
+}
+
+void MuseMessage::encode(std::vector<uint8_t>& buffer) const {
+    size_t size = buffer.size();
+    buffer.resize(size + getSize());
+    encode(&buffer[size]);
+}
+
+uint64_t MuseMessage::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void MuseMessageReader::append(const char* data, size_t size) {
+    if (m_hasError)
+        return;
+    // drop the messages already taken before growing the buffer
+    if (m_offset > 0) {
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_offset);
+        m_offset = 0;
+    }
+    m_buffer.insert(m_buffer.end(), data, data + size);
+}
+
+bool MuseMessageReader::next(MuseMessage& message) {
+    if (m_hasError || m_buffer.size() - m_offset < MuseMessage::HeaderSize)
+        return false;
+    const uint8_t* p = &m_buffer[m_offset];
+    int numValues = MuseMessage::getNumValues(p[3]);
+    if (p[0] != 'M' || p[1] != 'T' || p[2] != MuseMessage::Version || numValues < 0) {
+        m_hasError = true;
+        return false;
+    }
+    size_t size = MuseMessage::HeaderSize + 8 * numValues;
+    if (m_buffer.size() - m_offset < size)
+        return false;
+
+    message = MuseMessage();
+    message.type = MuseMessage::Type(p[3]);
+    message.sequence = uint32_t(readUInt(p + 4, 4));
+    message.timestamp = readUInt(p + 8, 8);
+    for (int i = 0; i < numValues; ++i) {
+        uint64_t bits = readUInt(p + MuseMessage::HeaderSize + 8 * i, 8);
+        std::memcpy(&message.values[i], &bits, sizeof(bits));
+        if (!std::isfinite(message.values[i])) {
+            m_hasError = true;
+            return false;
+        }
+    }
+    m_offset += size;
+    return true;
+}
+
+void MuseMessageReader::clear() {
+    m_buffer.clear();
+    m_offset = 0;
+    m_hasError = false;
+}
@@ -0,0 +1,109 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSEMESSAGE_H
+#define MUSEMESSAGE_H
+
+#include "MuseTargetingSettings.h"
+#include "../libs/libCore/Core/Maths/Vector3.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+* @brief Message exchanged between Muse Targeting and its clients (Thermoguide, PseudoTGDriver) over the local
+* transport, see MuseTargetingServer and MuseTargetingClient.
+*
+* Compact binary format, little-endian whatever the platform:
+*  - bytes 0-1:   magic "MT"
+*  - byte 2:      format version
+*  - byte 3:      type
+*  - bytes 4-7:   sequence number, per sender
+*  - bytes 8-15:  timestamp of the sender, in microseconds (see now())
+*  - bytes 16-:   the values of the type (see getNumValues), IEEE-754 doubles
+*
+* A focus message is 40 bytes, a settings message 64 bytes. The same format is used for files of recorded
+* messages, which PseudoTGDriver can replay.
+*/
+struct MuseMessage
+{
+    enum Type : uint8_t {
+        ObservedFocus     = 1,  // x, y, z (mm)
+        CurrentSettings   = 2,  // the six settings, in the order of MuseDOF::Index
+        DesiredFocus      = 3,  // x, y, z (mm)
+        Reset             = 4,  // no value
+        SuggestedSettings = 5,  // the six settings, sent by Muse Targeting when they change
+        Ping              = 6,  // no value, answered with a Pong carrying the same sequence and timestamp
+        Pong              = 7
+    };
+
+    static const uint8_t Version = 1;
+    static const size_t HeaderSize = 16;
+    static const size_t MaxSize = HeaderSize + MuseDOF::Count * sizeof(double);
+
+    /** Name of the local server Muse Targeting listens on */
+    static const char* const ServerName;
+
+    Type type = Ping;
+    uint32_t sequence = 0;
+    uint64_t timestamp = 0;
+    double values[MuseDOF::Count] = {};
+
+    /** Focus message (ObservedFocus or DesiredFocus) */
+    static MuseMessage makeFocus(Type type, const core::Vector3& focus);
+
+    /** Settings message (CurrentSettings or SuggestedSettings) */
+    static MuseMessage makeSettings(Type type, const SettingsSnapshot& settings);
+
+    core::Vector3 getFocus() const { return core::Vector3(values[0], values[1], values[2]); }
+    SettingsSnapshot getSettings() const;
+
+    /** Number of values carried by messages of type, -1 if type is unknown */
+    static int getNumValues(uint8_t type);
+
+    /** Size of the message in bytes, once encoded */
+    size_t getSize() const { return HeaderSize + getNumValues(type) * sizeof(double); }
+
+    /** Encodes the message into buffer, which must hold getSize() bytes. Returns the size. */
+    size_t encode(uint8_t* buffer) const;
+
+    /** Appends the encoded message to buffer */
+    void encode(std::vector<uint8_t>& buffer) const;
+
+    /** Monotonic clock for the timestamps, in microseconds. Shared by the processes of the same machine. */
+    static uint64_t now();
+};
+
+/**
+* @brief Splits a byte stream back into MuseMessage's.
+*
+* Bytes are appended as they arrive, in chunks of any size; next() returns the complete messages. A stream that
+* is not made of messages (wrong magic, version or type), or a message with a NaN or infinite value, is an
+* error: the reader stops, and the connection should be closed.
+*/
+class MuseMessageReader
+{
+public:
+    /** Constructor */
+    MuseMessageReader() = default;
+
+    /** Adds received bytes */
+    void append(const char* data, size_t size);
+
+    /** Takes the next complete message. Returns false if there is none yet, or if the stream is invalid. */
+    bool next(MuseMessage& message);
+
+    /** Whether the stream is invalid */
+    bool hasError() const { return m_hasError; }
+
+    /** Forgets the pending bytes and the error */
+    void clear();
+
+private:
+    std::vector<uint8_t> m_buffer;
+    size_t m_offset = 0;                // start of the first message not taken yet
+    bool m_hasError = false;
+};
+
+#endif // MUSEMESSAGE_H
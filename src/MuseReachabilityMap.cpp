@@ -0,0 +1,186 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseReachabilityMap.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+namespace {
+
+/** Number of bits set in a word */
+int popCount(uint64_t w) {
+    int n = 0;
+    for (; w; w &= w - 1)
+        ++n;
+    return n;
+}
+
+} // namespace
+
+MuseReachabilityMap::MuseReachabilityMap(const MuseKinematics& kinematics) : m_kinematics(kinematics) {
+    // these are the default Muse System Settings limits
+    setLimits(MuseDOF::Psi, 0, 40);
+    setLimits(MuseDOF::Theta, 0, 360);
+    setLimits(MuseDOF::Alpha, -10, 10);
+    setLimits(MuseDOF::LSlider, 0, 40);
+    setLimits(MuseDOF::XTrolley, -20, 20);
+    setLimits(MuseDOF::ZTrolley, -20, 20);
+}
+
+void MuseReachabilityMap::setLimits(MuseDOF::Index dof, double min, double max) {
+    m_min[dof] = min;
+    m_max[dof] = max;
+}
+
+void MuseReachabilityMap::build(double voxelSize, unsigned threadCount) {
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    m_voxelSize = voxelSize;
+
+    // Coarse scalar sweep of the rotations and the L-slider (trolleys at 0): bounding box of the foci, and
+    // the largest displacement of the focus per unit of each setting (norm of the Jacobian columns).
+    const int coarse[4] = { 9, 37, 5, 3 };
+    core::Vector3 lo(1e30, 1e30, 1e30), hi(-1e30, -1e30, -1e30);
+    double rate[MuseDOF::Count] = {};
+    for (int s = 0; s < coarse[0] * coarse[1] * coarse[2] * coarse[3]; ++s) {
+        double q[MuseDOF::Count] = {};
+        int rest = s;
+        for (int d = 0; d < 4; ++d) {
+            q[d] = m_min[d] + (m_max[d] - m_min[d]) * (rest % coarse[d]) / (coarse[d] - 1);
+            rest /= coarse[d];
+        }
+        core::Vector3 jacobian[MuseDOF::Count];
+        core::Vector3 f = m_kinematics.calcScannerFocus(q, core::Vector3(), jacobian);
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = std::min(lo[a], f[a]);
+            hi[a] = std::max(hi[a], f[a]);
+        }
+        for (int d = 0; d < 4; ++d)
+            rate[d] = std::max(rate[d], jacobian[d].length());
+    }
+
+    // Range of the translation by the trolleys, in voxels along x and z
+    core::Vector3 f0 = m_kinematics.calcScannerFocus(0, 0, 0, 0, 0, 0, core::Vector3());
+    core::Vector3 tMin = m_kinematics.calcScannerFocus(0, 0, 0, 0, m_min[MuseDOF::XTrolley], m_min[MuseDOF::ZTrolley], core::Vector3()) - f0;
+    core::Vector3 tMax = m_kinematics.calcScannerFocus(0, 0, 0, 0, m_max[MuseDOF::XTrolley], m_max[MuseDOF::ZTrolley], core::Vector3()) - f0;
+    int shiftLo[3], shiftHi[3];
+    for (int a = 0; a < 3; ++a) {
+        shiftLo[a] = (int)std::floor(std::min(tMin[a], tMax[a]) / voxelSize + 0.5);
+        shiftHi[a] = (int)std::floor(std::max(tMin[a], tMax[a]) / voxelSize + 0.5);
+    }
+
+    // Grid: the coarse box, with a margin for the extremes missed by the coarse sweep, extended by the trolleys
+    const double margin = voxelSize + 2.0;
+    for (int a = 0; a < 3; ++a) {
+        m_origin[a] = lo[a] - margin + shiftLo[a] * voxelSize;
+        m_dims[a] = (int)std::ceil((hi[a] - lo[a] + 2 * margin) / voxelSize) + 1 + shiftHi[a] - shiftLo[a];
+    }
+    m_rowWords = (m_dims[1] + 63) / 64;
+    const size_t numWords = (size_t)m_dims[0] * m_dims[2] * m_rowWords;
+
+    // Fine sweep: neighbouring samples are less than half a voxel apart
+    int count[4];
+    for (int d = 0; d < 4; ++d) {
+        double step = rate[d] > 0 ? 0.5 * voxelSize / (1.05 * rate[d]) : m_max[d] - m_min[d];
+        count[d] = m_max[d] > m_min[d] ? (int)std::ceil((m_max[d] - m_min[d]) / step) + 1 : 1;
+    }
+    std::function<double(int, int)> sample = [&](int d, int s) {
+        return count[d] > 1 ? m_min[d] + (m_max[d] - m_min[d]) * s / (count[d] - 1) : m_min[d];
+    };
+    const int batch = count[MuseDOF::Alpha] * count[MuseDOF::LSlider];
+    const size_t numItems = (size_t)count[MuseDOF::Psi] * count[MuseDOF::Theta];
+
+    // each thread takes (psi, theta) pairs and marks its own volume, merged at the end
+    std::atomic<size_t> next(0);
+    std::vector<std::vector<uint64_t> > volumes(threadCount);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.push_back(std::thread([&, t]() {
+            std::vector<uint64_t>& bits = volumes[t];
+            bits.assign(numWords, 0);
+            std::vector<double> psi(batch), theta(batch), alpha(batch), LSlider(batch), trolley(batch, 0.0);
+            std::vector<double> x(batch), y(batch), z(batch);
+            for (int a = 0; a < count[MuseDOF::Alpha]; ++a) {
+                for (int l = 0; l < count[MuseDOF::LSlider]; ++l) {
+                    alpha[a * count[MuseDOF::LSlider] + l] = sample(MuseDOF::Alpha, a);
+                    LSlider[a * count[MuseDOF::LSlider] + l] = sample(MuseDOF::LSlider, l);
+                }
+            }
+            MuseSettingsArrays settings = { psi.data(), theta.data(), alpha.data(), LSlider.data(), trolley.data(), trolley.data() };
+
+            for (size_t item = next++; item < numItems; item = next++) {
+                std::fill(psi.begin(), psi.end(), sample(MuseDOF::Psi, (int)(item / count[MuseDOF::Theta])));
+                std::fill(theta.begin(), theta.end(), sample(MuseDOF::Theta, (int)(item % count[MuseDOF::Theta])));
+                m_kinematics.calcScannerFocus(batch, settings, core::Vector3(), x.data(), y.data(), z.data());
+                for (int s = 0; s < batch; ++s) {
+                    int i = (int)std::floor((x[s] - m_origin[0]) / voxelSize + 0.5) + shiftLo[0];
+                    int j = (int)std::floor((y[s] - m_origin[1]) / voxelSize + 0.5);
+                    int k = (int)std::floor((z[s] - m_origin[2]) / voxelSize + 0.5) + shiftLo[2];
+                    if (i >= 0 && i < m_dims[0] && j >= 0 && j < m_dims[1] && k >= 0 && k < m_dims[2])
+                        bits[row(i, k) + (j >> 6)] |= uint64_t(1) << (j & 63);
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    std::vector<uint64_t> swept(volumes[0]);
+    for (size_t t = 1; t < volumes.size(); ++t)
+        for (size_t w = 0; w < numWords; ++w)
+            swept[w] |= volumes[t][w];
+
+    // The foci were marked at trolleys = min, shifted by shiftLo; the dilation covers the rest of their range
+    std::vector<uint64_t> dilated(numWords, 0);
+    dilate(swept, dilated, 0, 0, shiftHi[0] - shiftLo[0]);
+    m_bits.assign(numWords, 0);
+    dilate(dilated, m_bits, 2, 0, shiftHi[2] - shiftLo[2]);
+
+    m_numFoci = numItems * batch;
+    m_buildTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void MuseReachabilityMap::dilate(const std::vector<uint64_t>& src, std::vector<uint64_t>& bits, int axis, int lo, int hi) const {
+    for (int i = 0; i < m_dims[0]; ++i) {
+        for (int k = 0; k < m_dims[2]; ++k) {
+            uint64_t* dst = &bits[row(i, k)];
+            for (int shift = lo; shift <= hi; ++shift) {
+                int si = axis == 0 ? i - shift : i;
+                int sk = axis == 2 ? k - shift : k;
+                if (si < 0 || si >= m_dims[0] || sk < 0 || sk >= m_dims[2])
+                    continue;
+                const uint64_t* s = &src[row(si, sk)];
+                for (size_t w = 0; w < m_rowWords; ++w)
+                    dst[w] |= s[w];
+            }
+        }
+    }
+}
+
+bool MuseReachabilityMap::isReachable(const core::Vector3& scannerFocus, const core::Vector3& calibration) const {
+    if (!isValid())
+        return false;
+
+    // the calibration translates the scanner focus by (-x, y, z), see MuseKinematics::calcScannerFocus
+    core::Vector3 uncalibrated = scannerFocus - core::Vector3(-calibration[0], calibration[1], calibration[2]);
+    int voxel[3];
+    for (int a = 0; a < 3; ++a) {
+        voxel[a] = (int)std::floor((uncalibrated[a] - m_origin[a]) / m_voxelSize + 0.5);
+        if (voxel[a] < 0 || voxel[a] >= m_dims[a])
+            return false;
+    }
+    return isReachable(voxel[0], voxel[1], voxel[2]);
+}
+
+size_t MuseReachabilityMap::getNumReachable() const {
+    size_t n = 0;
+    for (size_t w = 0; w < m_bits.size(); ++w)
+        n += popCount(m_bits[w]);
+    return n;
+}
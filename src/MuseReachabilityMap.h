@@ -0,0 +1,100 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSEREACHABILITYMAP_H
+#define MUSEREACHABILITYMAP_H
+
+#include "MuseKinematics.h"
+#include <cstdint>
+#include <vector>
+
+/**
+* @brief Voxelized map of the scanner foci the Muse System can reach.
+*
+* The map is built by sweeping the settings between their limits through the batch forward kinematics
+* (MuseKinematics::calcScannerFocus) and marking the voxel of every focus. Angles are sampled finely enough
+* that two neighbouring foci are less than half a voxel apart, so the swept surfaces leave no holes.
+*
+* The trolleys only translate the focus along x and z, so they are not swept: the map of the rotations and
+* the L-slider is dilated by the range of the trolleys instead, which is exact at the voxel scale and saves
+* two nested loops.
+*
+* A voxel is reachable if at least one swept focus falls in it, so the map answers at the precision of the
+* voxel size: use it to reject a desired focus before solving the inverse kinematics, not as a substitute.
+* The volume is stored as one bit per voxel, in rows along y.
+*/
+class MuseReachabilityMap
+{
+public:
+    /** Constructor. Uses the default Muse System limits (see MuseTargetingSettings). The kinematics are copied. */
+    explicit MuseReachabilityMap(const MuseKinematics& kinematics);
+
+    /** Destructor */
+    ~MuseReachabilityMap() = default;
+
+    /** Range swept for a degree of freedom */
+    void setLimits(MuseDOF::Index dof, double min, double max);
+
+    double getMin(MuseDOF::Index dof) const { return m_min[dof]; }
+    double getMax(MuseDOF::Index dof) const { return m_max[dof]; }
+
+    /**
+    * Sweeps the settings and fills the map, in parallel.
+    *
+    * @param voxelSize Edge of a voxel, in mm
+    * @param threadCount Number of threads, 0 to use all cores
+    */
+    void build(double voxelSize, unsigned threadCount = 0);
+
+    /** Whether the map was built */
+    bool isValid() const { return !m_bits.empty(); }
+
+    /**
+    * Whether the desired scanner focus lies in a reachable voxel. False outside the map.
+    *
+    * @param scannerFocus Desired focus, in scanner coordinates (see MuseKinematics::calcScannerFocus)
+    * @param calibration Offset between the observed and theoretical focus
+    */
+    bool isReachable(const core::Vector3& scannerFocus, const core::Vector3& calibration) const;
+
+    /** Whether voxel (i, j, k) is reachable */
+    bool isReachable(int i, int j, int k) const {
+        return (m_bits[row(i, k) + (j >> 6)] >> (j & 63)) & 1;
+    }
+
+    double getVoxelSize() const { return m_voxelSize; }
+    const core::Vector3& getOrigin() const { return m_origin; }
+    int getDim(int axis) const { return m_dims[axis]; }
+
+    /** Number of reachable voxels */
+    size_t getNumReachable() const;
+
+    /** Number of foci computed by the last build */
+    size_t getNumFoci() const { return m_numFoci; }
+
+    /** Wall-clock time of the last build, in seconds */
+    double getBuildTime() const { return m_buildTime; }
+
+private:
+    MuseKinematics m_kinematics;
+    double m_min[MuseDOF::Count];
+    double m_max[MuseDOF::Count];
+
+    core::Vector3 m_origin;                     // centre of voxel (0, 0, 0), uncalibrated scanner coordinates
+    double m_voxelSize = 1.0;
+    int m_dims[3] = { 0, 0, 0 };
+    size_t m_rowWords = 0;                      // 64-bit words per row along y
+    std::vector<uint64_t> m_bits;
+
+    size_t m_numFoci = 0;
+    double m_buildTime = 0;
+
+    /** Index of the first word of the row (i, k) */
+    size_t row(int i, int k) const { return ((size_t)i * m_dims[2] + k) * m_rowWords; }
+
+    /** ORs into bits the rows of src shifted by an offset between lo and hi voxels along x (axis 0) or z (axis 2) */
+    void dilate(const std::vector<uint64_t>& src, std::vector<uint64_t>& bits, int axis, int lo, int hi) const;
+};
+
+#endif // MUSEREACHABILITYMAP_H
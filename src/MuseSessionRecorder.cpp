@@ -0,0 +1,28 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseSessionRecorder.h"
+
+bool MuseSessionRecorder::open(const std::string& fileName) {
+    close();
+    m_file.open(fileName, std::ios::binary | std::ios::app);
+    m_sequence = 0;
+    return m_file.is_open();
+}
+
+void MuseSessionRecorder::close() {
+    if (m_file.is_open())
+        m_file.close();
+    m_file.clear();
+}
+
+void MuseSessionRecorder::record(MuseMessage message) {
+    if (!m_file.is_open())
+        return;
+    message.sequence = m_sequence++;
+    message.timestamp = MuseMessage::now();
+    uint8_t data[MuseMessage::MaxSize];
+    m_file.write(reinterpret_cast<const char*>(data), message.encode(data));
+    m_file.flush();
+}
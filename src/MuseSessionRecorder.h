@@ -0,0 +1,46 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSESESSIONRECORDER_H
+#define MUSESESSIONRECORDER_H
+
+#include "MuseMessage.h"
+#include <fstream>
+#include <string>
+
+/**
+* @brief Records the inputs of a MuseTargetingModel (observed focus, current settings, desired focus, reset) in an
+* append-only log, to replay a targeting session later (see MuseSessionReplay).
+*
+* The log is a plain sequence of MuseMessage's with their timestamps, so a session can also be sent to a running
+* Muse Targeting by PseudoTGDriver --replay. Each message is flushed as it is recorded: the log is complete up to
+* the last input, even if the app crashes.
+*/
+class MuseSessionRecorder
+{
+public:
+    /** Constructor */
+    MuseSessionRecorder() = default;
+
+    /** Destructor. Closes the log. */
+    ~MuseSessionRecorder() = default;
+
+    /** Starts recording at the end of the log fileName. Returns false if it cannot be opened. */
+    bool open(const std::string& fileName);
+
+    void close();
+    bool isOpen() const { return m_file.is_open(); }
+
+    /** Appends message to the log, with the next sequence number and the current time. Ignored if not open. */
+    void record(MuseMessage message);
+
+    /** Number of messages recorded since open() */
+    uint32_t getNumRecorded() const { return m_sequence; }
+
+private:
+    std::ofstream m_file;
+    uint32_t m_sequence = 0;
+};
+
+#endif // MUSESESSIONRECORDER_H
@@ -0,0 +1,54 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseSessionReplay.h"
+#include "MuseTargetingModel.h"
+#include <chrono>
+#include <fstream>
+#include <iterator>
+
+bool MuseSessionReplay::load(const std::string& fileName) {
+    m_messages.clear();
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file)
+        return false;
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    MuseMessageReader reader;
+    reader.append(data.data(), data.size());
+    MuseMessage message;
+    while (reader.next(message))
+        m_messages.push_back(message);
+    // a log cut in the middle of its last message is complete up to there
+    return !reader.hasError();
+}
+
+std::vector<double> MuseSessionReplay::run(MuseTargetingModel& model) const {
+    model.setAsynchronous(false);
+    std::vector<double> latencies(m_messages.size(), 0.0);
+    for (size_t i = 0; i < m_messages.size(); ++i) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (apply(model, m_messages[i]))
+            latencies[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+    return latencies;
+}
+
+bool MuseSessionReplay::apply(MuseTargetingModel& model, const MuseMessage& message) {
+    switch (message.type) {
+    case MuseMessage::ObservedFocus:
+        model.updateObservedFocus(message.getFocus());
+        return true;
+    case MuseMessage::CurrentSettings:
+        model.updateCurrentSettings(message.getSettings());
+        return true;
+    case MuseMessage::DesiredFocus:
+        model.updateDesiredFocus(message.getFocus());
+        return true;
+    case MuseMessage::Reset:
+        model.reset();
+        return true;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,46 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSESESSIONREPLAY_H
+#define MUSESESSIONREPLAY_H
+
+#include "MuseMessage.h"
+#include <string>
+#include <vector>
+
+class MuseTargetingModel;
+
+/**
+* @brief Feeds a session recorded by MuseSessionRecorder back into a MuseTargetingModel, headless and as fast as
+* possible, to regression-test and profile the calibration and suggested settings calculations on real sessions.
+*
+* The model is run synchronously, so the latency of an event is the whole update of the model it triggers,
+* suggested settings calculation included.
+*/
+class MuseSessionReplay
+{
+public:
+    /** Constructor */
+    MuseSessionReplay() = default;
+
+    /** Loads the log fileName. Returns false if it cannot be read or holds an invalid message. */
+    bool load(const std::string& fileName);
+
+    /** Recorded messages, in order */
+    const std::vector<MuseMessage>& getMessages() const { return m_messages; }
+
+    /**
+    * Applies every message to model, in order. Returns the latency of each event, in microseconds. Messages that
+    * are not model inputs (see MuseMessage::Type) are skipped, with a latency of 0.
+    */
+    std::vector<double> run(MuseTargetingModel& model) const;
+
+    /** Applies one message to model. Returns false if it is not a model input. */
+    static bool apply(MuseTargetingModel& model, const MuseMessage& message);
+
+private:
+    std::vector<MuseMessage> m_messages;
+};
+
+#endif // MUSESESSIONREPLAY_H
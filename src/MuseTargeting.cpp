@@ -12,19 +12,27 @@
 * The calculations used in this app were taken from MuseTargeting, a Python script developed by Dylan Palomino, 
 * Dennis Parker, Allison Payne, and Michelle Kline. University of Utah, Salt Lake City, Utah, USA.
 */
-#include "PseudoTGDriver.h"
+#include "MuseTargetingView.h"
 #include <QApplication>
+#include <cstring>
+#include <iostream>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
     /** 
-    * This is a small app that acts as a stand-in for Thermoguide during testing and dev. It simply allows the 
-      user to enter and observed focus and send it to the Muse Targeting application.
+    * Thermoguide (or PseudoTGDriver, a stand-in for it during testing and dev) runs as a separate process and
+      sends the observed focus over the local transport, see MuseTargetingServer.
      */
-    PseudoTGDriver p;
-    p.show();
+    MuseTargetingView v;
+    v.show();
+
+    // --record file: records the session, to replay it with MuseTargetingReplay
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--record") == 0 && !v.startRecording(argv[i + 1]))
+            std::cerr << "Cannot record the session in " << argv[i + 1] << std::endl;
+    }
 
     return a.exec();
 }
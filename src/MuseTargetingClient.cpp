@@ -0,0 +1,67 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseTargetingClient.h"
+
+MuseTargetingClient::~MuseTargetingClient()
+{
+    disconnectFromServer();
+}
+
+bool MuseTargetingClient::connectToServer(QString name, int timeout) {
+    disconnectFromServer();
+    m_socket.connectToServer(name);
+    return m_socket.waitForConnected(timeout);
+}
+
+void MuseTargetingClient::disconnectFromServer() {
+    if (m_socket.state() != QLocalSocket::UnconnectedState) {
+        m_socket.disconnectFromServer();
+        if (m_socket.state() != QLocalSocket::UnconnectedState)
+            m_socket.waitForDisconnected(1000);
+    }
+    m_reader.clear();
+}
+
+bool MuseTargetingClient::send(MuseMessage message, int timeout) {
+    if (!isConnected())
+        return false;
+    message.sequence = m_sequence++;
+    message.timestamp = MuseMessage::now();
+    uint8_t data[MuseMessage::MaxSize];
+    qint64 size = message.encode(data);
+    if (m_socket.write(reinterpret_cast<const char*>(data), size) != size)
+        return false;
+    while (m_socket.bytesToWrite() > 0) {
+        if (!m_socket.waitForBytesWritten(timeout))
+            return false;
+    }
+    return true;
+}
+
+bool MuseTargetingClient::receive(MuseMessage& message, int timeout) {
+    while (!m_reader.next(message)) {
+        if (m_reader.hasError() || !isConnected())
+            return false;
+        if (m_socket.bytesAvailable() == 0 && !m_socket.waitForReadyRead(timeout))
+            return false;
+        QByteArray data = m_socket.readAll();
+        m_reader.append(data.constData(), data.size());
+    }
+    return true;
+}
+
+double MuseTargetingClient::ping(int timeout) {
+    MuseMessage ping;
+    ping.type = MuseMessage::Ping;
+    uint32_t sequence = m_sequence;
+    if (!send(ping, timeout))
+        return -1;
+    MuseMessage message;
+    while (receive(message, timeout)) {
+        if (message.type == MuseMessage::Pong && message.sequence == sequence)
+            return double(MuseMessage::now() - message.timestamp);
+    }
+    return -1;
+}
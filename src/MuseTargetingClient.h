@@ -0,0 +1,56 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSETARGETINGCLIENT_H
+#define MUSETARGETINGCLIENT_H
+
+#include "MuseMessage.h"
+#include <QLocalSocket>
+#include <QString>
+
+/**
+* @brief Client side of the local transport to Muse Targeting, see MuseTargetingServer.
+*
+* Blocking calls with a timeout, so the client needs no event loop: it can run in a command-line tool, a test,
+* or a thread of its own. Every message sent is given the next sequence number and the current time.
+*/
+class MuseTargetingClient
+{
+public:
+    /** Constructor */
+    MuseTargetingClient() = default;
+
+    /** Destructor. Disconnects. */
+    ~MuseTargetingClient();
+
+    /** Connects to the server name. Returns false if it could not within timeout ms. */
+    bool connectToServer(QString name = MuseMessage::ServerName, int timeout = 1000);
+
+    void disconnectFromServer();
+    bool isConnected() const { return m_socket.state() == QLocalSocket::ConnectedState; }
+    QString getErrorString() const { return m_socket.errorString(); }
+
+    /** Sends message, waiting at most timeout ms for it to be written. Returns false on error. */
+    bool send(MuseMessage message, int timeout = 1000);
+
+    bool sendObservedFocus(const core::Vector3& focus) { return send(MuseMessage::makeFocus(MuseMessage::ObservedFocus, focus)); }
+    bool sendDesiredFocus(const core::Vector3& focus) { return send(MuseMessage::makeFocus(MuseMessage::DesiredFocus, focus)); }
+    bool sendCurrentSettings(const SettingsSnapshot& s) { return send(MuseMessage::makeSettings(MuseMessage::CurrentSettings, s)); }
+
+    /** Takes the next message from the server, waiting at most timeout ms (0: only if already received) */
+    bool receive(MuseMessage& message, int timeout = 1000);
+
+    /**
+    * Sends a ping and waits for its pong, skipping other messages. Returns the round trip in microseconds,
+    * -1 on timeout or error.
+    */
+    double ping(int timeout = 1000);
+
+private:
+    QLocalSocket m_socket;
+    MuseMessageReader m_reader;
+    uint32_t m_sequence = 0;
+};
+
+#endif // MUSETARGETINGCLIENT_H
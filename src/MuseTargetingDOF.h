@@ -5,7 +5,7 @@
 #ifndef MUSETARGETINGDOF_H
 #define MUSETARGETINGDOF_H
 
-#include <QWidget>
+#include <QString>
 
 class MuseTargetingDOF 
 {
@@ -40,13 +40,13 @@ public:
     void define(QString name, double lowerLimit, double upperLimit);
     void setName(QString name) { m_name = name; }
     void setMax(double upperLimit) { m_upperLimit = upperLimit; }
-    void setMin(double lowerLimit) { lowerLimit = lowerLimit; }
+    void setMin(double lowerLimit) { m_lowerLimit = lowerLimit; }
     void setValue(double value) { m_value = value; }
 
-    QString getName() { return m_name; }
-    double getMax() { return m_upperLimit; }
-    double getMin() { return m_lowerLimit; }
-    double getValue() { return m_value; }
+    QString getName() const { return m_name; }
+    double getMax() const { return m_upperLimit; }
+    double getMin() const { return m_lowerLimit; }
+    double getValue() const { return m_value; }
 
 signals:
 
@@ -3,9 +3,37 @@
 // :--------------------------------------------------------------------------:
 
 #include "MuseTargetingModel.h"
-#include <QMessageBox>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
-MuseTargetingModel::MuseTargetingModel(QWidget *parent) : QWidget(parent) {
+namespace {
+
+/** Whether two sets of settings have the same values */
+bool sameValues(const SettingsSnapshot& a, const SettingsSnapshot& b) {
+    return std::equal(a.values, a.values + MuseDOF::Count, b.values);
+}
+
+/**
+* Workspace within the default settings limits, at 4 mm: coarse, but quick to build. Built once per process on
+* a background thread, and shared by all the models (e.g. one per run of a replay).
+*/
+std::shared_future<std::shared_ptr<const MuseReachabilityMap>> defaultReachabilityMap() {
+    static std::shared_future<std::shared_ptr<const MuseReachabilityMap>> map = std::async(std::launch::async, []() {
+        MuseTargetingSettings settings;
+        std::shared_ptr<MuseReachabilityMap> map = std::make_shared<MuseReachabilityMap>(MuseKinematics());
+        for (int i = 0; i < MuseDOF::Count; ++i)
+            map->setLimits(MuseDOF::Index(i), settings.getSettingMin(i), settings.getSettingMax(i));
+        map->build(4.0);
+        return std::shared_ptr<const MuseReachabilityMap>(map);
+    }).share();
+    return map;
+}
+
+} // namespace
+
+MuseTargetingModel::MuseTargetingModel(QObject *parent) : QObject(parent), m_inverseKinematics(m_kinematics),
+    m_worker(new MuseTargetingWorker) {
     // default observed focus
     m_observedFocus.x() = 0;
     m_observedFocus.y() = 0;
@@ -25,367 +53,240 @@ MuseTargetingModel::MuseTargetingModel(QWidget *parent) : QWidget(parent) {
     m_desiredFocus.x() = 0;
     m_desiredFocus.y() = 0;
     m_desiredFocus.z() = 0;
+
+    // built in the background, the desired focus is considered reachable until then
+    m_reachabilityMapBuild = defaultReachabilityMap();
+
+    // the stream's producer may run on another thread: drain it from this thread's event loop
+    m_observedFocusStream.setNotifier([this]() {
+        QMetaObject::invokeMethod(this, "processObservedFocusStream", Qt::QueuedConnection);
+    });
+
+    // the worker lives in m_workerThread, requests and results are queued, and so can be the settings
+    // received by updateCurrentSettings from another thread
+    qRegisterMetaType<SettingsSnapshot>("SettingsSnapshot");
+    qRegisterMetaType<MuseSolveRequest>("MuseSolveRequest");
+    qRegisterMetaType<MuseSolveResult>("MuseSolveResult");
+    m_worker->moveToThread(&m_workerThread);
+    connect(this, SIGNAL(requestSolve(MuseSolveRequest)), m_worker, SLOT(solve(MuseSolveRequest)), Qt::QueuedConnection);
+    connect(m_worker, SIGNAL(solved(MuseSolveResult)), this, SLOT(updateSuggestedSettings(MuseSolveResult)), Qt::QueuedConnection);
 }
 
 MuseTargetingModel::~MuseTargetingModel()
-{}
+{
+    if (m_ikTableThread.joinable())
+        m_ikTableThread.join();
+    m_worker->setLatestGeneration(++m_solveGeneration);
+    m_workerThread.quit();
+    m_workerThread.wait();
+    delete m_worker;
+}
+
+void MuseTargetingModel::setAsynchronous(bool isAsynchronous) {
+    m_isAsynchronous = isAsynchronous;
+    if (m_isAsynchronous && !m_workerThread.isRunning())
+        m_workerThread.start();
+}
+
+void MuseTargetingModel::waitForReachabilityMap() {
+    m_reachabilityMap = m_reachabilityMapBuild.get();
+}
+
+void MuseTargetingModel::setIKTableFile(const std::string& fileName, double spacing) {
+    if (m_ikTableThread.joinable())
+        m_ikTableThread.join();
+    std::atomic_store(&m_ikTable, std::shared_ptr<const MuseIKTable>());
+    if (fileName.empty())
+        return;
+
+    // the solver of the suggested settings, with the limits set by calcSuggestedSettings
+    MuseInverseKinematics ik(m_inverseKinematics);
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        ik.setLimits(MuseDOF::Index(i), m_currentSettings.getSettingMin(i), m_currentSettings.getSettingMax(i));
+    m_ikTableThread = std::thread([this, ik, fileName, spacing]() {
+        std::shared_ptr<MuseIKTable> table = std::make_shared<MuseIKTable>(ik);
+        if (!table->load(fileName)) {
+            table->build(spacing);
+            table->save(fileName);  // or build again next time
+        }
+        std::atomic_store(&m_ikTable, std::shared_ptr<const MuseIKTable>(table));
+    });
+}
+
+void MuseTargetingModel::processObservedFocusStream() {
+    if (!m_observedFocusStream.update())
+        return;
+    const core::Vector3& estimate = m_observedFocusStream.getEstimate();
+    if (m_isObservedFocusSet && (estimate - m_observedFocus).length() <= m_observedFocusThreshold)
+        return;
+    updateObservedFocus(estimate);
+}
 
 void MuseTargetingModel::reset() {
+    MuseMessage message;
+    message.type = MuseMessage::Reset;
+    m_recorder.record(message);
+    emit modelChangedSignal(resetState());
+}
+
+unsigned MuseTargetingModel::resetState(bool isCalibrationKept) {
+    unsigned changes = 0;
+    MuseTargetingSettings defaults;
+    if (!sameValues(m_currentSettings.getSnapshot(), defaults.getSnapshot()))
+        changes |= CurrentSettingsChanged;
+    if (!sameValues(m_suggestedSettings.getSnapshot(), defaults.getSnapshot()) || m_suggestedSettingsSolve.iterations != 0 ||
+        m_suggestedSettingsSolve.converged || !m_isDesiredFocusReachable || m_isSolving)
+        changes |= SuggestedSettingsChanged;
+    if (m_theoreticalFocus != core::Vector3(0, -55, 0))
+        changes |= TheoreticalFocusChanged;
+    if (!isCalibrationKept && m_calibration != core::Vector3(0, 0, 0))
+        changes |= CalibrationChanged;
+    if (m_desiredFocus != core::Vector3(0, 0, 0))
+        changes |= DesiredFocusChanged;
+
     m_currentSettings.resetToDefault();
     m_suggestedSettings.resetToDefault();
+    m_suggestedSettingsSolve = MuseIKResult();
+    m_isDesiredFocusReachable = true;
+    m_worker->setLatestGeneration(++m_solveGeneration);  // drop any pending solve
+    m_isSolving = false;
     m_theoreticalFocus.x() = 0;
     m_theoreticalFocus.y() = -55;
     m_theoreticalFocus.z() = 0;
-    m_calibration.x() = 0;
-    m_calibration.y() = 0;
-    m_calibration.z() = 0;
-    m_isCalibrated = false;
+    if (!isCalibrationKept) {
+        m_calibrator.clear();
+        m_calibration.x() = 0;
+        m_calibration.y() = 0;
+        m_calibration.z() = 0;
+        m_calibrationUncertainty = core::Vector3(0, 0, 0);
+        m_isCalibrated = false;
+    }
     m_desiredFocus.x() = 0;
     m_desiredFocus.y() = 0;
     m_desiredFocus.z() = 0;
-
-    emit modelChangedSignal();
+    return changes;
 }
 
 void MuseTargetingModel::updateObservedFocus(core::Vector3 f) {
+    m_recorder.record(MuseMessage::makeFocus(MuseMessage::ObservedFocus, f));
 
-    // to avoid calculations getting out of sync, reset all 
-    reset();
+    // to avoid calculations getting out of sync, reset all but the calibration, which this observed focus
+    // refines once the settings that produced it are entered
+    unsigned changes = resetState(true);
+    m_isObservationPaired = false;
+    if (f != m_observedFocus || !m_isObservedFocusSet)
+        changes |= ObservedFocusChanged;
     m_observedFocus.x() = f.x();
     m_observedFocus.y() = f.y();
     m_observedFocus.z() = f.z();
     m_isObservedFocusSet = true;
-    emit modelChangedSignal();
+    if (changes)
+        emit modelChangedSignal(changes);
 }
 
-void MuseTargetingModel::updateCurrentSettings(MuseTargetingSettings* settings) {
-    
-    m_currentSettings.setValue("Psi",settings->getSettingValue("Psi"));
-    m_currentSettings.setValue("Theta",settings->getSettingValue("Theta"));
-    m_currentSettings.setValue("Alpha", settings->getSettingValue("Alpha"));
-    m_currentSettings.setValue("LSlider", settings->getSettingValue("LSlider"));
-    m_currentSettings.setValue("XTrolley", settings->getSettingValue("XTrolley"));
-    m_currentSettings.setValue("ZTrolley", settings->getSettingValue("ZTrolley"));
+void MuseTargetingModel::updateCurrentSettings(SettingsSnapshot settings) {
+    m_recorder.record(MuseMessage::makeSettings(MuseMessage::CurrentSettings, settings));
+    m_currentSettings.setValues(settings);
     calcTheoreticalFocus();
-    // if not calibrated and observed focus is set, calibrate
-    if (m_isObservedFocusSet && !m_isCalibrated) 
-        calibrate();
-    emit modelChangedSignal();
+    unsigned changes = CurrentSettingsChanged | TheoreticalFocusChanged;
+    // if observed focus is set, these settings produced it: calibrate
+    if (m_isObservedFocusSet && calibrate())
+        changes |= CalibrationChanged;
+    emit modelChangedSignal(changes);
 }
 
 void MuseTargetingModel::updateDesiredFocus(core::Vector3 f) {
+    m_recorder.record(MuseMessage::makeFocus(MuseMessage::DesiredFocus, f));
     m_desiredFocus.x() = f.x();
     m_desiredFocus.y() = f.y();
     m_desiredFocus.z() = f.z();
     calcSuggestedSettings();
-    emit modelChangedSignal();
+    emit modelChangedSignal(DesiredFocusChanged | SuggestedSettingsChanged);
 }
 
 void MuseTargetingModel::calcSuggestedSettings() {
-    
-    // dydz = (par.yfMRIwant - par.yoff - par.ycent)/ par.zfocus
+    /** Calculates suggested settings based on m_desiredFocus, starting from m_currentSettings.
+    * Populates m_suggestedSettings and m_suggestedSettingsSolve, right away or once the worker is done.
+    * Muse Targeting Python only calculated psi and the trolleys, with a single correction step. All six
+    * settings are now solved for by MuseInverseKinematics, within the limits of m_currentSettings.
+    * */
+    MuseSolveRequest request;
+    for (int i = 0; i < MuseDOF::Count; ++i) {
+        request.initial[i] = request.current[i] = m_currentSettings.getSettingValue(i);
+        m_inverseKinematics.setLimits(MuseDOF::Index(i), m_currentSettings.getSettingMin(i), m_currentSettings.getSettingMax(i));
+    }
     // par.calc_psi = math.degrees(math.asin((par.yfMRIwant - par.yoff - par.ycent)/ par.zfocus))
-    double suggestedPsi = radiansToDegrees(asin((m_desiredFocus.y() - m_calibration[1] - m_ycent) / m_zFocus));
-    // R_calc_psi = np.array(
-    //    [[1.0, 0.0, 0.0], [0.0, math.cos(math.radians(par.calc_psi)), math.sin(math.radians(par.calc_psi))],
-    //    [0.0, -math.sin(math.radians(par.calc_psi)), math.cos(math.radians(par.calc_psi))]] )
-    double suggestedPsiRadians = degreesToRadians(suggestedPsi);
-    std::vector<std::vector<double>> R_calc_psi{
-        { 1.0, 0.0, 0.0 },
-        { 0.0, cos(suggestedPsiRadians), sin(suggestedPsiRadians)},
-        { 0.0, -1.0 * sin(suggestedPsiRadians), cos(suggestedPsiRadians)}
-    };
-    // if int(par.usetheta) == 1: par.calc_theta = par.theta
-    //    if int(par.usealpha) == 1 : par.calc_alpha = par.alpha
-    //        if int(par.useLslider) == 1 : par.calc_Lslider = par.Lslider
-    // # we can't calculate theta yet - so we have to use the original anyway.
-    double suggestedTheta = m_currentSettings.getSettingValue("Theta");
-    double suggestedAlpha = m_currentSettings.getSettingValue("Alpha");
-    double suggestedLSlider = m_currentSettings.getSettingValue("LSlider");
-    // xyzfMRIpsi1 = np.transpose(np.array([[-(par.xoff - par.calc_xtrolley), par.yoff, par.zoff - par.calc_ztrolley]]))
-    std::vector<std::vector<double>> xyzfMRIpsi1;
-    /*if (m_isPersistSet) {
-        xyzfMRIpsi1 = {
-            { -1.0 * m_calibration[0] - m_persistX },
-            { m_calibration[1] },
-            { m_calibration[2] - m_persistZ }
-        };
-    }*/
-    //else {
-        xyzfMRIpsi1 = {
-            { -1.0 * (m_calibration[0] - m_suggestedSettings.getSettingValue("XTrolley")) },
-            { m_calibration[1] },
-            { m_calibration[2] - m_suggestedSettings.getSettingValue("ZTrolley") }
-        };
-    //}
-    // xyzfMRIpsi2A = np.transpose(np.array([[x_cent, y_cent, par.calc_Lslider + z_cent]]))
-    std::vector<std::vector<double>> xyzfMRIpsi2A{
-        { m_xcent },
-        { m_ycent },
-        { m_suggestedSettings.getSettingValue("LSlider") + m_zcent }
-    };
-    // debugging
-    //    double temp = m_suggestedSettings.getSettingValue("LSlider");
-    //    qDebug() << "m_suggestedSettings.getSettingValue LSlider" << temp;
-    //    qDebug() << "xyzfMRIpis2A " << xyzfMRIpsi2A[0] << " " << xyzfMRIpsi2A[1] << " " << xyzfMRIpsi2A[2];
-        //
-        // xyzfMRIpsi2B = np.add(xyzfMRIpsi2A, (R_calc_psi.dot(R_alpha.dot(np.transpose(xyzin)))))
-    double alphaRadians = degreesToRadians(m_currentSettings.getSettingValue("Alpha"));
-    std::vector<std::vector<double>> R_alpha{
-        {cos(alphaRadians), 0.0, -1.0 * sin(alphaRadians)},
-        {0.0, 1.0, 0.0},
-        {sin(alphaRadians), 0.0, cos(alphaRadians)}
-    };
-    std::vector<std::vector<double>> xyzinTranspose{  // MMK reuse from getTheoreticalFocus()?
-        { m_xFocus },
-        { m_yFocus },
-        { m_zFocus }
-    };
-    std::vector<std::vector<double>> tempDot{  // MMK reuse from getTheoreticalFocus()?
-        { (R_alpha[0][0] * xyzinTranspose[0][0]) + (R_alpha[0][1] * xyzinTranspose[1][0]) + (R_alpha[0][2] * xyzinTranspose[2][0]) },
-        { (R_alpha[1][0] * xyzinTranspose[0][0]) + (R_alpha[1][1] * xyzinTranspose[1][0]) + (R_alpha[1][2] * xyzinTranspose[2][0]) },
-        { (R_alpha[2][0] * xyzinTranspose[0][0]) + (R_alpha[2][1] * xyzinTranspose[1][0]) + (R_alpha[2][2] * xyzinTranspose[2][0])}
-    };
-    std::vector<std::vector<double>> tempDot2{
-        { (R_calc_psi[0][0] * tempDot[0][0]) + (R_calc_psi[0][1] * tempDot[1][0]) + (R_calc_psi[0][2] * tempDot[2][0]) },
-        { (R_calc_psi[1][0] * tempDot[0][0]) + (R_calc_psi[1][1] * tempDot[1][0]) + (R_calc_psi[1][2] * tempDot[2][0]) },
-        { (R_calc_psi[2][0] * tempDot[0][0]) + (R_calc_psi[2][1] * tempDot[1][0]) + (R_calc_psi[2][2] * tempDot[2][0])}
-    };
-    std::vector<std::vector<double>> xyzfMRIpsi2B{
-        {xyzfMRIpsi2A[0][0] + tempDot2[0][0]},
-        {xyzfMRIpsi2A[1][0] + tempDot2[1][0]},
-        {xyzfMRIpsi2A[2][0] + tempDot2[2][0]}
-    };
-    // xyzfMRIpsi2C = R_theta.dot(xyzfMRIpsi2B)
-    double thetaRadians = degreesToRadians(m_currentSettings.getSettingValue("Theta"));
-    std::vector<std::vector<double>> R_theta{  // MMK reuse from getTheoreticalFocus()?
-        {cos(thetaRadians), 0.0, sin(thetaRadians)},
-        {0.0, 1.0, 0.0},
-        {-1.0 * sin(thetaRadians), 0.0, cos(thetaRadians)}
-    };
-    std::vector<std::vector<double>> xyzfMRIpsi2C{  // MMK reuse from getTheoreticalFocus()?
-        { (R_theta[0][0] * xyzfMRIpsi2B[0][0]) + (R_theta[0][1] * xyzfMRIpsi2B[1][0]) + (R_theta[0][2] * xyzfMRIpsi2B[2][0]) },
-        { (R_theta[1][0] * xyzfMRIpsi2B[0][0]) + (R_theta[1][1] * xyzfMRIpsi2B[1][0]) + (R_theta[1][2] * xyzfMRIpsi2B[2][0]) },
-        { (R_theta[2][0] * xyzfMRIpsi2B[0][0]) + (R_theta[2][1] * xyzfMRIpsi2B[1][0]) + (R_theta[2][2] * xyzfMRIpsi2B[2][0])}
-    };
-    // xyzfMRIpsi = np.add(xyzfMRIpsi1, xyzfMRIpsi2C)
-    std::vector<double> xyzfMRIpsi{
-        xyzfMRIpsi1[0][0] + xyzfMRIpsi2C[0][0],
-        xyzfMRIpsi1[1][0] + xyzfMRIpsi2C[1][0],
-        xyzfMRIpsi1[2][0] + xyzfMRIpsi2C[2][0]
-    };
-    // dxyz = np.add(par.xyzfMRIwant, -xyzfMRIpsi)
-    std::vector<double> dxyz{
-        (-1 * m_desiredFocus.x()) + -1.0 * xyzfMRIpsi[0],  // MuseTargeting Python negates user-entered desired focus x
-        m_desiredFocus.y() + -1.0 * xyzfMRIpsi[1],
-        m_desiredFocus.z() + -1.0 * xyzfMRIpsi[2]
-    };
-    // abs_dxyz = math.sqrt(dxyz.dot(np.transpose(dxyz)))
-    std::vector<std::vector<double>> dxyzTranspose{
-        {dxyz[0]},
-        {dxyz[1]},
-        {dxyz[2]}
-    };
-    double tempDot3 = (dxyz[0] * dxyzTranspose[0][0]) + (dxyz[1] * dxyzTranspose[1][0]) + (dxyz[2] * dxyzTranspose[2][0]);
-    double abs_dxyz = sqrt(tempDot3);
-    //  if abs_dxyz > 0.5:
-    //    par.calc_psi = par.calc_psi + 180 * (dxyz[0, 1] / xyzin[0, 2]) / 3.1415926  # math.pi instead of 3.1415926 05 / 25 / 18 DP
-    //    R_calc_psi = np.array(
-    //        [[1.0, 0.0, 0.0],
-    //        [0.0, math.cos(math.radians(par.calc_psi)), math.sin(math.radians(par.calc_psi))],
-    //        [0.0, -math.sin(math.radians(par.calc_psi)), math.cos(math.radians(par.calc_psi))]] )
-    if (abs_dxyz > 0.5)
-    {
-        suggestedPsi = suggestedPsi + 180 * (dxyz[1] / m_zFocus) / core::IGT_PI;
-        R_calc_psi[0][0] = 1.0;
-        R_calc_psi[0][1] = 0.0;
-        R_calc_psi[0][2] = 0.0;
-        R_calc_psi[1][0] = 0.0;
-        R_calc_psi[1][1] = cos(degreesToRadians(suggestedPsi));
-        R_calc_psi[1][2] = sin(degreesToRadians(suggestedPsi));
-        R_calc_psi[2][0] = 0.0;
-        R_calc_psi[2][1] = -1 * sin(degreesToRadians(suggestedPsi));
-        R_calc_psi[2][2] = cos(degreesToRadians(suggestedPsi));
+    // Still a good initial guess for psi, when defined.
+    double dydz = (m_desiredFocus.y() - m_calibration[1] - m_kinematics.getYCent()) / m_kinematics.getZFocus();
+    if (std::abs(dydz) <= 1.0)
+        request.initial[MuseDOF::Psi] = radiansToDegrees(asin(dydz));
+
+    // MuseTargeting Python negates user-entered desired focus x
+    request.desiredScannerFocus = core::Vector3(-1 * m_desiredFocus.x(), m_desiredFocus.y(), m_desiredFocus.z());
+    request.calibration = m_calibrator.getOffset(m_desiredFocus - m_calibration);  // rotation included, if enabled
+    request.ik = std::make_shared<MuseInverseKinematics>(m_inverseKinematics);
+    if (!m_reachabilityMap && m_reachabilityMapBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        m_reachabilityMap = m_reachabilityMapBuild.get();
+    request.reachabilityMap = m_reachabilityMap;  // none yet: reachability unknown, solve anyway
+    request.ikTable = std::atomic_load(&m_ikTable);
+    request.generation = ++m_solveGeneration;
+    m_worker->setLatestGeneration(request.generation);
+
+    if (m_isAsynchronous) {
+        m_isSolving = true;
+        emit requestSolve(request);
     }
-    // xtest = par.calc_xtrolley + dxyz[0, 0]  #  % calc_xtrolley is added
-    // ztest = par.calc_ztrolley - dxyz[0, 2]  #  % calc_ztrolley is subtracted
-    // par.calc_xtrolley = xtest
-    // par.calc_ztrolley = ztest
-    double xtest;
-    double ztest;
-    xtest = m_suggestedSettings.getSettingValue("XTrolley") + dxyz[0];
-    ztest = m_suggestedSettings.getSettingValue("ZTrolley") - dxyz[2];
-    double suggestedXTrolley; 
-    double suggestedZTrolley;
-    suggestedXTrolley = xtest;
-    suggestedZTrolley = ztest;
-    
-    m_suggestedSettings.setValue("Psi", suggestedPsi);
-    m_suggestedSettings.setValue("Theta", suggestedTheta);
-    m_suggestedSettings.setValue("Alpha", suggestedAlpha);
-    m_suggestedSettings.setValue("LSlider", suggestedLSlider);
-    m_suggestedSettings.setValue("XTrolley", suggestedXTrolley);
-    m_suggestedSettings.setValue("ZTrolley", suggestedZTrolley);
+    else
+        updateSuggestedSettings(MuseTargetingWorker::calcSuggestedSettings(request));
+}
+
+void MuseTargetingModel::updateSuggestedSettings(MuseSolveResult result) {
+    if (result.generation != m_solveGeneration)
+        return;  // a newer desired focus was requested meanwhile
+    m_isSolving = false;
+    m_isDesiredFocusReachable = result.isReachable;
+    m_suggestedSettingsSolve = result.solve;
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        m_suggestedSettings.setValue(i, m_suggestedSettingsSolve.settings[i]);
+    if (m_isAsynchronous)
+        emit modelChangedSignal(SuggestedSettingsChanged);
 }
 
 void MuseTargetingModel::calcTheoreticalFocus() {
     /** Calculates theoretical focus based on m_currentSettings.
     * Populates m_theoreticalFocus.
-    * These calculations were translated directly from Muse Targeting v7 (Python).
-    * Python code fragments preceed each calculation for reference.
+    * The calculations themselves live in MuseKinematics, which does not allocate.
     * */
-    //R_psi = np.array(
-        //[[1.0, 0.0, 0.0], [0.0, math.cos(math.radians(par.psi)), math.sin(math.radians(par.psi))],
-        //[0.0, -math.sin(math.radians(par.psi)), math.cos(math.radians(par.psi))]] )
-    double psiRadians = degreesToRadians(m_currentSettings.getSettingValue("Psi"));   // MMK can use Tools.h DegToRad()
-    std::vector<std::vector<double>> R_psi{
-        {1.0, 0.0, 0.0},
-        {0.0, cos(psiRadians), sin(psiRadians)},
-        {0.0, -1 * sin(psiRadians), cos(psiRadians)}
-    };
-    //R_alpha = np.array(
-        //[[math.cos(math.radians(par.alpha)), 0.0, -math.sin(math.radians(par.alpha))], [0.0, 1.0, 0.0],
-        //[math.sin(math.radians(par.alpha)), 0.0, math.cos(math.radians(par.alpha))]] )
-    double alphaRadians = degreesToRadians(m_currentSettings.getSettingValue("Alpha"));
-    std::vector<std::vector<double>> R_alpha{
-        {cos(alphaRadians), 0.0, -1.0 * sin(alphaRadians)},
-        {0.0, 1.0, 0.0},
-        {sin(alphaRadians), 0.0, cos(alphaRadians)}
-    };
-    //R_theta = np.array(
-        //[[math.cos(math.radians(par.theta)), 0.0, math.sin(math.radians(par.theta))], [0.0, 1.0, 0.0],
-        //[-math.sin(math.radians(par.theta)), 0.0, math.cos(math.radians(par.theta))]] )
-    double thetaRadians = degreesToRadians(m_currentSettings.getSettingValue("Theta"));
-
-    std::vector<std::vector<double>> R_theta{
-        {cos(thetaRadians), 0.0, sin(thetaRadians)},
-        {0.0, 1.0, 0.0},
-        {-1.0 * sin(thetaRadians), 0.0, cos(thetaRadians)}
-    };
-    //R_thetap = np.array(
-        //[[math.cos(math.radians(par.theta)), 0.0, -math.sin(math.radians(par.theta))], [0.0, 1.0, 0.0],
-        //[math.sin(math.radians(par.theta)), 0.0, math.cos(math.radians(par.theta))]] )
-    std::vector<std::vector<double>> R_thetap{
-        {cos(thetaRadians), 0.0, -1.0 * sin(thetaRadians)},
-        {0.0, 1.0, 0.0},
-        {sin(thetaRadians), 0.0, cos(thetaRadians)}
-    };
-    // xyzf_scanner1 = np.transpose(np.array([[-(par.xoff - par.xtrolley), par.yoff, par.zoff - par.ztrolley]]))
-    std::vector<std::vector<double>> xyzf_scanner1{
-        {-1.0 * (m_calibration[0] - m_currentSettings.getSettingValue("XTrolley"))},
-        {m_calibration[1]},
-        {m_calibration[2] - m_currentSettings.getSettingValue("ZTrolley")}
-    };
-    // xyzf_scanner2A = np.transpose(np.array([[x_cent, y_cent, par.Lslider + z_cent]]))
-    std::vector<std::vector<double>> xyzf_scanner2A{
-        {m_xcent},
-        {m_ycent},
-        {m_currentSettings.getSettingValue("LSlider") + m_zcent}
-    };
-    // xyzin = np.reshape(xyzin, (1, 3))
-    std::vector<std::vector<double>> xyzinTranspose{
-        { m_xFocus },
-        { m_yFocus },
-        { m_zFocus }
-    };
-    // xyzf_scanner2B = np.add(xyzf_scanner2A, (R_psi.dot(R_alpha.dot(np.transpose(xyzin)))))
-    std::vector<std::vector<double>> tempDot{
-        { (R_alpha[0][0] * xyzinTranspose[0][0]) + (R_alpha[0][1] * xyzinTranspose[1][0]) + (R_alpha[0][2] * xyzinTranspose[2][0]) },
-        { (R_alpha[1][0] * xyzinTranspose[0][0]) + (R_alpha[1][1] * xyzinTranspose[1][0]) + (R_alpha[1][2] * xyzinTranspose[2][0]) },
-        { (R_alpha[2][0] * xyzinTranspose[0][0]) + (R_alpha[2][1] * xyzinTranspose[1][0]) + (R_alpha[2][2] * xyzinTranspose[2][0])}
-    };
-    std::vector<std::vector<double>> tempDot2{
-        { (R_psi[0][0] * tempDot[0][0]) + (R_psi[0][1] * tempDot[1][0]) + (R_psi[0][2] * tempDot[2][0]) },
-        { (R_psi[1][0] * tempDot[0][0]) + (R_psi[1][1] * tempDot[1][0]) + (R_psi[1][2] * tempDot[2][0]) },
-        { (R_psi[2][0] * tempDot[0][0]) + (R_psi[2][1] * tempDot[1][0]) + (R_psi[2][2] * tempDot[2][0])}
-    };
-    std::vector<std::vector<double>> xyzf_scanner2B{
-        {xyzf_scanner2A[0][0] + tempDot2[0][0]},
-        {xyzf_scanner2A[1][0] + tempDot2[1][0]},
-        {xyzf_scanner2A[2][0] + tempDot2[2][0]}
-    };
-    // xyzf_scanner2C = R_theta.dot(xyzf_scanner2B)
-    std::vector<std::vector<double>> xyzf_scanner2C{
-        { (R_theta[0][0] * xyzf_scanner2B[0][0]) + (R_theta[0][1] * xyzf_scanner2B[1][0]) + (R_theta[0][2] * xyzf_scanner2B[2][0]) },
-        { (R_theta[1][0] * xyzf_scanner2B[0][0]) + (R_theta[1][1] * xyzf_scanner2B[1][0]) + (R_theta[1][2] * xyzf_scanner2B[2][0]) },
-        { (R_theta[2][0] * xyzf_scanner2B[0][0]) + (R_theta[2][1] * xyzf_scanner2B[1][0]) + (R_theta[2][2] * xyzf_scanner2B[2][0])}
-    };
-    // xyzf_scanner2 = xyzf_scanner2C
-    // xyzf_scanner = np.add(xyzf_scanner1, xyzf_scanner2)
-
-    std::vector<std::vector<double>> xyzf_scanner{
-        {xyzf_scanner1[0][0] + xyzf_scanner2C[0][0]},
-        {xyzf_scanner1[1][0] + xyzf_scanner2C[1][0]},
-        {xyzf_scanner1[2][0] + xyzf_scanner2C[2][0]}
-    };
-
-    //xyzf_transducer = np.add(
-    //    (R_theta.dot(np.transpose(np.reshape(np.array([x_cent, y_cent, par.Lslider + z_cent]), (1, 3))))), (
-    //        np.transpose(
-    //            np.reshape(np.array([-(par.xoff - par.xtrolley), par.yoff, par.zoff - par.ztrolley]),
-    //                 (1, 3)))))
-    std::vector<std::vector<double>> tempCent{
-        {m_xcent},
-        {m_ycent},
-        {m_currentSettings.getSettingValue("LSlider") + m_zcent}
-    };
-    std::vector<std::vector<double>> tempDot3{
-        { (R_theta[0][0] * tempCent[0][0]) + (R_theta[0][1] * tempCent[1][0]) + (R_theta[0][2] * tempCent[2][0]) },
-        { (R_theta[1][0] * tempCent[0][0]) + (R_theta[1][1] * tempCent[1][0]) + (R_theta[1][2] * tempCent[2][0]) },
-        { (R_theta[2][0] * tempCent[0][0]) + (R_theta[2][1] * tempCent[1][0]) + (R_theta[2][2] * tempCent[2][0]) }
-    };
-    std::vector<std::vector<double>> tempCalib{
-        { -1.0 * (m_calibration[0] - m_currentSettings.getSettingValue("XTrolley")) },
-        { m_calibration[1] },
-        { m_calibration[2] - m_currentSettings.getSettingValue("ZTrolley") }
-    };
-    std::vector<std::vector<double>> xyzf_transducer{
-        {tempDot3[0][0] + tempCalib[0][0]},
-        {tempDot3[1][0] + tempCalib[1][0]},
-        {tempDot3[2][0] + tempCalib[2][0]}
-    };
-    // create calculated focus string by defining xyzf_scanner in terms of LPH+
-    // par.xyzRAH = 'RPH'           # Right, Posterior, Head
-    // par.xyzRAHneg = 'LAF'        # Left, Anterior, Foot
-    // xyzf = np.absolute(xyzf_scanner)
-    // if xyzf_scanner[0] < 0:
-    //     xyzRAH[0] = par.xyzRAHneg[0]
-    // if xyzf_scanner[1] < 0 :
-    //     xyzRAH[1] = par.xyzRAHneg[1]
-    // if xyzf_scanner[2] < 0 :
-    //     xyzRAH[2] = par.xyzRAHneg[2]
-    std::vector<std::vector<double>> xyzf{
-        { abs(xyzf_scanner[0][0]) },
-        { abs(xyzf_scanner[1][0]) },
-        { abs(xyzf_scanner[2][0]) }
-    };
-
-    // MMK question: in Python MuseTargeting,
-    // xyzRAH = ['R', 'P', 'H']  # Changed L to R
-    // xyzRAHneg = ['L', 'A', 'F']  # Changed R to L
-    m_theoreticalFocus.x() = -1 * round(xyzf_scanner[0][0]); // why?
-    m_theoreticalFocus.y() = round(xyzf_scanner[1][0]);
-    m_theoreticalFocus.z() = round(xyzf_scanner[2][0]);
+    m_theoreticalFocus = m_kinematics.calcTheoreticalFocus(
+        m_currentSettings.getSettingValue(MuseDOF::Psi),
+        m_currentSettings.getSettingValue(MuseDOF::Theta),
+        m_currentSettings.getSettingValue(MuseDOF::Alpha),
+        m_currentSettings.getSettingValue(MuseDOF::LSlider),
+        m_currentSettings.getSettingValue(MuseDOF::XTrolley),
+        m_currentSettings.getSettingValue(MuseDOF::ZTrolley),
+        m_calibration);
 }
 
-void MuseTargetingModel::calibrate() {
-    if (m_theoreticalFocus.x() != m_observedFocus.x()) {
-        if (m_theoreticalFocus.x() > 0) // L, if +LPH
-            m_calibration[0] = round(m_observedFocus.x() - abs(m_theoreticalFocus.x()));
-        else // R, if +LPH
-            m_calibration[0] = round(m_observedFocus.x() + abs(m_theoreticalFocus.x()));
-    }
-    if (m_theoreticalFocus.y() != m_observedFocus.y()) {
-        if (m_theoreticalFocus.y() > 0) // P, if +LPH
-            m_calibration[1] = round(m_observedFocus.y() - abs(m_theoreticalFocus.y()));
-        else // A, if +LPH
-            m_calibration[1] = round(m_observedFocus.y() + abs(m_theoreticalFocus.y()));
-    }
-    if (m_theoreticalFocus.z() != m_observedFocus.z()) {
-        if (m_theoreticalFocus.z() > 0) // H, if +LPH
-            m_calibration[2] = round(m_observedFocus.z() - abs(m_theoreticalFocus.z()));
-        else // F, if +LPH
-            m_calibration[2] = round(m_observedFocus.z() + abs(m_theoreticalFocus.z()));
-        m_isCalibrated = true;
-    }
+bool MuseTargetingModel::calibrate() {
+    /** Adds the observed focus and the uncalibrated theoretical focus of the current settings to the calibration
+    * observations, replacing the previous pair if the settings were entered again for the same observed focus.
+    * Muse Targeting Python rounded the difference of the two on each axis, from this one observation only.
+    * */
+    core::Vector3 previous = m_calibration;
+    core::Vector3 previousUncertainty = m_calibrationUncertainty;
+    double settings[MuseDOF::Count];
+    core::Vector3 jacobian[MuseDOF::Count];
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        settings[i] = m_currentSettings.getSettingValue(i);
+    core::Vector3 scannerFocus = m_kinematics.calcScannerFocus(settings, core::Vector3(0, 0, 0), jacobian);
+    core::Vector3 theoreticalFocus(-scannerFocus[0], scannerFocus[1], scannerFocus[2]);
+
+    if (m_isObservationPaired)
+        m_calibrator.removeLastObservation();
+    m_calibrator.addObservation(theoreticalFocus, m_observedFocus);
+    m_isObservationPaired = true;
+    m_isCalibrated = m_calibrator.isCalibrated();
+    m_calibration = m_calibrator.getOffset(theoreticalFocus);
+    m_calibrationUncertainty = m_calibrator.getOffsetUncertainty(theoreticalFocus);
+    return m_calibration != previous || m_calibrationUncertainty != previousUncertainty;
 }
\ No newline at end of file
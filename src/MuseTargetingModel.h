@@ -6,12 +6,24 @@
 #define MUSETARGETINGMODEL_H
 
 #include "MuseTargetingSettings.h"
+#include "MuseKinematics.h"
+#include "MuseInverseKinematics.h"
+#include "MuseReachabilityMap.h"
+#include "MuseTargetingWorker.h"
+#include "MuseFocusStream.h"
+#include "MuseSessionRecorder.h"
+#include "MuseCalibration.h"
 #include "../libs/libCore/Core/Maths/Vector3.h"
 #include "../libs/libCore/Core/Constants.h"
-#include <QWidget>
+#include <QObject>
+#include <QThread>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
 
 /**
-* @brief QWidget class to manage the data underlying the Muse Targeting app.
+* @brief QObject class to manage the data underlying the Muse Targeting app.
 *
 * The model constists of:
 *  - the observed focus
@@ -22,19 +34,33 @@
 *  - suggested Muse System settings
 * 
 * Whenever current Muse System settings are updated, the theoretical focus is also updated. If the observed 
-* focus is set, and calibration has not been calculated, then calibration will be performed (simply the difference
-* between observed focus and theoretical focus).
+* focus is set, the settings and the observed focus are added to the calibration observations, and the
+* calibration is refitted over all of them (see MuseCalibration). A new observed focus keeps the calibration.
 * 
-* Whenver the desired focus is updated, the suggested Muse System settings will be calculated.
+* Whenver the desired focus is updated, the suggested Muse System settings will be calculated (iteratively, over
+* all six settings, see MuseInverseKinematics). When asynchronous (see setAsynchronous), this runs on a worker
+* thread and the model changes again once the latest desired focus is solved.
 * 
-* Any change to the model result in sending a signal to the view.
+* Any change to the model result in sending a signal to the view, with a mask of the parts that changed
+* (see Change), so that the view only updates the affected widgets.
 */
-class MuseTargetingModel : public QWidget
+class MuseTargetingModel : public QObject
 {
     Q_OBJECT
 public:
-    /** Constructor. A QWidget pointer is passed implicitly */
-    explicit MuseTargetingModel(QWidget *parent = nullptr);
+    /** Parts of the model, ORed in the mask sent with modelChangedSignal */
+    enum Change {
+        ObservedFocusChanged     = 0x01,
+        CurrentSettingsChanged   = 0x02,
+        CalibrationChanged       = 0x04,
+        TheoreticalFocusChanged  = 0x08,
+        DesiredFocusChanged      = 0x10,
+        SuggestedSettingsChanged = 0x20,   // including the solve report and reachability
+        AllChanged               = 0x3f
+    };
+
+    /** Constructor. Holds no UI: only needs Qt Core, and no QApplication. */
+    explicit MuseTargetingModel(QObject *parent = nullptr);
 
     /** Destructor. */
     ~MuseTargetingModel();
@@ -50,33 +76,110 @@ public:
     core::Vector3 getTheoreticalFocus() { return m_theoreticalFocus; }
     core::Vector3 getDesiredFocus() { return m_desiredFocus; }
 
+    /** Standard deviation (mm) of the calibration on each axis, 0 until calibrated */
+    core::Vector3 getCalibrationUncertainty() const { return m_calibrationUncertainty; }
+
+    /** Accuracy, iterations and solve time of the last suggested settings calculation */
+    const MuseIKResult& getSuggestedSettingsSolve() const { return m_suggestedSettingsSolve; }
+
+    /**
+    * Whether the desired focus lies in the workspace of the Muse System. If not, no settings were solved for.
+    * The map of the workspace is built in the background, once per process: until it is ready, every desired
+    * focus is solved for and considered reachable.
+    */
+    bool isDesiredFocusReachable() const { return m_isDesiredFocusReachable; }
+
+    /** Waits for the map of the workspace, e.g. for results that must not depend on timing (see MuseTargetingReplay) */
+    void waitForReachabilityMap();
+
+    /**
+    * Calculates the suggested settings on a worker thread (true), or right away in updateDesiredFocus (false,
+    * the default). Asynchronous results are delivered through the event loop of the model's thread.
+    */
+    void setAsynchronous(bool isAsynchronous);
+
+    /** Whether suggested settings are being calculated for the latest desired focus */
+    bool isSolving() const { return m_isSolving; }
+
+    /**
+    * Uses a precomputed table of the inverse kinematics as a cache for the suggested settings (see MuseIKTable).
+    * On a background thread, the table in fileName is loaded if it was built for the same geometry and limits,
+    * otherwise it is built (spacing in mm, over the whole workspace) and saved to fileName. The settings are
+    * solved without the table until it is ready. With the table, the suggested settings favour the solution
+    * nearest the default settings rather than the current ones. An empty fileName stops using the table.
+    * Waits for the table previously requested, if it is still being built.
+    */
+    void setIKTableFile(const std::string& fileName, double spacing = 2.0);
+
+    /** Whether the table of setIKTableFile is ready, and used for the next suggested settings */
+    bool hasIKTable() const { return std::atomic_load(&m_ikTable) != nullptr; }
+
     /** Each setting is a MuseTargetingDOF object (degree of freedom). Each DOF has a min and max allowable value */
     double getCurrentSettingMin(QString name) { return m_currentSettings.getSettingMin(name); }
     double getCurrentSettingMax(QString name) { return m_currentSettings.getSettingMax(name); }
+    double getCurrentSettingMin(int index) const { return m_currentSettings.getSettingMin(index); }
+    double getCurrentSettingMax(int index) const { return m_currentSettings.getSettingMax(index); }
+
+    /**
+    * Stream of observed foci, for a producer running on another thread (e.g. Thermoguide at the slice rate).
+    * The first sample pushed after a drain queues a call to processObservedFocusStream on the model's thread,
+    * which takes all the samples pending by then (MuseTargetingServer also calls it right after each read).
+    */
+    MuseFocusStream& getObservedFocusStream() { return m_observedFocusStream; }
+
+    /**
+    * The streamed estimate only replaces the observed focus when it moved by more than threshold mm, since
+    * a new observed focus resets the model (default 0.5 mm).
+    */
+    void setObservedFocusThreshold(double threshold) { m_observedFocusThreshold = threshold; }
+
+    /** Calibration observations and fit. Reset by reset() only. */
+    MuseCalibration& getCalibrator() { return m_calibrator; }
+    const MuseCalibration& getCalibrator() const { return m_calibrator; }
+
+    /**
+    * Records the inputs of the model (observed focus, current settings, desired focus and reset), once opened.
+    * See MuseSessionReplay to replay them.
+    */
+    MuseSessionRecorder& getRecorder() { return m_recorder; }
 
     /** Reset current and suggested settings, theoretical and desired focus, and calibration to default settings */
     void reset();
 
 signals:
-    void modelChangedSignal();
+    /** The model changed. changes is a mask of Change values. */
+    void modelChangedSignal(unsigned changes);
 
-private slots:
+    /** Sends a suggested settings calculation to the worker thread */
+    void requestSolve(MuseSolveRequest request);
+
+public slots:
     /** Receive observed focus from MuseTargetingView, update the model */
     void updateObservedFocus(core::Vector3 f);
 
     /** Receive current settings from MuseTargetingView, update the model */
-    void updateCurrentSettings(MuseTargetingSettings *s);
+    void updateCurrentSettings(SettingsSnapshot s);
 
     /** Receive desired focus from MuseTargetingView, update the model */
     void updateDesiredFocus(core::Vector3 f);
-    
+
+    /** Takes the pending samples of the observed focus stream, updates the observed focus if it moved */
+    void processObservedFocusStream();
+
+private slots:
+    /** Receive suggested settings from the worker thread, update the model if they are the latest */
+    void updateSuggestedSettings(MuseSolveResult result);
+
 private:
     MuseTargetingSettings m_currentSettings;    // user-provided Muse System settings
     bool m_areCurrSettingsRegistered = false;
     core::Vector3 m_observedFocus;              // Thermoguide-provided observed focus
     bool m_isObservedFocusSet = false;
-    core::Vector3 m_calibration;
+    core::Vector3 m_calibration;                // calibration offset at the current settings
+    core::Vector3 m_calibrationUncertainty;
     bool m_isCalibrated = false;
+    MuseCalibration m_calibrator;
+    bool m_isObservationPaired = false;         // the observed focus is already in m_calibrator
     core::Vector3 m_theoreticalFocus;
     core::Vector3 m_desiredFocus;
     MuseTargetingSettings m_suggestedSettings;
@@ -87,17 +190,42 @@ private:
     /** One of the two main functions. Calculates the theoretical geometric focus, based on current Muse System settings. */
     void calcTheoreticalFocus();
 
-    /** Simply computes the difference between the theoretical focus and the observed focus. */
-    void calibrate();
-
-    /** other Muse System variables from MuseTargeting Python */
-    double m_xFocus = 0.0;    // default focus of transducer?
-    double m_yFocus = 0.0;    // default focus of transducer?
-    double m_zFocus = 106.8;  // default focus of transducer?
-    double m_Lnull  = 20.2;
-    double m_xcent  = 0;
-    double m_ycent  = -55;
-    double m_zcent  = -1.0 * (m_zFocus + m_Lnull);
+    /**
+    * Adds the current settings and observed focus to the calibration, and refits it. Returns whether the
+    * calibration or its uncertainty changed.
+    */
+    bool calibrate();
+
+    /**
+    * Resets the model without notifying the view, but for the calibration if isCalibrationKept. Returns the mask
+    * of the parts that actually changed.
+    */
+    unsigned resetState(bool isCalibrationKept = false);
+
+    /** Muse System transducer geometry and forward kinematics */
+    MuseKinematics m_kinematics;
+    MuseInverseKinematics m_inverseKinematics;
+    MuseIKResult m_suggestedSettingsSolve;
+    std::shared_future<std::shared_ptr<const MuseReachabilityMap>> m_reachabilityMapBuild;
+    std::shared_ptr<const MuseReachabilityMap> m_reachabilityMap;  // once built
+    bool m_isDesiredFocusReachable = true;
+
+    /** Optional cache of the inverse kinematics, published by m_ikTableThread (std::atomic_load/store) */
+    std::shared_ptr<const MuseIKTable> m_ikTable;
+    std::thread m_ikTableThread;
+
+    /** Worker thread for calcSuggestedSettings, see MuseTargetingWorker */
+    QThread m_workerThread;
+    MuseTargetingWorker* m_worker;
+    bool m_isAsynchronous = false;
+    quint64 m_solveGeneration = 0;
+    bool m_isSolving = false;
+
+    /** Streamed observed foci, see getObservedFocusStream */
+    MuseFocusStream m_observedFocusStream;
+    double m_observedFocusThreshold = 0.5;
+
+    MuseSessionRecorder m_recorder;
 
     /** Helper functions */
     double degreesToRadians(double deg){ return (deg * core::IGT_PI) / 180; }
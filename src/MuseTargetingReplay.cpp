@@ -0,0 +1,88 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+/**
+* Replays a targeting session recorded by MuseTargeting --record into the model, headless and as fast as possible,
+* and reports the latency of each kind of event and the final state of the model.
+*
+* Usage:
+*   MuseTargetingReplay file [--repeat n] [--csv latencies.csv]
+*/
+#include "MuseSessionReplay.h"
+#include "MuseTargetingModel.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: MuseTargetingReplay file [--repeat n] [--csv latencies.csv]" << std::endl;
+        return 1;
+    }
+    int repeat = 1;
+    const char* csvFileName = nullptr;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--repeat") == 0)
+            repeat = std::max(std::atoi(argv[i + 1]), 1);
+        else if (std::strcmp(argv[i], "--csv") == 0)
+            csvFileName = argv[i + 1];
+    }
+
+    MuseSessionReplay replay;
+    if (!replay.load(argv[1]))
+        std::cerr << "Invalid message in " << argv[1] << ", replaying up to there" << std::endl;
+    const std::vector<MuseMessage>& messages = replay.getMessages();
+
+    // a fresh model per run, so that every run is the same
+    std::vector<double> latencies;
+    std::unique_ptr<MuseTargetingModel> model;
+    for (int run = 0; run < repeat; ++run) {
+        model.reset(new MuseTargetingModel);
+        model->waitForReachabilityMap();
+        std::vector<double> runLatencies = replay.run(*model);
+        latencies.insert(latencies.end(), runLatencies.begin(), runLatencies.end());
+    }
+
+    // latency per type of event
+    const char* typeNames[] = { "", "observed focus", "current settings", "desired focus", "reset" };
+    std::map<int, std::vector<double>> latenciesByType;
+    for (size_t i = 0; i < latencies.size(); ++i) {
+        const MuseMessage& message = messages[i % messages.size()];
+        if (message.type <= MuseMessage::Reset)
+            latenciesByType[message.type].push_back(latencies[i]);
+    }
+    std::cout << messages.size() << " events, " << repeat << " run(s)" << std::endl;
+    for (auto& type : latenciesByType) {
+        std::vector<double>& l = type.second;
+        std::sort(l.begin(), l.end());
+        double sum = 0;
+        for (double latency : l)
+            sum += latency;
+        std::cout << typeNames[type.first] << ": " << l.size() << " events, latency (us) mean " << sum / l.size()
+            << ", median " << l[l.size() / 2] << ", 99% " << l[l.size() * 99 / 100] << ", max " << l.back() << std::endl;
+    }
+
+    // final state, to compare between versions
+    core::Vector3 calibration = model->getCalibration();
+    std::cout << "calibration: " << calibration.x() << " " << calibration.y() << " " << calibration.z() << std::endl;
+    std::cout << "suggested settings:";
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        std::cout << " " << model->getSuggestedSettings()->getSettingValue(i);
+    std::cout << (model->isDesiredFocusReachable() ? "" : " (desired focus out of reach)") << std::endl;
+
+    if (csvFileName) {
+        std::ofstream csv(csvFileName);
+        csv << "event,type,timestamp,latency_us" << std::endl;
+        for (size_t i = 0; i < latencies.size(); ++i) {
+            const MuseMessage& message = messages[i % messages.size()];
+            csv << i << "," << int(message.type) << "," << message.timestamp << "," << latencies[i] << std::endl;
+        }
+    }
+    return 0;
+}
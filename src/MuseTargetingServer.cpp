@@ -0,0 +1,109 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseTargetingServer.h"
+
+MuseTargetingServer::MuseTargetingServer(MuseTargetingModel& model, QObject *parent) : QObject(parent), m_model(model) {
+    connect(&m_server, SIGNAL(newConnection()), this, SLOT(acceptClients()));
+    connect(&m_model, SIGNAL(modelChangedSignal(unsigned)), this, SLOT(sendModelChanges(unsigned)));
+}
+
+MuseTargetingServer::~MuseTargetingServer()
+{
+    for (auto& client : m_clients) {
+        client.first->disconnect(this);
+        client.first->abort();
+        delete client.first;
+    }
+}
+
+bool MuseTargetingServer::listen(QString name) {
+    // a server that crashed may have left its socket file behind (Unix)
+    QLocalServer::removeServer(name);
+    return m_server.listen(name);
+}
+
+void MuseTargetingServer::acceptClients() {
+    while (QLocalSocket* client = m_server.nextPendingConnection()) {
+        client->setParent(nullptr);
+        m_clients[client] = MuseMessageReader();
+        connect(client, SIGNAL(readyRead()), this, SLOT(readClient()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(removeClient()));
+    }
+}
+
+void MuseTargetingServer::readClient() {
+    QLocalSocket* client = qobject_cast<QLocalSocket*>(sender());
+    auto it = m_clients.find(client);
+    if (it == m_clients.end())
+        return;
+    MuseMessageReader& reader = it->second;
+    QByteArray data = client->readAll();
+    reader.append(data.constData(), data.size());
+
+    bool isObservedFocusReceived = false;
+    MuseMessage message;
+    while (reader.next(message))
+        isObservedFocusReceived = dispatch(client, message) || isObservedFocusReceived;
+    if (isObservedFocusReceived)
+        m_model.processObservedFocusStream();
+
+    if (reader.hasError()) {
+        emit errorOccurred("A client sent an invalid message, and was disconnected.");
+        client->disconnectFromServer();
+    }
+}
+
+void MuseTargetingServer::removeClient() {
+    QLocalSocket* client = qobject_cast<QLocalSocket*>(sender());
+    if (m_clients.erase(client) != 0)
+        client->deleteLater();
+}
+
+bool MuseTargetingServer::dispatch(QLocalSocket* client, const MuseMessage& message) {
+    switch (message.type) {
+    case MuseMessage::ObservedFocus:
+        m_model.getObservedFocusStream().push(message.getFocus());
+        return true;
+    case MuseMessage::CurrentSettings:
+        m_model.updateCurrentSettings(message.getSettings());
+        break;
+    case MuseMessage::DesiredFocus:
+        m_model.updateDesiredFocus(message.getFocus());
+        break;
+    case MuseMessage::Reset:
+        m_model.reset();
+        break;
+    case MuseMessage::Ping: {
+        // same sequence and timestamp, so that the client matches the pong and measures the round trip
+        MuseMessage pong = message;
+        pong.type = MuseMessage::Pong;
+        write(client, pong);
+        break;
+    }
+    default:
+        break;  // messages for the clients
+    }
+    return false;
+}
+
+void MuseTargetingServer::sendModelChanges(unsigned changes) {
+    if (!(changes & MuseTargetingModel::SuggestedSettingsChanged) || m_model.isSolving())
+        return;
+    MuseMessage message = MuseMessage::makeSettings(MuseMessage::SuggestedSettings,
+        m_model.getSuggestedSettings()->getSnapshot());
+    for (auto& client : m_clients)
+        send(client.first, message);
+}
+
+void MuseTargetingServer::send(QLocalSocket* client, MuseMessage message) {
+    message.sequence = m_sequence++;
+    message.timestamp = MuseMessage::now();
+    write(client, message);
+}
+
+void MuseTargetingServer::write(QLocalSocket* client, const MuseMessage& message) {
+    uint8_t data[MuseMessage::MaxSize];
+    client->write(reinterpret_cast<const char*>(data), message.encode(data));
+}
@@ -0,0 +1,73 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSETARGETINGSERVER_H
+#define MUSETARGETINGSERVER_H
+
+#include "MuseTargetingModel.h"
+#include "MuseMessage.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <map>
+
+/**
+* @brief Serves a MuseTargetingModel to other processes (Thermoguide, PseudoTGDriver) over a local socket.
+*
+* QLocalServer is a Unix-domain socket on Linux and macOS, a named pipe on Windows. Clients send MuseMessage's:
+* observed focus, current settings, desired focus and reset messages update the model, pings are answered
+* right away (for latency measurements). The suggested settings are sent to every client whenever they change.
+*
+* Observed foci go through the model's observed focus stream, which is drained once per read: the model is
+* updated once per read, not once per message, with the stream's estimate (by default the latest focus, see
+* MuseFocusStream::setAveraging) if it moved by more than the model's threshold.
+*
+* A client sending an invalid message (see MuseMessageReader), such as a NaN or infinite focus, is
+* disconnected: nothing of it reaches the model, and errorOccurred is emitted.
+*/
+class MuseTargetingServer : public QObject
+{
+    Q_OBJECT
+public:
+    /** Constructor. The server does not listen until listen() is called. */
+    explicit MuseTargetingServer(MuseTargetingModel& model, QObject *parent = nullptr);
+
+    /** Destructor. Disconnects the clients. */
+    ~MuseTargetingServer();
+
+    /** Starts listening on name (MuseMessage::ServerName by default). Returns false if it could not. */
+    bool listen(QString name = MuseMessage::ServerName);
+
+    QString getErrorString() const { return m_server.errorString(); }
+    int getNumClients() const { return int(m_clients.size()); }
+
+signals:
+    /** Something went wrong with a client, e.g. it sent an invalid message and was disconnected */
+    void errorOccurred(QString message);
+
+private slots:
+    void acceptClients();
+    void readClient();
+    void removeClient();
+
+    /** Sends the suggested settings to the clients when they changed */
+    void sendModelChanges(unsigned changes);
+
+private:
+    /** Applies one message received from client. Returns true if it was an observed focus. */
+    bool dispatch(QLocalSocket* client, const MuseMessage& message);
+
+    /** Sends message to client, with the next sequence number and the current time */
+    void send(QLocalSocket* client, MuseMessage message);
+
+    /** Sends message to client as is */
+    void write(QLocalSocket* client, const MuseMessage& message);
+
+    MuseTargetingModel& m_model;
+    QLocalServer m_server;
+    std::map<QLocalSocket*, MuseMessageReader> m_clients;
+    uint32_t m_sequence = 0;
+};
+
+#endif // MUSETARGETINGSERVER_H
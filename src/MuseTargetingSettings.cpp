@@ -4,33 +4,31 @@
 
 #include "MuseTargetingSettings.h"
 
-MuseTargetingSettings::MuseTargetingSettings(QWidget *parent) : QWidget(parent) {
-    // these are the default Muse System Settings
+MuseTargetingSettings::MuseTargetingSettings() {
+    // these are the default Muse System Settings, in the order of MuseDOF::Index
     // TO DO: allow to be defined using input file?
-    MuseTargetingDOF psi("Psi", 0, 40, 0);
-    m_museSettings.push_back(psi);
-    MuseTargetingDOF theta("Theta",0, 360, 0);
-    m_museSettings.push_back(theta);
-    MuseTargetingDOF alpha("Alpha", -10, 10, 0);
-    m_museSettings.push_back(alpha);
-    MuseTargetingDOF LSlider("LSlider", 0, 40, 20);
-    m_museSettings.push_back(LSlider);
-    MuseTargetingDOF xTrolley("XTrolley", -20, 20, 0);
-    m_museSettings.push_back(xTrolley);
-    MuseTargetingDOF zTrolley("ZTrolley", -20, 20, 0);
-    m_museSettings.push_back(zTrolley);
+    addSetting("Psi", 0, 40, 0);
+    addSetting("Theta",0, 360, 0);
+    addSetting("Alpha", -10, 10, 0);
+    addSetting("LSlider", 0, 40, 20);
+    addSetting("XTrolley", -20, 20, 0);
+    addSetting("ZTrolley", -20, 20, 0);
 }
 
 void MuseTargetingSettings::addSetting(QString name, double min, double max, double value){
-    // TO DO: check if name already exists in m_museSettings
     // TO DO: ensure value is valid (>=min && <=max
     // TO DO: ensure min <= max
 
+    // a name already used keeps pointing to the first setting with that name
+    if (!m_settingIndex.contains(name))
+        m_settingIndex.insert(name, (int)m_museSettings.size());
     MuseTargetingDOF DOF(name, min, max, value);
     m_museSettings.push_back(DOF);
 }
 
 void MuseTargetingSettings::addSetting(QString name, double min, double max) {
+    if (!m_settingIndex.contains(name))
+        m_settingIndex.insert(name, (int)m_museSettings.size());
     MuseTargetingDOF DOF(name, min, max);
     m_museSettings.push_back(DOF);
 }
@@ -38,58 +36,50 @@ void MuseTargetingSettings::addSetting(QString name, double min, double max) {
 void MuseTargetingSettings::setValue(QString settingName, double val) {
     // TO DO: ensure value is valid
     // TO DO: ensure name is found in m_museSettings
-    for (unsigned i = 0; i < m_museSettings.size(); ++i)
-    {
-        if (!m_museSettings[i].getName().compare(settingName)) 
-        {
-            m_museSettings[i].setValue(val);
-            return;
-        }
-    }
+    int index = indexOf(settingName);
+    if (index >= 0)
+        m_museSettings[index].setValue(val);
+}
+
+SettingsSnapshot MuseTargetingSettings::getSnapshot() const {
+    SettingsSnapshot snapshot;
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        snapshot.values[i] = m_museSettings[i].getValue();
+    return snapshot;
 }
 
-std::vector<MuseTargetingDOF> MuseTargetingSettings::getSettings() {
-    return m_museSettings;
+void MuseTargetingSettings::setValues(const SettingsSnapshot& snapshot) {
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        m_museSettings[i].setValue(snapshot.values[i]);
 }
 
 double MuseTargetingSettings::getSettingMin(QString settingName) {
-    for (unsigned i = 0; i < m_museSettings.size(); ++i)
-    {
-        if (!m_museSettings[i].getName().compare(settingName))
-        {
-            return m_museSettings[i].getMin();
-        }
-    }
+    int index = indexOf(settingName);
+    if (index >= 0)
+        return m_museSettings[index].getMin();
     return -999;  // MMK fixme - what to return if no match found?
 }
 
 double MuseTargetingSettings::getSettingMax(QString settingName) {
-    for (unsigned i = 0; i < m_museSettings.size(); ++i)
-    {
-        if (!m_museSettings[i].getName().compare(settingName))
-            return m_museSettings[i].getMax();
-    }
+    int index = indexOf(settingName);
+    if (index >= 0)
+        return m_museSettings[index].getMax();
     return -999;  // MMK fixme - what to return if no match found?
 }
 
 double MuseTargetingSettings::getSettingValue(QString settingName) {
-    for (unsigned i = 0; i < m_museSettings.size(); ++i)
-    {
-        QString temp = m_museSettings[i].getName();
-        if (!m_museSettings[i].getName().compare(settingName))
-        {
-            return m_museSettings[i].getValue();
-        }
-    }
+    int index = indexOf(settingName);
+    if (index >= 0)
+        return m_museSettings[index].getValue();
     return -999;  // MMK fixme - what to return if no match found?
 }
 
 void MuseTargetingSettings::resetToDefault() {
     // these are the default Muse System Settings
-    setValue("Psi", 0);
-    setValue("Theta", 0);
-    setValue("Alpha", 0);
-    setValue("LSlider", 20);
-    setValue("XTrolley", 0);
-    setValue("ZTrolley", 0);
+    setValue(MuseDOF::Psi, 0);
+    setValue(MuseDOF::Theta, 0);
+    setValue(MuseDOF::Alpha, 0);
+    setValue(MuseDOF::LSlider, 20);
+    setValue(MuseDOF::XTrolley, 0);
+    setValue(MuseDOF::ZTrolley, 0);
 }
\ No newline at end of file
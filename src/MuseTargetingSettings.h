@@ -6,18 +6,37 @@
 #define MUSETARGETINGSETTINGS_H
 
 #include "MuseTargetingDOF.h"
-#include <QWidget>
+#include "MuseKinematics.h"
+#include <QHash>
+#include <QMetaType>
 #include <vector>
 
+/**
+* @brief Values of the six Muse System settings, indexed by MuseDOF::Index.
+*
+* Plain data, cheap to copy: this is what the view and the model pass each other in signals, instead of
+* a MuseTargetingSettings widget.
+*/
+struct SettingsSnapshot
+{
+    double values[MuseDOF::Count];
+};
+Q_DECLARE_METATYPE(SettingsSnapshot)
+
 /**
 * @brief Model class for Muse Targeting. Stores vector of degrees of freedom (MuseTargetingDOF) for Muse System.
+*
+* Plain C++ (only QString and QHash from Qt Core), so it can be used without a QApplication.
+*
+* The six Muse System settings are always stored first, in the order of MuseDOF::Index, so they can be accessed
+* by index without any name lookup. Other settings added with addSetting() are indexed by name in a hash:
+* resolve the name once with indexOf(), then access the setting by index.
 */
-class MuseTargetingSettings : public QWidget
+class MuseTargetingSettings
 {
-    Q_OBJECT
 public:
     /** Default constructor */
-    explicit MuseTargetingSettings(QWidget *parent = nullptr);
+    MuseTargetingSettings();
     //    MuseTargetingSettings(std::vector<std::string> DOFNames,std::vector<double> DOFMinLimits, std::vector<double> DOFMaxLimits);
     //    MuseTargetingSettings(std::vector<std::string> DOFNames,std::vector<double> DOFMinLimits, std::vector<double> DOFMaxLimits, std::vector<double>DOFValues);
 
@@ -30,30 +49,45 @@ public:
 
     /** update the value of thie degree of freedom */
     void setValue(QString settingName, double val);
+    void setValue(int index, double val) { m_museSettings[index].setValue(val); }
 
     /** Return all of the degrees of freedom defined for this settings object */
-    std::vector<MuseTargetingDOF> getSettings();
+    const std::vector<MuseTargetingDOF>& getSettings() const { return m_museSettings; }
+
+    /** Values of the six Muse System settings */
+    SettingsSnapshot getSnapshot() const;
+
+    /** Update the values of the six Muse System settings */
+    void setValues(const SettingsSnapshot& snapshot);
+
+    /** Index of the degree of freedom with this name, or -1 if there is none */
+    int indexOf(QString settingName) const { return m_settingIndex.value(settingName, -1); }
 
     /** The minimum allowable value for this degree of freedom */
     double getSettingMin(QString settingName);
+    double getSettingMin(int index) const { return m_museSettings[index].getMin(); }
 
     /** The maximum allowable value for this degree of freedom */
     double getSettingMax(QString settingName);
+    double getSettingMax(int index) const { return m_museSettings[index].getMax(); }
 
     /** The current value for this degree of freedom */
     double getSettingValue(QString settingName);
+    double getSettingValue(int index) const { return m_museSettings[index].getValue(); }
 
-    size_t getNumSettings() { return m_museSettings.size(); }
+    size_t getNumSettings() const { return m_museSettings.size(); }
 
     void resetToDefault();
 
-    // MMK need check to ensure that no duplication of setting name
     // MMK how to handle value that is not >= min and <= max
     // MMK how to handle min > max
 
 private:
     /** This is the vector of degrees of freedom that describe this settings object */
     std::vector<MuseTargetingDOF> m_museSettings;
+
+    /** Index of each degree of freedom in m_museSettings, by name */
+    QHash<QString, int> m_settingIndex;
 };
 
 #endif // MUSETARGETINGSETTINGS_H
@@ -4,20 +4,34 @@
 
 #include "MuseTargetingView.h"
 #include "MuseTargetingSettings.h"
-#include <QDebug>
+#include <QDir>
 #include <QMessageBox>
+#include <QStandardPaths>
 
 MuseTargetingView::MuseTargetingView(QWidget* parent)
-    : QWidget(parent)
+    : QWidget(parent), m_server(m_model)
 {
     ui.setupUi(this);
 
+    // receive the observed focus (and settings) from Thermoguide, running in another process
+    connect(&m_server, SIGNAL(errorOccurred(QString)), this, SLOT(serverError(QString)));
+    if (!m_server.listen())
+        serverError("Cannot listen for Thermoguide: " + m_server.getErrorString());
+
+    // solve the suggested settings on the model's worker thread, so that the UI stays responsive
+    m_model.setAsynchronous(true);
+
+    // cache the inverse kinematics in a table, built on the first run (a few seconds, in the background)
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (QDir().mkpath(cacheDir))
+        m_model.setIKTableFile(QDir(cacheDir).filePath("MuseIKTable.bin").toStdString());
+
     // Populate the widgets with the model. Initially, the model contains all default values.
     refreshView();
 
     connect(ui.currentSettingButton, SIGNAL(clicked()), this, SLOT(enterButtonClicked()));
-    connect(this, SIGNAL(updateCurrentSettings(MuseTargetingSettings*)), &m_model, SLOT(updateCurrentSettings(MuseTargetingSettings*)));
-    connect(&m_model, SIGNAL(modelChangedSignal()), this, SLOT(refreshView()));
+    connect(this, SIGNAL(updateCurrentSettings(SettingsSnapshot)), &m_model, SLOT(updateCurrentSettings(SettingsSnapshot)));
+    connect(&m_model, SIGNAL(modelChangedSignal(unsigned)), this, SLOT(refreshView(unsigned)));
     connect(ui.calculateButton, SIGNAL(clicked()), this, SLOT(calculateButtonClicked()));
     connect(this, SIGNAL(updateDesiredFocus(core::Vector3)), &m_model, SLOT(updateDesiredFocus(core::Vector3)));
     connect(ui.resetButton, SIGNAL(clicked()), this, SLOT(resetButtonClicked()));
@@ -29,64 +43,63 @@ MuseTargetingView::~MuseTargetingView()
 
 void MuseTargetingView::enterButtonClicked() {
     // get the current system settings that the user has entered and validate
-    MuseTargetingSettings* s = new MuseTargetingSettings;
+    SettingsSnapshot s;
     // Psi
     QString currentPsiStr = ui.currentPsiLineEdit->text();
     double currentPsi = currentPsiStr.toDouble();
-    if (currentPsi < m_model.getCurrentSettingMin("Psi") || currentPsi > m_model.getCurrentSettingMax("Psi"))
+    if (currentPsi < m_model.getCurrentSettingMin(MuseDOF::Psi) || currentPsi > m_model.getCurrentSettingMax(MuseDOF::Psi))
     {
         invalidMessage("Psi");
         return;
     }
-    s->setValue("Psi", currentPsi);
+    s.values[MuseDOF::Psi] = currentPsi;
     // Theta
     QString currentThetaStr = ui.currentThetaLineEdit->text();
     double currentTheta = currentThetaStr.toDouble();
-    if (currentTheta < m_model.getCurrentSettingMin("Theta") || currentTheta > m_model.getCurrentSettingMax("Theta"))
+    if (currentTheta < m_model.getCurrentSettingMin(MuseDOF::Theta) || currentTheta > m_model.getCurrentSettingMax(MuseDOF::Theta))
     {
         invalidMessage("Theta");
         return;
     }
-    s->setValue("Theta", currentTheta);
+    s.values[MuseDOF::Theta] = currentTheta;
     // Alpha
     QString currentAlphaStr = ui.currentAlphaLineEdit->text();
     double currentAlpha = currentAlphaStr.toDouble();
-    if (currentAlpha < m_model.getCurrentSettingMin("Alpha") || currentAlpha > m_model.getCurrentSettingMax("Alpha"))
+    if (currentAlpha < m_model.getCurrentSettingMin(MuseDOF::Alpha) || currentAlpha > m_model.getCurrentSettingMax(MuseDOF::Alpha))
     {
         invalidMessage("Alpha");
         return;
     }
-    s->setValue("Alpha", currentAlpha);
+    s.values[MuseDOF::Alpha] = currentAlpha;
     // L-Slider
     QString currentLSliderStr = ui.currentLSliderLineEdit->text();
     double currentLSlider = currentLSliderStr.toDouble();
-    if (currentLSlider < m_model.getCurrentSettingMin("LSlider") || currentLSlider > m_model.getCurrentSettingMax("LSlider"))
+    if (currentLSlider < m_model.getCurrentSettingMin(MuseDOF::LSlider) || currentLSlider > m_model.getCurrentSettingMax(MuseDOF::LSlider))
     {
         invalidMessage("LSlider");
         return;
     }
-    s->setValue("LSlider", currentLSlider);
+    s.values[MuseDOF::LSlider] = currentLSlider;
     // X-Trolley
     QString currentXTrolleyStr = ui.currentXTrolleyLineEdit->text();
     double currentXTrolley = currentXTrolleyStr.toDouble();
-    if (currentXTrolley < m_model.getCurrentSettingMin("XTrolley") || currentXTrolley > m_model.getCurrentSettingMax("XTrolley"))
+    if (currentXTrolley < m_model.getCurrentSettingMin(MuseDOF::XTrolley) || currentXTrolley > m_model.getCurrentSettingMax(MuseDOF::XTrolley))
     {
         invalidMessage("XTrolley");
         return;
     }
-    s->setValue("XTrolley", currentXTrolley);
+    s.values[MuseDOF::XTrolley] = currentXTrolley;
     // Z-Trolley
     QString currentZTrolleyStr = ui.currentZTrolleyLineEdit->text();
     double currentZTrolley = currentZTrolleyStr.toDouble();
-    if (currentZTrolley < m_model.getCurrentSettingMin("ZTrolley") || currentZTrolley > m_model.getCurrentSettingMax("ZTrolley"))
+    if (currentZTrolley < m_model.getCurrentSettingMin(MuseDOF::ZTrolley) || currentZTrolley > m_model.getCurrentSettingMax(MuseDOF::ZTrolley))
     {
         invalidMessage("ZTrolley");
         return;
     }
-    s->setValue("ZTrolley", currentZTrolley);
+    s.values[MuseDOF::ZTrolley] = currentZTrolley;
     // then send to the model
     emit updateCurrentSettings(s);
-    delete s; // MMK fixme. Necessary?
 }
 
 void MuseTargetingView::calculateButtonClicked() {
@@ -119,46 +132,85 @@ void MuseTargetingView::invalidMessage(QString settingName) {
     QMessageBox::warning(this, "Invalid Entry", msg);
 }
 
-void MuseTargetingView::refreshView() {
+void MuseTargetingView::serverError(QString message) {
+    QMessageBox::warning(this, "Thermoguide", message);
+}
+
+void MuseTargetingView::refreshView(unsigned changes) {
     // display observed focus widgets
-    core::Vector3 of = m_model.getObservedFocus();
-    ui.observedXEdit->setText(QString::number(of.x()));
-    ui.observedYEdit->setText(QString::number(of.y()));
-    ui.observedZEdit->setText(QString::number(of.z()));
+    if (changes & MuseTargetingModel::ObservedFocusChanged) {
+        core::Vector3 of = m_model.getObservedFocus();
+        ui.observedXEdit->setText(QString::number(of.x()));
+        ui.observedYEdit->setText(QString::number(of.y()));
+        ui.observedZEdit->setText(QString::number(of.z()));
+    }
 
     // display current settings 
-    MuseTargetingSettings* cs = m_model.getCurrentSettings();
-    ui.currentPsiLineEdit->setText(QString::number(round(cs->getSettingValue("Psi"))));
-    ui.currentThetaLineEdit->setText(QString::number(round(cs->getSettingValue("Theta"))));
-    ui.currentAlphaLineEdit->setText(QString::number(round(cs->getSettingValue("Alpha"))));
-    ui.currentLSliderLineEdit->setText(QString::number(round(cs->getSettingValue("LSlider"))));
-    ui.currentXTrolleyLineEdit->setText(QString::number(round(cs->getSettingValue("XTrolley"))));
-    ui.currentZTrolleyLineEdit->setText(QString::number(round(cs->getSettingValue("ZTrolley"))));
+    if (changes & MuseTargetingModel::CurrentSettingsChanged) {
+        MuseTargetingSettings* cs = m_model.getCurrentSettings();
+        ui.currentPsiLineEdit->setText(QString::number(round(cs->getSettingValue(MuseDOF::Psi))));
+        ui.currentThetaLineEdit->setText(QString::number(round(cs->getSettingValue(MuseDOF::Theta))));
+        ui.currentAlphaLineEdit->setText(QString::number(round(cs->getSettingValue(MuseDOF::Alpha))));
+        ui.currentLSliderLineEdit->setText(QString::number(round(cs->getSettingValue(MuseDOF::LSlider))));
+        ui.currentXTrolleyLineEdit->setText(QString::number(round(cs->getSettingValue(MuseDOF::XTrolley))));
+        ui.currentZTrolleyLineEdit->setText(QString::number(round(cs->getSettingValue(MuseDOF::ZTrolley))));
+    }
 
     // display calibration <=== TEMP, during dev
-    core::Vector3 cf = m_model.getCalibration();
-    ui.calibrationXEdit->setText(QString::number(cf.x()));
-    ui.calibrationYEdit->setText(QString::number(cf.y()));
-    ui.calibrationZEdit->setText(QString::number(cf.z()));
+    if (changes & MuseTargetingModel::CalibrationChanged) {
+        core::Vector3 cf = m_model.getCalibration();
+        ui.calibrationXEdit->setText(QString::number(cf.x(), 'f', 1));
+        ui.calibrationYEdit->setText(QString::number(cf.y(), 'f', 1));
+        ui.calibrationZEdit->setText(QString::number(cf.z(), 'f', 1));
+
+        // how much to trust it: uncertainty, and the observations it was fitted to
+        const MuseCalibration& calibrator = m_model.getCalibrator();
+        core::Vector3 cu = m_model.getCalibrationUncertainty();
+        QString calibrationMsg = "Not calibrated";
+        if (calibrator.isCalibrated()) {
+            calibrationMsg = "Uncertainty (1 sigma): " + QString::number(cu.x(), 'f', 1) + ", " + QString::number(cu.y(), 'f', 1) +
+                ", " + QString::number(cu.z(), 'f', 1) + " mm, from " + QString::number(calibrator.getNumAccepted()) +
+                " observation(s), RMS residual " + QString::number(calibrator.getRMSResidual(), 'f', 1) + " mm";
+            if (calibrator.getNumRejected() > 0)
+                calibrationMsg += ", " + QString::number(calibrator.getNumRejected()) + " outlier(s) rejected";
+        }
+        ui.calibrationGroup->setToolTip(calibrationMsg);
+    }
 
     // display theoretical focus <=== TEMP, during dev
-    core::Vector3 tf = m_model.getTheoreticalFocus();
-    ui.theoreticalXEdit->setText(QString::number(tf.x()));
-    ui.theoreticalYEdit->setText(QString::number(tf.y()));
-    ui.theoreticalZEdit->setText(QString::number(tf.z()));
+    if (changes & MuseTargetingModel::TheoreticalFocusChanged) {
+        core::Vector3 tf = m_model.getTheoreticalFocus();
+        ui.theoreticalXEdit->setText(QString::number(tf.x()));
+        ui.theoreticalYEdit->setText(QString::number(tf.y()));
+        ui.theoreticalZEdit->setText(QString::number(tf.z()));
+    }
 
     // display desired focus
-    core::Vector3 df = m_model.getDesiredFocus();
-    ui.desiredXEdit->setText(QString::number(df.x()));
-    ui.desiredYEdit->setText(QString::number(df.y()));
-    ui.desiredZEdit->setText(QString::number(df.z()));
+    if (changes & MuseTargetingModel::DesiredFocusChanged) {
+        core::Vector3 df = m_model.getDesiredFocus();
+        ui.desiredXEdit->setText(QString::number(df.x()));
+        ui.desiredYEdit->setText(QString::number(df.y()));
+        ui.desiredZEdit->setText(QString::number(df.z()));
+    }
 
     // update suggested settings widgets
-    MuseTargetingSettings* ss = m_model.getSuggestedSettings();
-    ui.suggestedPsiLineEdit->setText(QString::number(round(ss->getSettingValue("Psi"))));
-    ui.suggestedThetaLineEdit->setText(QString::number(round(ss->getSettingValue("Theta"))));
-    ui.suggestedAlphaLineEdit->setText(QString::number(round(ss->getSettingValue("Alpha"))));
-    ui.suggestedLSliderLineEdit->setText(QString::number(round(ss->getSettingValue("LSlider"))));
-    ui.suggestedXTrolleyLineEdit->setText(QString::number(round(ss->getSettingValue("XTrolley"))));
-    ui.suggestedZTrolleyLineEdit->setText(QString::number(round(ss->getSettingValue("ZTrolley"))));
+    if (changes & MuseTargetingModel::SuggestedSettingsChanged) {
+        MuseTargetingSettings* ss = m_model.getSuggestedSettings();
+        ui.suggestedPsiLineEdit->setText(QString::number(round(ss->getSettingValue(MuseDOF::Psi))));
+        ui.suggestedThetaLineEdit->setText(QString::number(round(ss->getSettingValue(MuseDOF::Theta))));
+        ui.suggestedAlphaLineEdit->setText(QString::number(round(ss->getSettingValue(MuseDOF::Alpha))));
+        ui.suggestedLSliderLineEdit->setText(QString::number(round(ss->getSettingValue(MuseDOF::LSlider))));
+        ui.suggestedXTrolleyLineEdit->setText(QString::number(round(ss->getSettingValue(MuseDOF::XTrolley))));
+        ui.suggestedZTrolleyLineEdit->setText(QString::number(round(ss->getSettingValue(MuseDOF::ZTrolley))));
+
+        // report how well the suggested settings reach the desired focus
+        const MuseIKResult& solve = m_model.getSuggestedSettingsSolve();
+        QString solveMsg = QString(solve.converged ? "Converged" : "Not reachable") + ": error " + QString::number(solve.error) +
+            " mm, " + QString::number(solve.iterations) + " iterations, " + QString::number(solve.solveTimeUs) + " us";
+        if (m_model.isSolving())
+            solveMsg = "Solving...";
+        else if (!m_model.isDesiredFocusReachable())
+            solveMsg = "Desired focus out of reach of the Muse System";
+        ui.suggestedSettingsGroup->setToolTip(solveMsg);
+    }
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <QtWidgets/QWidget>
 #include "ui_MuseTargetingView.h"
 #include "MuseTargetingModel.h"
+#include "MuseTargetingServer.h"
 #include "MuseTargetingSettings.h"
 #include "../libs/libCore/Core/Maths/Vector3.h"
 
@@ -33,15 +34,18 @@ public:
     /** Destructor. */
     ~MuseTargetingView();
 
+    /** Records the session (the inputs of the model) at the end of fileName. Returns false if it cannot be opened. */
+    bool startRecording(QString fileName) { return m_model.getRecorder().open(fileName.toStdString()); }
+
 private slots:
     /** This captures the signal automatically generated by the "Enter" button click. */
     void enterButtonClicked();
 
     /** 
     * Captures signal from MuseTargetingModel indicating that the model has changed. 
-    * Simply displays all model data in the widgets.
+    * Displays the model data that changed (a mask of MuseTargetingModel::Change) in the widgets.
     */
-    void refreshView();
+    void refreshView(unsigned changes = MuseTargetingModel::AllChanged);
 
     /** Captures the signal automatically generated by the "Calculate" button click. */
     void calculateButtonClicked();
@@ -52,9 +56,12 @@ private slots:
     /** Captures signal sent by Thermoguide indicating that the observed focus is updated. */
     void receiveObservedFocus(core::Vector3 of);
 
+    /** Displays a QMessageBox when the connection with Thermoguide fails (see MuseTargetingServer). */
+    void serverError(QString message);
+
 signals:
     /** Sends signal containing values from current settings widgets to MuseTargetingView */
-    void updateCurrentSettings(MuseTargetingSettings* s);
+    void updateCurrentSettings(SettingsSnapshot s);
 
     /** Sends signal containing values from desired focus widgets to MuseTargetingView */
     void updateDesiredFocus(core::Vector3 df);
@@ -65,6 +72,7 @@ signals:
 private:
     Ui::MuseTargetingViewClass ui;
     MuseTargetingModel m_model;
+    MuseTargetingServer m_server;       // Thermoguide connects here
 
     /** Helper function to display QMessageBox when user has entered an invalid value in the current settings widgets. */
     void invalidMessage(QString settingName);
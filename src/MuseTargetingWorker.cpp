@@ -0,0 +1,32 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#include "MuseTargetingWorker.h"
+#include <algorithm>
+
+MuseTargetingWorker::MuseTargetingWorker(QObject *parent) : QObject(parent), m_latestGeneration(0) {}
+
+MuseSolveResult MuseTargetingWorker::calcSuggestedSettings(const MuseSolveRequest& request) {
+    MuseSolveResult result;
+    result.generation = request.generation;
+    result.isReachable = !request.reachabilityMap ||
+        request.reachabilityMap->isReachable(request.desiredScannerFocus, request.calibration);
+    if (!result.isReachable) {
+        // out of the workspace: don't bother solving, suggest the current settings
+        std::copy(request.current, request.current + MuseDOF::Count, result.solve.settings);
+    }
+    else if (request.ikTable && request.ikTable->isBuiltFor(*request.ik))
+        result.solve = request.ikTable->lookup(request.desiredScannerFocus, request.calibration);
+    else
+        result.solve = request.ik->solve(request.desiredScannerFocus, request.initial, request.calibration);
+    return result;
+}
+
+void MuseTargetingWorker::solve(MuseSolveRequest request) {
+    if (request.generation != m_latestGeneration)
+        return;  // superseded while queued
+    MuseSolveResult result = calcSuggestedSettings(request);
+    if (request.generation == m_latestGeneration)
+        emit solved(result);
+}
@@ -0,0 +1,77 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+#ifndef MUSETARGETINGWORKER_H
+#define MUSETARGETINGWORKER_H
+
+#include "MuseInverseKinematics.h"
+#include "MuseIKTable.h"
+#include "MuseReachabilityMap.h"
+#include <QMetaType>
+#include <QObject>
+#include <atomic>
+#include <memory>
+
+/**
+* Everything needed to calculate the suggested settings, copied from the model when the request is made so
+* that the model can change in the meantime. The solver, map and table are shared read-only.
+*/
+struct MuseSolveRequest
+{
+    quint64 generation = 0;                                     // request number, see MuseTargetingWorker
+    core::Vector3 desiredScannerFocus;
+    core::Vector3 calibration;
+    double initial[MuseDOF::Count] = {};                        // initial guess for the solve
+    double current[MuseDOF::Count] = {};                        // current settings, suggested if out of reach
+    std::shared_ptr<const MuseInverseKinematics> ik;            // set up with the limits of the current settings
+    std::shared_ptr<const MuseReachabilityMap> reachabilityMap; // optional
+    std::shared_ptr<const MuseIKTable> ikTable;                 // optional cache, used if built for ik
+};
+Q_DECLARE_METATYPE(MuseSolveRequest)
+
+/** Suggested settings calculated for a MuseSolveRequest */
+struct MuseSolveResult
+{
+    quint64 generation = 0;
+    MuseIKResult solve;
+    bool isReachable = true;                                    // false if the solve was not even attempted
+};
+Q_DECLARE_METATYPE(MuseSolveResult)
+
+/**
+* @brief Calculates the suggested settings on a worker thread.
+*
+* The worker lives in a QThread owned by MuseTargetingModel. Requests and results travel through queued
+* signals. Requests are coalesced: each one carries a generation number, the model publishes the latest with
+* setLatestGeneration(), and the worker skips any request that is no longer the latest when it gets to it,
+* and drops its result if a newer request arrived during the solve. Only the latest desired focus is solved.
+*/
+class MuseTargetingWorker : public QObject
+{
+    Q_OBJECT
+public:
+    /** Constructor */
+    explicit MuseTargetingWorker(QObject *parent = nullptr);
+
+    /** Destructor */
+    ~MuseTargetingWorker() = default;
+
+    /** Marks all the requests older than generation as stale. Thread-safe. */
+    void setLatestGeneration(quint64 generation) { m_latestGeneration = generation; }
+
+    /** Calculates the suggested settings for a request, on the calling thread. */
+    static MuseSolveResult calcSuggestedSettings(const MuseSolveRequest& request);
+
+public slots:
+    /** Solves the request, unless it is stale, and emits solved() if it is still the latest once solved. */
+    void solve(MuseSolveRequest request);
+
+signals:
+    void solved(MuseSolveResult result);
+
+private:
+    std::atomic<quint64> m_latestGeneration;
+};
+
+#endif // MUSETARGETINGWORKER_H
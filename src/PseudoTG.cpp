@@ -0,0 +1,40 @@
+// :--------------------------------------------------------------------------:
+// : Copyright (C) Image Guided Therapy, Pessac, France. All Rights Reserved. :
+// :--------------------------------------------------------------------------:
+
+/**
+* A small app that acts as a stand-in for Thermoguide during testing and dev. It runs as a separate process and
+* talks to the Muse Targeting application over the local transport, like Thermoguide would.
+*
+* Usage:
+*   PseudoTGDriver                                  window to enter an observed focus and send it
+*   PseudoTGDriver --replay file [--rate r]         sends the messages recorded in file, r times faster than
+*                  [--server name]                  recorded (0: as fast as possible, 1 by default)
+*/
+#include "PseudoTGDriver.h"
+#include <QApplication>
+#include <cstring>
+#include <cstdlib>
+
+int main(int argc, char *argv[])
+{
+    QString replayFileName;
+    QString serverName = MuseMessage::ServerName;
+    double rate = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--replay") == 0)
+            replayFileName = argv[i + 1];
+        else if (std::strcmp(argv[i], "--rate") == 0)
+            rate = std::atof(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--server") == 0)
+            serverName = argv[i + 1];
+    }
+    if (!replayFileName.isEmpty())
+        return PseudoTGDriver::replay(replayFileName, rate, serverName);
+
+    QApplication a(argc, argv);
+    PseudoTGDriver p;
+    p.show();
+
+    return a.exec();
+}
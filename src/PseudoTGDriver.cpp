@@ -3,6 +3,13 @@
 // :--------------------------------------------------------------------------:
 
 #include "PseudoTGDriver.h"
+#include <QMessageBox>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <thread>
 
 /** 
 * Constructor. Builds the small pseudoTGDriver app.
@@ -13,17 +20,15 @@ PseudoTGDriver::PseudoTGDriver(QWidget *parent)
 	: QWidget(parent)
 {
 	ui.setupUi(this);
-    mtView.show();
     
     connect(ui.pseudoTGSendButton, SIGNAL(clicked()), this, SLOT(sendButtonClicked()));
-    connect(this, SIGNAL(sendObservedFocus(core::Vector3)), &mtView, SLOT(receiveObservedFocus(core::Vector3)));
 }
 
 /** Destructor */
 PseudoTGDriver::~PseudoTGDriver()
 {}
 
-/** When user clicks the send button, get the observed focus from the edit widgets, then send to MuseTargetingView */
+/** When user clicks the send button, get the observed focus from the edit widgets, then send to Muse Targeting */
 void PseudoTGDriver::sendButtonClicked() {
     // get desired focus from ui
     QString observedXString = ui.pseudoTGObservedXEdit->toPlainText();
@@ -34,6 +39,53 @@ void PseudoTGDriver::sendButtonClicked() {
     of.y() = observedYString.toDouble();
     of.z() = observedZString.toDouble();
 
-    // send focus to MuseTargetingView
-    emit sendObservedFocus(of);
-}
\ No newline at end of file
+    // send focus to Muse Targeting, connecting first if it was not running yet
+    if ((!m_client.isConnected() && !m_client.connectToServer()) || !m_client.sendObservedFocus(of))
+        QMessageBox::warning(this, "Pseudo-Thermoguide", "Could not send the observed focus to Muse Targeting: " + m_client.getErrorString());
+}
+
+int PseudoTGDriver::replay(QString fileName, double rate, QString serverName) {
+    std::ifstream file(fileName.toStdString(), std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot open " << fileName.toStdString() << std::endl;
+        return 1;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    MuseMessageReader reader;
+    reader.append(data.data(), data.size());
+
+    MuseTargetingClient client;
+    if (!client.connectToServer(serverName)) {
+        std::cerr << "Cannot connect to " << serverName.toStdString() << ": " << client.getErrorString().toStdString() << std::endl;
+        return 1;
+    }
+
+    // keep the recorded intervals, divided by rate. Each is measured from the previous message: the recorder
+    // appends the sessions to the same file, and the clock of a later one may restart lower (after a reboot),
+    // in which case the message is sent right away.
+    MuseMessage message, reply;
+    uint64_t previousTimestamp = 0;
+    size_t count = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point due = start;
+    while (reader.next(message)) {
+        if (rate > 0) {
+            int64_t interval = count == 0 ? 0 : int64_t(message.timestamp - previousTimestamp);
+            due += std::chrono::microseconds(int64_t(std::max<int64_t>(interval, 0) / rate));
+            std::this_thread::sleep_until(due);
+        }
+        previousTimestamp = message.timestamp;
+        if (!client.send(message)) {
+            std::cerr << "Replay interrupted after " << count << " messages: " << client.getErrorString().toStdString() << std::endl;
+            return 1;
+        }
+        ++count;
+        while (client.receive(reply, 0)) {}   // the suggested settings sent back are not used
+    }
+    double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (reader.hasError())
+        std::cerr << "Invalid message in " << fileName.toStdString() << ", replay stopped there" << std::endl;
+    std::cout << "Replayed " << count << " messages in " << duration << " s (" << count / std::max(duration, 1e-9)
+        << " messages/s)" << std::endl;
+    return reader.hasError() ? 1 : 0;
+}
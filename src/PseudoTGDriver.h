@@ -5,13 +5,14 @@
 #include <QWidget>
 #include "ui_PseudoTGDriver.h"
 #include "../libs/libCore/Core/Maths/Vector3.h"
-#include "MuseTargetingView.h"
+#include "MuseTargetingClient.h"
 
 /**
 * Qwidget class to display a single window to act as a stand-in for Thermoguide during testing and dev. 
 * *
 * This window allows user to enter observed focus x, y, and z, and to click a button which will send
-* the observed focus to Muse Targeting window.
+* the observed focus to the Muse Targeting application, a separate process, over the local transport
+* (see MuseTargetingClient).
 */
 class PseudoTGDriver : public QWidget
 {
@@ -21,13 +22,16 @@ public:
 	PseudoTGDriver(QWidget *parent = Q_NULLPTR);
 	~PseudoTGDriver();
 
+	/**
+	* Sends the messages recorded in fileName (MuseMessage format) to Muse Targeting, without any window. The
+	* recorded timing is kept, sped up by rate (0: as fast as possible). Returns the exit code of the app.
+	*/
+	static int replay(QString fileName, double rate, QString serverName = MuseMessage::ServerName);
+
 private slots:
 	void sendButtonClicked();
 
-signals:
-	void sendObservedFocus(core::Vector3 of);
-
 private:
 	Ui::PseudoTGDriver ui;
-	MuseTargetingView mtView;
+	MuseTargetingClient m_client;
 };
@@ -0,0 +1,328 @@
+#include <catch2/catch.hpp>
+#include "MuseKinematics.h"
+#include "MuseMessage.h"
+#include "MuseReachabilityMap.h"
+#include "MuseTargetingClient.h"
+#include "../libs/libCore/Core/Maths/FrameTransform.h"
+#include "../libs/libCore/Core/Maths/Matrix.h"
+#include "../libs/libCore/Core/Maths/PolygonQuery.h"
+#include "../libs/libCore/Core/Maths/PolygonRaster.h"
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+
+// Built in the mtBenchmarks target (CATCH_CONFIG_ENABLE_BENCHMARKING), run with: mtBenchmarks "[!benchmark]"
+
+
+namespace {
+
+/** core::Matrix product before the blocked kernel: plain triple loop */
+core::Matrix previousProduct(const core::Matrix& lhs, const core::Matrix& rhs) {
+    core::Matrix res(rhs.columns(), lhs.rows());
+    for (int j = 0; j < res.rows(); ++j) {
+        for (int i = 0; i < res.columns(); ++i) {
+            double c = 0;
+            for (int k = 0; k < lhs.columns(); ++k)
+                c += lhs[k * lhs.rows() + i] * rhs[j * rhs.columns() + k];
+            res[j * res.columns() + i] = c;
+        }
+    }
+    return res;
+}
+
+/** core::solve before the LU factorization: Gaussian elimination of a copy, for each right-hand side */
+core::Matrix previousSolve(const core::Matrix& A, const core::Matrix& b) {
+    const int n = A.rows();
+    core::Matrix mat(A), vec(b);
+    for (int j0 = 0; j0 < n; ++j0) {
+        int pindex = j0;
+        for (int j = j0 + 1; j < n; ++j) {
+            if (std::abs(mat[j * n + j0]) > std::abs(mat[pindex * n + j0]))
+                pindex = j;
+        }
+        if (pindex != j0) {
+            for (int i = j0; i < n; ++i)
+                std::swap(mat[j0 * n + i], mat[pindex * n + i]);
+            std::swap(vec[j0], vec[pindex]);
+        }
+        double pivot = mat[j0 * (n + 1)];
+        for (int j = j0 + 1; j < n; ++j) {
+            double k = mat[j * n + j0] / pivot;
+            for (int i = 0; i < n; ++i)
+                mat[j * n + i] -= k * mat[j0 * n + i];
+            vec[j] -= k * vec[j0];
+        }
+    }
+    core::Matrix res(n, 1);
+    for (int k = n - 1; k >= 0; --k) {
+        res[k] = vec[k];
+        for (int i = k + 1; i < n; ++i)
+            res[k] -= mat[k * n + i] * res[i];
+        res[k] /= mat[k * (n + 1)];
+    }
+    return res;
+}
+
+/** Mean duration of f in seconds, repeated for about budget seconds */
+template <typename F>
+double timeOf(F f, double budget = 0.2) {
+    int count = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double duration = 0;
+    do {
+        f();
+        ++count;
+        duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (duration < budget);
+    return duration / count;
+}
+
+} // namespace
+
+
+TEST_CASE("Benchmark.reachabilitySweep", "[!benchmark]")
+{
+    // sweep throughput of the reachability map, in foci per second
+    MuseKinematics k;
+    MuseReachabilityMap map(k);
+    std::cout << "Batch kinematics: " << MuseKinematics::simdKernelName() << std::endl;
+    const unsigned threadCounts[2] = { 1, 0 };   // 0: all cores
+    for (double voxelSize = 4.0; voxelSize >= 2.0; voxelSize /= 2) {
+        for (unsigned threadCount : threadCounts) {
+            map.build(voxelSize, threadCount);
+            std::cout << "voxel " << voxelSize << " mm, " << (threadCount == 1 ? "1 thread" : "all cores") << ": "
+                << map.getNumFoci() << " foci in " << map.getBuildTime() << " s, "
+                << map.getNumFoci() / map.getBuildTime() / 1e6 << " Mfoci/s" << std::endl;
+        }
+    }
+
+    BENCHMARK("Reachability map 4 mm") {
+        map.build(4.0);
+        return map.getNumReachable();
+    };
+}
+
+TEST_CASE("Benchmark.localTransport", "[!benchmark]")
+{
+    // round trip and throughput of the local transport. The server side echoes pings and counts the foci,
+    // like MuseTargetingServer without the model, so this measures the transport and the message format only.
+    int argc = 1;
+    char name[] = "mtBenchmarks";
+    char* argv[] = { name };
+    QCoreApplication app(argc, argv);
+    const QString serverName = "MuseTargetingBenchmark";
+    std::atomic<bool> isListening(false);
+    std::atomic<uint64_t> numFoci(0);
+    QThread* serverThread = QThread::create([&]() {
+        QLocalServer server;
+        QLocalServer::removeServer(serverName);
+        isListening = server.listen(serverName);
+        if (!isListening || !server.waitForNewConnection(5000))
+            return;
+        QLocalSocket* socket = server.nextPendingConnection();
+        MuseMessageReader reader;
+        MuseMessage message;
+        uint8_t data[MuseMessage::MaxSize];
+        while (socket->state() == QLocalSocket::ConnectedState && socket->waitForReadyRead(5000)) {
+            QByteArray bytes = socket->readAll();
+            reader.append(bytes.constData(), bytes.size());
+            while (reader.next(message)) {
+                if (message.type == MuseMessage::Ping) {
+                    message.type = MuseMessage::Pong;
+                    socket->write(reinterpret_cast<const char*>(data), message.encode(data));
+                    socket->flush();
+                }
+                else if (message.type == MuseMessage::ObservedFocus)
+                    ++numFoci;
+            }
+        }
+    });
+    serverThread->start();
+    while (!isListening && serverThread->isRunning())
+        QThread::msleep(1);
+
+    MuseTargetingClient client;
+    REQUIRE(client.connectToServer(serverName));
+
+    // latency: one ping at a time
+    std::vector<double> roundTrips;
+    for (int i = 0; i < 10000; ++i)
+        roundTrips.push_back(client.ping());
+    std::sort(roundTrips.begin(), roundTrips.end());
+    CHECK(roundTrips.front() >= 0);
+    std::cout << "Round trip (us): median " << roundTrips[roundTrips.size() / 2] << ", 99% "
+        << roundTrips[roundTrips.size() * 99 / 100] << ", max " << roundTrips.back() << std::endl;
+
+    // throughput: a stream of observed foci, then a ping to know they all arrived
+    const int count = 200000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+        client.sendObservedFocus(core::Vector3(i, 0, 0));
+    CHECK(client.ping(5000) >= 0);
+    double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    CHECK(numFoci == (uint64_t)count);
+    std::cout << "Observed foci: " << count / duration / 1e3 << " k messages/s, "
+        << count * MuseMessage::makeFocus(MuseMessage::ObservedFocus, core::Vector3()).getSize() / duration / 1e6
+        << " MB/s" << std::endl;
+
+    client.disconnectFromServer();
+    serverThread->wait();
+    delete serverThread;
+
+    BENCHMARK("Encode and decode 1000 observed foci") {
+        std::vector<uint8_t> buffer;
+        for (int i = 0; i < 1000; ++i)
+            MuseMessage::makeFocus(MuseMessage::ObservedFocus, core::Vector3(i, 1, 2)).encode(buffer);
+        MuseMessageReader reader;
+        reader.append(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        MuseMessage message;
+        double sum = 0;
+        while (reader.next(message))
+            sum += message.values[0];
+        return sum;
+    };
+}
+
+TEST_CASE("Benchmark.matrix", "[!benchmark]")
+{
+    // core::Matrix product and solve, against the implementations they replaced
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    for (int n : { 3, 8, 32, 128, 512, 1024 }) {
+        core::Matrix a(n), b(n), rhs(1, n);
+        for (int k = 0; k < n * n; ++k) {
+            a[k] = value(generator);
+            b[k] = value(generator);
+        }
+        for (int k = 0; k < n; ++k)
+            rhs[k] = value(generator);
+
+        double flops = 2.0 * n * n * n;
+        double previous = timeOf([&]() { previousProduct(a, b); });
+        double blocked = timeOf([&]() { a * b; });
+        std::cout << "product " << n << "x" << n << ": " << flops / previous / 1e9 << " GFlop/s before, "
+            << flops / blocked / 1e9 << " GFlop/s blocked, x" << previous / blocked << std::endl;
+
+        // one right-hand side, then 16 with the same matrix: the LU factors are reused, not the elimination
+        previous = timeOf([&]() { previousSolve(a, rhs); });
+        double lu = timeOf([&]() { core::solve(a, rhs); });
+        core::LUDecomposition factors(a);
+        double resolve = timeOf([&]() { factors.solve(rhs); });
+        std::cout << "solve " << n << ": " << previous * 1e6 << " us before, " << lu * 1e6 << " us LU, "
+            << 16 * previous * 1e6 << " us vs " << (lu + 15 * resolve) * 1e6 << " us for 16 right-hand sides" << std::endl;
+    }
+
+    core::Matrix m(3);
+    BENCHMARK("3x3 product") {
+        return (m * m)[0];
+    };
+}
+
+TEST_CASE("Benchmark.polygonQuery", "[!benchmark]")
+{
+    // point-in-polygon tests per second: Polygon::isIn against the prepared query
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    for (int n : { 4, 32, 256, 2048 }) {
+        core::Polygon::Vertices vertices;
+        for (int i = 0; i < n; ++i) {
+            double angle = 2 * core::IGT_PI * i / n, radius = (i % 2) ? 0.5 : 1.0;
+            vertices.push_back(core::Point3(radius * std::cos(angle), radius * std::sin(angle), 0));
+        }
+        core::Polygon polygon(vertices);
+        std::vector<core::Point3> points(1 << 16);
+        for (core::Point3& p : points)
+            p = core::Point3(value(generator), value(generator), 0);
+        std::unique_ptr<bool[]> inside(new bool[points.size()]);
+
+        double isIn = timeOf([&]() { for (int k = 0; k < 1024; ++k) inside[k] = polygon.isIn(points[k]); }) / 1024;
+        core::PolygonQuery query(polygon);
+        double prepared = timeOf([&]() { query.isIn(points.data(), int(points.size()), inside.get(), 1); }) / points.size();
+        double threads = timeOf([&]() { query.isIn(points.data(), int(points.size()), inside.get()); }) / points.size();
+        std::cout << "isIn " << n << " vertices: " << 1e-6 / isIn << " M/s Polygon, " << 1e-6 / prepared
+            << " M/s PolygonQuery, " << 1e-6 / threads << " M/s threaded" << std::endl;
+    }
+}
+
+TEST_CASE("Benchmark.polygonMask", "[!benchmark]")
+{
+    // an ROI mask, from Polygon::isIn on each pixel, from the prepared query, and by scanlines
+    const unsigned size = 512;
+    for (int n : { 8, 64, 512 }) {
+        core::Polygon::Vertices vertices;
+        for (int i = 0; i < n; ++i) {
+            double angle = 2 * core::IGT_PI * i / n, radius = (i % 2) ? 150 : 240;
+            vertices.push_back(core::Point3(256 + radius * std::cos(angle), 256 + radius * std::sin(angle), 0));
+        }
+        core::Polygon polygon(vertices);
+        core::Mask mask(size, size);
+
+        double isIn = timeOf([&]() {
+            for (unsigned y = 0; y < size; ++y)
+                for (unsigned x = 0; x < size; ++x)
+                    mask(x, y) = polygon.isIn(core::Point3(x, y, 0));
+        });
+        double query = timeOf([&]() {
+            core::PolygonQuery prepared(polygon);
+            for (unsigned y = 0; y < size; ++y)
+                for (unsigned x = 0; x < size; ++x)
+                    mask(x, y) = prepared.isIn(core::Point3(x, y, 0));
+        });
+        double scanlines = timeOf([&]() { core::rasterize(polygon, mask); });
+        core::Image<float> coverage(size, size);
+        double antialiased = timeOf([&]() { core::rasterizeCoverage(polygon, coverage); });
+        std::cout << "mask " << size << "x" << size << ", " << n << " vertices: " << isIn * 1e3 << " ms isIn, "
+            << query * 1e3 << " ms PolygonQuery, " << scanlines * 1e3 << " ms scanlines (x" << isIn / scanlines << "), "
+            << antialiased * 1e3 << " ms coverage" << std::endl;
+    }
+}
+
+TEST_CASE("Benchmark.triangulate", "[!benchmark]")
+{
+    // monotone partition triangulation of stars (all the inner vertices reflex)
+    for (int n : { 128, 2048, 32768 }) {
+        core::Polygon::Vertices vertices;
+        for (int i = 0; i < n; ++i) {
+            double angle = 2 * core::IGT_PI * i / n, radius = (i % 2) ? 40 : 100;
+            vertices.push_back(core::Point3(radius * std::cos(angle), radius * std::sin(angle), 0));
+        }
+        core::Polygon polygon(vertices);
+        std::vector<int> indices;
+        double time = timeOf([&]() { indices = polygon.getTriangleIndices(); });
+        std::cout << "triangulate " << n << " vertices: " << indices.size() / 3 << " triangles in " << time * 1e3 << " ms" << std::endl;
+    }
+}
+
+TEST_CASE("Benchmark.frameTransform", "[!benchmark]")
+{
+    // a cloud of points from one trihedron to another: per point as before, then prepared once
+    core::Trihedron scanner(core::Point3(10, -20, 30), core::Vector3(0, 1, 0), core::Vector3(0, 0, 1), core::Vector3(1, 0, 0));
+    core::Trihedron transducer(core::Point3(-5, 4, 120), core::Vector3(1, 0, 0), core::Vector3(0, 0.8, 0.6), core::Vector3(0, -0.6, 0.8));
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> value(-100.0, 100.0);
+    const size_t count = 1 << 16;
+    std::vector<core::Point3> points(count), out(count);
+    std::vector<double> x(count), y(count), z(count);
+    for (size_t k = 0; k < count; ++k) {
+        points[k] = core::Point3(value(generator), value(generator), value(generator));
+        x[k] = points[k][0];
+        y[k] = points[k][1];
+        z[k] = points[k][2];
+    }
+
+    double xformTo = timeOf([&]() { for (size_t k = 0; k < count; ++k) out[k] = scanner.xformTo(transducer, points[k]); }) / count;
+    double prepared = timeOf([&]() {
+        core::FrameTransform t(scanner, transducer);
+        t.xform(points.data(), out.data(), count);
+    }) / count;
+    core::FrameTransform t(scanner, transducer);
+    double arrays = timeOf([&]() { t.xform(x.data(), y.data(), z.data(), x.data(), y.data(), z.data(), count); }) / count;
+    std::cout << "frame transform " << count << " points: " << xformTo * 1e9 << " ns/point xformTo, " << prepared * 1e9
+        << " ns/point FrameTransform (x" << xformTo / prepared << "), " << arrays * 1e9 << " ns/point by coordinates" << std::endl;
+}
@@ -0,0 +1,147 @@
+#include <catch2/catch.hpp>
+#include "MuseCalibration.cpp"
+#include <random>
+
+
+TEST_CASE("Calibration.offset", "[calibration]")
+{
+    // least-squares offset of noisy observations
+    MuseCalibration c;
+    CHECK_FALSE(c.isCalibrated());
+    const core::Vector3 offset(2.5, -1, 4);
+    std::mt19937 generator(1);
+    std::normal_distribution<double> noise(0.0, 0.3);
+    for (int i = 0; i < 200; ++i) {
+        core::Vector3 t(i % 20 - 10, -55 + i % 7, i % 11 - 5);
+        CHECK(c.addObservation(t, t + offset + core::Vector3(noise(generator), noise(generator), noise(generator))));
+    }
+    CHECK(c.isCalibrated());
+    CHECK(c.getNumAccepted() == 200);
+    CHECK(c.getOffset().isClose(offset, 0.1));
+    CHECK(c.getRotation() == core::Vector3(0, 0, 0));
+    CHECK(c.getRMSResidual() == Approx(0.3 * std::sqrt(3.0)).epsilon(0.15));
+
+    // standard deviation of the mean of 200 observations, at the default 1 mm noise
+    CHECK(c.getOffsetUncertainty().x() == Approx(1 / std::sqrt(200.0)).epsilon(0.01));
+    c.setMeasurementNoise(0.1);
+    CHECK(c.getOffsetUncertainty().y() == Approx(0.3 / std::sqrt(200.0)).epsilon(0.15));
+
+    // one observation: the plain difference
+    MuseCalibration one;
+    one.addObservation(core::Vector3(1, -50, 2), core::Vector3(3, -49, 0));
+    CHECK(one.getOffset().isClose(core::Vector3(2, 1, -2), 1e-6));
+    CHECK(one.getRMSResidual() == Approx(0).margin(1e-6));
+}
+
+TEST_CASE("Calibration.rotation", "[calibration]")
+{
+    // small rotation about the first theoretical focus, recovered once the foci are spread
+    const core::Vector3 offset(1, 2, -3), rotation(0.01, -0.02, 0.015);
+    const core::Vector3 reference(0, -55, 0);
+    MuseCalibration c;
+    c.setRotationEnabled(true);
+    c.addObservation(reference, reference + offset);
+    for (int i = 0; i < 27; ++i) {
+        core::Vector3 t = reference + core::Vector3(i % 3 - 1, i / 3 % 3 - 1, i / 9 - 1) * 30.0;
+        c.addObservation(t, t + offset + (rotation ^ (t - reference)));
+    }
+    CHECK(c.getReference() == reference);
+    CHECK(c.getOffset().isClose(offset, 0.01));
+    CHECK(c.getRotation().isClose(rotation, 1e-3));
+    core::Vector3 t(20, -40, 10);
+    CHECK(c.getOffset(t).isClose(offset + (rotation ^ (t - reference)), 0.05));
+    core::Vector3 u = c.getOffsetUncertainty(), uFar = c.getOffsetUncertainty(t);
+    CHECK(u.x() > 0);
+    CHECK(uFar.x() > u.x());
+
+    // without rotation, the same observations only give the mean offset
+    c.setRotationEnabled(false);
+    CHECK(c.getRotation() == core::Vector3(0, 0, 0));
+    CHECK(c.getOffset().isClose(offset, 1e-6));
+}
+
+TEST_CASE("Calibration.outliers", "[calibration]")
+{
+    MuseCalibration c;
+    const core::Vector3 offset(0, 3, 0);
+    for (int i = 0; i < 5; ++i) {
+        core::Vector3 t(i, -55, -i);
+        c.addObservation(t, t + offset + core::Vector3(0.1 * (i % 2), 0, 0));
+    }
+    core::Vector3 fitted = c.getOffset();
+
+    // far from the fit: kept but not used
+    CHECK_FALSE(c.addObservation(core::Vector3(0, -55, 0), core::Vector3(0, -35, 0)));
+    CHECK(c.getNumRejected() == 1);
+    CHECK(c.getObservations().size() == 6);
+    CHECK(c.getOffset() == fitted);
+
+    // removing observations undoes them
+    CHECK(c.addObservation(core::Vector3(0, -55, 0), core::Vector3(1, -52, 0)));
+    CHECK(c.getOffset() != fitted);
+    c.removeLastObservation();
+    CHECK(c.getOffset().isClose(fitted, 1e-9));
+    CHECK(c.getNumAccepted() == 5);
+    c.setOutlierThreshold(0);
+    CHECK(c.addObservation(core::Vector3(0, -55, 0), core::Vector3(0, -35, 0)));
+    c.clear();
+    CHECK_FALSE(c.isCalibrated());
+    CHECK(c.getObservations().empty());
+}
+
+TEST_CASE("Calibration.recursive", "[calibration]")
+{
+    // folding in one observation at a time gives the batch fit, and removing them gives back the previous fits
+    MuseCalibration c, batch;
+    c.setRotationEnabled(true);
+    c.setOutlierThreshold(0);
+    std::vector<core::Vector3> offsets, uncertainties;
+    std::mt19937 generator(2);
+    std::uniform_real_distribution<double> position(-40, 40), noise(-0.5, 0.5);
+    for (int i = 0; i < 50; ++i) {
+        core::Vector3 t(position(generator), -55 + position(generator) / 2, position(generator));
+        core::Vector3 o = t + core::Vector3(1 + noise(generator), -2 + noise(generator), noise(generator)) + (core::Vector3(0, 0.02, 0) ^ t);
+        offsets.push_back(c.getOffset());
+        uncertainties.push_back(c.getOffsetUncertainty());
+        c.addObservation(t, o);
+    }
+    batch = c;
+    batch.setRotationEnabled(true);   // refits from scratch
+    CHECK(batch.getOffset().isClose(c.getOffset(), 1e-6));
+    CHECK(batch.getRotation().isClose(c.getRotation(), 1e-9));
+    CHECK(c.getRotation().y() == Approx(0.02).margin(0.005));
+    for (int i = 49; i >= 40; --i) {
+        c.removeLastObservation();
+        CHECK(c.getOffset().isClose(offsets[i], 1e-6));
+        CHECK(c.getOffsetUncertainty().isClose(uncertainties[i], 1e-6));
+    }
+}
+
+TEST_CASE("Calibration.removeAll", "[calibration]")
+{
+    // settings entered again for the first observation: remove it, then add the corrected one
+    for (bool isRotationEnabled : { false, true }) {
+        MuseCalibration c;
+        c.setRotationEnabled(isRotationEnabled);
+        c.addObservation(core::Vector3(0, -50, 0), core::Vector3(5, -50, 0));
+        c.removeLastObservation();
+        CHECK_FALSE(c.isCalibrated());
+        CHECK(c.getOffset() == core::Vector3(0, 0, 0));
+        CHECK(std::isfinite(c.getOffsetUncertainty().x()));
+
+        c.addObservation(core::Vector3(10, -55, 5), core::Vector3(11, -57, 5));
+        CHECK(c.getReference() == core::Vector3(10, -55, 5));
+        CHECK(c.getOffset().isClose(core::Vector3(1, -2, 0), 1e-6));
+        c.addObservation(core::Vector3(-10, -50, 0), core::Vector3(-9, -52, 0));
+        CHECK(c.getOffset(core::Vector3(-10, -50, 0)).isClose(core::Vector3(1, -2, 0), 1e-3));
+        for (int axis = 0; axis < 3; ++axis)
+            CHECK(std::isfinite(c.getOffsetUncertainty()[axis]));
+
+        // back to one observation, then none
+        c.removeLastObservation();
+        CHECK(c.getOffset().isClose(core::Vector3(1, -2, 0), 1e-6));
+        c.removeLastObservation();
+        CHECK(c.getOffset() == core::Vector3(0, 0, 0));
+        CHECK(c.getNumAccepted() == 0);
+    }
+}
@@ -0,0 +1,140 @@
+#include <catch2/catch.hpp>
+#include "MuseFocusStream.cpp"
+#include "MuseTargetingModel.h"
+#include <QCoreApplication>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+TEST_CASE("FocusStream.averaging", "[stream]")
+{
+    MuseFocusStream stream(16);
+    CHECK(stream.getCapacity() == 16);
+    CHECK_FALSE(stream.update());
+
+    // latest sample only
+    for (int i = 1; i <= 5; ++i)
+        stream.push(core::Vector3(i, 2 * i, -i));
+    CHECK(stream.update());
+    CHECK(stream.getEstimate() == core::Vector3(5, 10, -5));
+    CHECK_FALSE(stream.update());
+
+    // mean of the last 4 kept samples
+    stream.setAveraging(4);
+    for (int i = 1; i <= 6; ++i)
+        stream.push(core::Vector3(i, 0, 0));
+    CHECK(stream.update());
+    CHECK(stream.getEstimate().x() == Approx((3 + 4 + 5 + 6) / 4.0));
+
+    // one sample in 3, averaged over 2: keeps 1, 4, 7, 10
+    stream.clear();
+    stream.setDecimation(3);
+    stream.setAveraging(2);
+    for (int i = 1; i <= 10; ++i)
+        stream.push(core::Vector3(i, 0, 0));
+    CHECK(stream.update());
+    CHECK(stream.getEstimate().x() == Approx((7 + 10) / 2.0));
+    CHECK(stream.getNumDropped() == 0);
+}
+
+TEST_CASE("FocusStream.dropOldest", "[stream]")
+{
+    // the producer never blocks: the oldest samples are overwritten
+    MuseFocusStream stream(8);
+    stream.setAveraging(8);
+    for (int i = 0; i < 20; ++i)
+        stream.push(core::Vector3(i, 0, 0));
+    CHECK(stream.update());
+    CHECK(stream.getNumPushed() == 20);
+    CHECK(stream.getNumDropped() == 12);
+    CHECK(stream.getEstimate().x() == Approx((12 + 19) / 2.0));
+}
+
+TEST_CASE("FocusStream.decimationPhase", "[stream]")
+{
+    // one sample in 5 by position: the samples dropped do not shift the kept ones
+    MuseFocusStream stream(8);
+    stream.setDecimation(5);
+    stream.push(core::Vector3(0, 0, 0));
+    CHECK(stream.update());
+    for (int i = 1; i < 22; ++i)
+        stream.push(core::Vector3(i, 0, 0));
+    CHECK(stream.update());
+    CHECK(stream.getNumDropped() == 13);
+    CHECK(stream.getEstimate().x() == 20);
+}
+
+TEST_CASE("FocusStream.threads", "[stream]")
+{
+    // concurrent producer: every estimate is a whole sample (no torn reads), and never goes back in time
+    MuseFocusStream stream(64);
+    const int n = 200000;
+    std::thread producer([&stream]() {
+        for (int i = 1; i <= n; ++i)
+            stream.push(core::Vector3(i, i, i));
+    });
+    double last = 0;
+    bool isConsistent = true;
+    while (last < n) {
+        if (stream.update()) {
+            const core::Vector3& f = stream.getEstimate();
+            isConsistent = isConsistent && f.x() == f.y() && f.y() == f.z() && f.x() >= last;
+            last = f.x();
+        }
+    }
+    producer.join();
+    CHECK(isConsistent);
+    CHECK(stream.getNumPushed() == (uint64_t)n);
+}
+
+TEST_CASE("FocusStream.notifier", "[stream]")
+{
+    // one notification when the stream goes from drained to pending
+    MuseFocusStream stream(64);
+    std::atomic<int> notifications(0);
+    stream.setNotifier([&notifications]() { ++notifications; });
+    for (int i = 0; i < 10; ++i)
+        stream.push(core::Vector3(i, 0, 0));
+    CHECK(notifications == 1);
+    CHECK(stream.update());
+    CHECK_FALSE(stream.update());
+    stream.push(core::Vector3(10, 0, 0));
+    stream.push(core::Vector3(11, 0, 0));
+    CHECK(notifications == 2);
+
+    // a consumer that only updates when notified gets to the last sample of a concurrent producer
+    std::atomic<bool> isPending(false);
+    stream.setNotifier([&isPending]() { isPending = true; });
+    stream.update();
+    const int n = 200000;
+    std::thread producer([&stream]() {
+        for (int i = 1; i <= n; ++i)
+            stream.push(core::Vector3(i, 0, 0));
+    });
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (stream.getEstimate().x() != n && std::chrono::steady_clock::now() < deadline) {
+        if (isPending.exchange(false))
+            stream.update();
+    }
+    producer.join();
+    CHECK(stream.getEstimate().x() == n);
+}
+
+TEST_CASE("FocusStream.model", "[stream]")
+{
+    // a producer on another thread: the model drains the stream from its event loop
+    int argc = 1;
+    char name[] = "mtTests";
+    char* argv[] = { name };
+    QCoreApplication app(argc, argv);
+    MuseTargetingModel model;
+    std::thread producer([&model]() {
+        for (int i = 1; i <= 100; ++i)
+            model.getObservedFocusStream().push(core::Vector3(i, 2, 3));
+    });
+    producer.join();
+    CHECK(model.getObservedFocus() == core::Vector3(0, 0, 0));
+    QCoreApplication::processEvents();
+    CHECK(model.getObservedFocus() == core::Vector3(100, 2, 3));
+}
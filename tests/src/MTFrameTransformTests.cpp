@@ -0,0 +1,85 @@
+#include <catch2/catch.hpp>
+#include "../libs/libCore/Core/Maths/FrameTransform.h"
+#include "../libs/libCore/Core/CoreExceptions.h"
+#include <random>
+#include <vector>
+
+
+namespace {
+
+/** A trihedron with random axes, not orthonormal */
+core::Trihedron randomTrihedron(std::mt19937& generator) {
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    core::Vector3 x(2 + value(generator), value(generator), value(generator));
+    core::Vector3 y(value(generator), 2 + value(generator), value(generator));
+    core::Vector3 z(value(generator), value(generator), 2 + value(generator));
+    return core::Trihedron(core::Point3(100 * value(generator), 100 * value(generator), 100 * value(generator)), x, y, z);
+}
+
+bool isClose(const core::Vector3& a, const core::Vector3& b) {
+    return a[0] == Approx(b[0]).margin(1e-9) && a[1] == Approx(b[1]).margin(1e-9) && a[2] == Approx(b[2]).margin(1e-9);
+}
+
+} // namespace
+
+
+TEST_CASE("FrameTransform.trihedrons", "[frame]")
+{
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> value(-200.0, 200.0);
+    for (int k = 0; k < 20; ++k) {
+        core::Trihedron scanner = randomTrihedron(generator), transducer = randomTrihedron(generator);
+        core::FrameTransform toTransducer(scanner, transducer);
+        core::Point3 p(value(generator), value(generator), value(generator));
+        CHECK(isClose(toTransducer.xform(p), scanner.xformTo(transducer, p)));
+        CHECK(isClose(toTransducer.inverse().xform(toTransducer.xform(p)), p));
+        core::Vector4 v = scanner.xformTo(transducer, core::Vector4(p, 0.0));
+        CHECK(isClose(toTransducer.xformVector(p), core::Vector3(v[0], v[1], v[2])));
+        CHECK(toTransducer.xform(core::Vector4(p, 0.0))[3] == 0.0);
+
+        // scanner to transducer to patient, composed
+        core::Trihedron patient = randomTrihedron(generator);
+        core::FrameTransform toPatient = core::FrameTransform(transducer, patient) * toTransducer;
+        CHECK(isClose(toPatient.xform(p), core::FrameTransform(scanner, patient).xform(p)));
+        CHECK(isClose(toPatient.xform(p), transducer.xformTo(patient, scanner.xformTo(transducer, p))));
+    }
+
+    core::Point3 p(1, 2, 3);
+    CHECK(core::FrameTransform().xform(p) == p);
+    CHECK(core::FrameTransform(core::Trihedron(core::Point3(1, 1, 1)), core::Trihedron()).xform(p) == core::Point3(2, 3, 4));
+    core::Matrix4 notHomogeneous = core::FrameTransform().getMatrix();
+    notHomogeneous[3][0] = 1;
+    CHECK_THROWS_AS(core::FrameTransform(notHomogeneous), core::IGTInvalidParameterErr);
+}
+
+TEST_CASE("FrameTransform.arrays", "[frame]")
+{
+    // the arrays give the single point results (up to the multiply-adds the compiler may contract), in place or not
+    std::mt19937 generator(2);
+    std::uniform_real_distribution<double> value(-200.0, 200.0);
+    core::FrameTransform t(randomTrihedron(generator), randomTrihedron(generator));
+    for (size_t count : { 0, 1, 3, 8, 1001 }) {
+        std::vector<core::Point3> points(count), out(count);
+        std::vector<double> x(count), y(count), z(count), xOut(count), yOut(count), zOut(count);
+        for (size_t k = 0; k < count; ++k) {
+            points[k] = core::Point3(value(generator), value(generator), value(generator));
+            x[k] = points[k][0];
+            y[k] = points[k][1];
+            z[k] = points[k][2];
+        }
+        t.xform(points.data(), out.data(), count);
+        t.xform(x.data(), y.data(), z.data(), xOut.data(), yOut.data(), zOut.data(), count);
+        int mismatches = 0;
+        for (size_t k = 0; k < count; ++k) {
+            core::Point3 q = t.xform(points[k]);
+            mismatches += !isClose(out[k], q) + !isClose(core::Vector3(xOut[k], yOut[k], zOut[k]), q);
+        }
+        CHECK(mismatches == 0);
+
+        t.xform(points.data(), points.data(), count);
+        t.xform(x.data(), y.data(), z.data(), x.data(), y.data(), z.data(), count);
+        for (size_t k = 0; k < count; ++k)
+            mismatches += (points[k][0] != out[k][0]) + (points[k][2] != out[k][2]) + (x[k] != xOut[k]) + (z[k] != zOut[k]);
+        CHECK(mismatches == 0);
+    }
+}
@@ -0,0 +1,137 @@
+#include <catch2/catch.hpp>
+#include "MuseIKTable.cpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+
+TEST_CASE("IKTable.lookup", "[IK]")
+{
+    // a coarse table around known settings: the lookup reaches their focus
+    MuseKinematics k;
+    MuseInverseKinematics ik(k);
+    core::Vector3 calibration(2, -1, 4);
+    double target[MuseDOF::Count] = { 25, 30, 5, 10, -8, 12 };
+    core::Vector3 jacobian[MuseDOF::Count];
+    core::Vector3 desired = k.calcScannerFocus(target, calibration, jacobian);
+
+    MuseIKTable table(ik);
+    CHECK_FALSE(table.isValid());
+    core::Vector3 focus = desired - core::Vector3(-calibration.x(), calibration.y(), calibration.z());
+    table.build(focus - core::Vector3(10, 10, 10), focus + core::Vector3(10, 10, 10), 5, 2);
+    CHECK(table.isValid());
+    CHECK(table.getNumNodes() == 125);
+
+    MuseIKResult res = table.lookup(desired, calibration);
+    CHECK(res.converged);
+    CHECK(res.error < table.getTolerance());
+    CHECK(k.calcScannerFocus(res.settings, calibration, jacobian).isClose(desired, table.getTolerance()));
+    CHECK(table.isBuiltFor(ik));
+    MuseInverseKinematics other(k);
+    other.setLimits(MuseDOF::Psi, 0, 30);
+    CHECK_FALSE(table.isBuiltFor(other));
+}
+
+TEST_CASE("IKTable.thetaWrap", "[IK]")
+{
+    // nodes on both sides of theta = 0/360 hold the same orientation: the interpolated settings only need
+    // the single refine step, within the limits
+    MuseKinematics k;
+    MuseInverseKinematics ik(k);
+    core::Vector3 jacobian[MuseDOF::Count];
+    double target[MuseDOF::Count] = { 25, 1, 5, 10, -8, 12 };
+    core::Vector3 desired = k.calcScannerFocus(target, core::Vector3(), jacobian);
+    MuseIKTable table(ik);
+    table.build(desired - core::Vector3(6, 6, 6), desired + core::Vector3(6, 6, 6), 3, 2);
+    const std::string fileName = "MTIKTableTests.bin";
+    REQUIRE(table.save(fileName));
+
+    // turn theta by a full turn on every other node along x
+    std::string bytes;
+    {
+        std::ifstream file(fileName.c_str(), std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    unsigned sigSize = 0;
+    std::memcpy(&sigSize, &bytes[8], sizeof(sigSize));
+    const size_t nodesAt = 8 + sizeof(sigSize) + sigSize * sizeof(double) + 4 * sizeof(double) + 3 * sizeof(int);
+    REQUIRE(bytes.size() == nodesAt + table.getNumNodes() * MuseDOF::Count * sizeof(float));
+    for (size_t n = 0; n < table.getNumNodes(); n += 2) {
+        float theta;
+        std::memcpy(&theta, &bytes[nodesAt + (n * MuseDOF::Count + MuseDOF::Theta) * sizeof(float)], sizeof(theta));
+        theta += 360.0f;
+        std::memcpy(&bytes[nodesAt + (n * MuseDOF::Count + MuseDOF::Theta) * sizeof(float)], &theta, sizeof(theta));
+    }
+    {
+        std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), bytes.size());
+    }
+    MuseIKTable turned(ik);
+    REQUIRE(turned.load(fileName));
+    std::remove(fileName.c_str());
+
+    for (int i = -3; i <= 3; ++i) {
+        core::Vector3 focus = desired + core::Vector3(i, 0.5 * i, -i);
+        MuseIKResult res = turned.lookup(focus, core::Vector3());
+        CHECK(res.converged);
+        CHECK(res.iterations <= 1);
+        CHECK(res.settings[MuseDOF::Theta] >= 0);
+        CHECK(res.settings[MuseDOF::Theta] <= 360);
+        CHECK(k.calcScannerFocus(res.settings, core::Vector3(), jacobian).isClose(focus, turned.getTolerance()));
+    }
+}
+
+TEST_CASE("IKTable.file", "[IK]")
+{
+    // save/load roundtrip; a table built with other limits is rejected
+    MuseKinematics k;
+    MuseInverseKinematics ik(k);
+    MuseIKTable table(ik);
+    table.build(core::Vector3(-10, -40, -10), core::Vector3(10, -20, 10), 5, 1);
+    const std::string fileName = "MTIKTableTests.bin";
+    REQUIRE(table.save(fileName));
+
+    MuseIKTable loaded(ik);
+    CHECK(loaded.load(fileName));
+    CHECK(loaded.getNumNodes() == table.getNumNodes());
+    core::Vector3 desired(3, -31, 2);
+    MuseIKResult a = table.lookup(desired, core::Vector3());
+    MuseIKResult b = loaded.lookup(desired, core::Vector3());
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        CHECK(a.settings[i] == b.settings[i]);
+
+    // corrupted grids are rejected: the spacing, the size of an axis, a truncated file
+    std::string bytes;
+    {
+        std::ifstream file(fileName.c_str(), std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    unsigned sigSize = 0;
+    std::memcpy(&sigSize, &bytes[8], sizeof(sigSize));
+    const size_t spacingAt = 8 + sizeof(sigSize) + sigSize * sizeof(double) + 3 * sizeof(double);
+    const size_t dimsAt = spacingAt + sizeof(double);
+    auto corrupted = [&](size_t at, const void* value, size_t size, size_t length) {
+        std::string copy = bytes.substr(0, length);
+        std::memcpy(&copy[at], value, size);
+        std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+        file.write(copy.data(), copy.size());
+        file.close();
+        MuseIKTable table(ik);
+        return table.load(fileName) || table.isValid();
+    };
+    const double negative = -5, nan = std::nan("");
+    const int huge = 1 << 30, five = 5;
+    CHECK_FALSE(corrupted(spacingAt, &negative, sizeof(negative), bytes.size()));
+    CHECK_FALSE(corrupted(spacingAt, &nan, sizeof(nan), bytes.size()));
+    CHECK_FALSE(corrupted(dimsAt, &huge, sizeof(huge), bytes.size()));
+    CHECK_FALSE(corrupted(dimsAt, &five, sizeof(five), bytes.size() - 1));
+    CHECK(corrupted(dimsAt, &five, sizeof(five), bytes.size()));
+
+    ik.setLimits(MuseDOF::Psi, 0, 30);
+    MuseIKTable other(ik);
+    CHECK_FALSE(other.load(fileName));
+    CHECK_FALSE(other.isValid());
+    std::remove(fileName.c_str());
+}
@@ -0,0 +1,72 @@
+#include <catch2/catch.hpp>
+#include "MuseInverseKinematics.cpp"
+
+
+TEST_CASE("IK.jacobian", "[IK]")
+{
+    // analytic Jacobian against central finite differences
+    MuseKinematics k;
+    core::Vector3 calibration(1, -2, 3);
+    double q[MuseDOF::Count] = { 12, 47, -4, 23, 5, -7 };
+    core::Vector3 jacobian[MuseDOF::Count];
+    k.calcScannerFocus(q, calibration, jacobian);
+
+    const double h = 1e-5;
+    for (int i = 0; i < MuseDOF::Count; ++i) {
+        double qp[MuseDOF::Count], qm[MuseDOF::Count];
+        std::copy(q, q + MuseDOF::Count, qp);
+        std::copy(q, q + MuseDOF::Count, qm);
+        qp[i] += h;
+        qm[i] -= h;
+        core::Vector3 jp[MuseDOF::Count], jm[MuseDOF::Count];
+        core::Vector3 d = (k.calcScannerFocus(qp, calibration, jp) - k.calcScannerFocus(qm, calibration, jm)) / (2 * h);
+        CHECK(jacobian[i].isClose(d, 1e-6));
+    }
+}
+
+TEST_CASE("IK.solve", "[IK]")
+{
+    // reach the focus of known settings, starting from the default settings
+    MuseKinematics k;
+    MuseInverseKinematics ik(k);
+    core::Vector3 calibration(2, -1, 4);
+    double target[MuseDOF::Count] = { 25, 30, 5, 10, -8, 12 };
+    double initial[MuseDOF::Count] = { 0, 0, 0, 20, 0, 0 };
+    double settings[MuseDOF::Count];
+    std::copy(target, target + MuseDOF::Count, settings);
+    core::Vector3 jacobian[MuseDOF::Count];
+    core::Vector3 desired = k.calcScannerFocus(settings, calibration, jacobian);
+
+    MuseIKResult res = ik.solve(desired, initial, calibration);
+    CHECK(res.converged);
+    CHECK(res.error < 1e-6);
+    CHECK(res.iterations > 0);
+    CHECK(res.solveTimeUs >= 0);
+    CHECK(k.calcScannerFocus(res.settings, calibration, jacobian).isClose(desired, 1e-5));
+    for (int i = 0; i < MuseDOF::Count; ++i) {
+        CHECK(res.settings[i] >= ik.getMin(MuseDOF::Index(i)));
+        CHECK(res.settings[i] <= ik.getMax(MuseDOF::Index(i)));
+    }
+}
+
+TEST_CASE("IK.limits", "[IK]")
+{
+    // locked DOFs keep their initial value, the others stay within their limits
+    MuseKinematics k;
+    MuseInverseKinematics ik(k);
+    ik.setWeight(MuseDOF::Theta, 0);
+    ik.setWeight(MuseDOF::Alpha, 0);
+    double initial[MuseDOF::Count] = { 0, 90, 3, 20, 0, 0 };
+    core::Vector3 jacobian[MuseDOF::Count];
+    core::Vector3 start = k.calcScannerFocus(initial, core::Vector3(), jacobian);
+
+    // far out of reach of the trolleys along x: the solve stops at the limits
+    MuseIKResult res = ik.solve(start + core::Vector3(200, 0, 0), initial, core::Vector3());
+    CHECK_FALSE(res.converged);
+    CHECK(res.settings[MuseDOF::Theta] == 90);
+    CHECK(res.settings[MuseDOF::Alpha] == 3);
+    for (int i = 0; i < MuseDOF::Count; ++i) {
+        CHECK(res.settings[i] >= ik.getMin(MuseDOF::Index(i)));
+        CHECK(res.settings[i] <= ik.getMax(MuseDOF::Index(i)));
+    }
+}
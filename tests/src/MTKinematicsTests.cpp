@@ -0,0 +1,108 @@
+#include <catch2/catch.hpp>
+#include "MuseKinematics.cpp"
+#include <algorithm>
+#include <vector>
+
+
+TEST_CASE("Kinematics.defaults", "[kinematics]")
+{
+    // default settings: psi = theta = alpha = 0, LSlider = 20, trolleys = 0, no calibration
+    MuseKinematics k;
+    core::Vector3 f = k.calcTheoreticalFocus(0, 0, 0, 20, 0, 0, core::Vector3());
+    CHECK(f.x() == 0);
+    CHECK(f.y() == -55);
+    CHECK(f.z() == 0);
+
+    core::Vector3 s = k.calcScannerFocus(0, 0, 0, 20, 0, 0, core::Vector3());
+    CHECK(s.x() == Approx(0));
+    CHECK(s.y() == Approx(-55));
+    CHECK(s.z() == Approx(-0.2));
+}
+
+TEST_CASE("Kinematics.trolleys", "[kinematics]")
+{
+    // the trolleys and the calibration are pure translations
+    MuseKinematics k;
+    core::Vector3 calibration(1, 2, 3);
+    core::Vector3 s0 = k.calcScannerFocus(10, 30, 5, 25, 0, 0, core::Vector3());
+    core::Vector3 s1 = k.calcScannerFocus(10, 30, 5, 25, 7, -4, calibration);
+    CHECK(s1.x() - s0.x() == Approx(7 - 1));
+    CHECK(s1.y() - s0.y() == Approx(2));
+    CHECK(s1.z() - s0.z() == Approx(3 + 4));
+}
+
+TEST_CASE("Kinematics.rotations", "[kinematics]")
+{
+    // theta = 90 swaps x and z of the transducer-centred position
+    MuseKinematics k;
+    core::Vector3 s = k.calcScannerFocus(0, 90, 0, 20, 0, 0, core::Vector3());
+    CHECK(s.x() == Approx(-0.2));
+    CHECK(s.y() == Approx(-55));
+    CHECK(s.z() == Approx(0).margin(1e-12));
+
+    // psi tilts the beam in the y-z plane, around the transducer centre
+    s = k.calcScannerFocus(30, 0, 0, 20, 0, 0, core::Vector3());
+    CHECK(s.y() == Approx(-55 + 106.8 * sin(core::IGT_PI / 6)));
+    CHECK(s.z() == Approx(-127 + 20 + 106.8 * cos(core::IGT_PI / 6)));
+}
+
+TEST_CASE("Kinematics.batch", "[kinematics]")
+{
+    // the batch (SIMD) kinematics match the single-shot path, to the accuracy of their trig, and the scalar
+    // fallback matches it bit for bit
+    MuseKinematics k;
+    const size_t n = 1003;
+    std::vector<double> psi(n), theta(n), alpha(n), LSlider(n), XTrolley(n), ZTrolley(n);
+    for (size_t i = 0; i < n; ++i) {
+        psi[i] = (i % 41);
+        theta[i] = (i * 7) % 361;
+        alpha[i] = -10.0 + (i % 21);
+        LSlider[i] = 0.37 * (i % 109);
+        XTrolley[i] = -20.0 + 0.5 * (i % 81);
+        ZTrolley[i] = 20.0 - 0.25 * (i % 161);
+    }
+    MuseSettingsArrays settings = { psi.data(), theta.data(), alpha.data(), LSlider.data(), XTrolley.data(), ZTrolley.data() };
+    core::Vector3 calibration(1.5, -2, 3);
+    std::vector<double> x(n), y(n), z(n);
+    k.calcScannerFocus(n, settings, calibration, x.data(), y.data(), z.data());
+
+    std::vector<double> xScalar(n), yScalar(n), zScalar(n);
+    k.calcScannerFocusScalar(n, settings, calibration, xScalar.data(), yScalar.data(), zScalar.data());
+
+    size_t mismatches = 0, scalarMismatches = 0;
+    for (size_t i = 0; i < n; ++i) {
+        core::Vector3 f = k.calcScannerFocus(psi[i], theta[i], alpha[i], LSlider[i], XTrolley[i], ZTrolley[i], calibration);
+        if (!((f - core::Vector3(x[i], y[i], z[i])).length() < 1e-9))
+            ++mismatches;
+        if (f.x() != xScalar[i] || f.y() != yScalar[i] || f.z() != zScalar[i])
+            ++scalarMismatches;
+    }
+    CHECK(mismatches == 0);
+    CHECK(scalarMismatches == 0);
+}
+
+TEST_CASE("Kinematics.batchAngles", "[kinematics]")
+{
+    // every quadrant, the boundaries between them, and angles beyond a turn
+    MuseKinematics k;
+    std::vector<double> angles;
+    for (int a = -720; a <= 720; a += 15)
+        angles.push_back(a);
+    for (double a : { 44.999999, 45.0, 45.000001, 134.5, 315.25, 359.999999, -0.0, 1e-9, 1e6 + 0.5 })
+        angles.push_back(a);
+    const size_t n = angles.size();
+    std::vector<double> zeros(n, 0.0), LSlider(n, 20.0), x(n), y(n), z(n);
+    for (int dof : { MuseDOF::Psi, MuseDOF::Theta, MuseDOF::Alpha }) {
+        MuseSettingsArrays settings = { zeros.data(), zeros.data(), zeros.data(), LSlider.data(), zeros.data(), zeros.data() };
+        (dof == MuseDOF::Psi ? settings.psi : dof == MuseDOF::Theta ? settings.theta : settings.alpha) = angles.data();
+        k.calcScannerFocus(n, settings, core::Vector3(), x.data(), y.data(), z.data());
+        double maxError = 0;
+        for (size_t i = 0; i < n; ++i) {
+            double q[MuseDOF::Count] = { 0, 0, 0, 20, 0, 0 };
+            q[dof] = angles[i];
+            core::Vector3 f = k.calcScannerFocus(q[MuseDOF::Psi], q[MuseDOF::Theta], q[MuseDOF::Alpha], 20, 0, 0, core::Vector3());
+            maxError = std::max(maxError, (f - core::Vector3(x[i], y[i], z[i])).length());
+        }
+        CHECK(maxError < 1e-9);
+    }
+}
@@ -0,0 +1,73 @@
+#include <catch2/catch.hpp>
+#include "../libs/libCore/Core/Maths/MatN.h"
+
+
+TEST_CASE("MatN.arithmetic", "[matn]")
+{
+    core::MatN<2, 3> a = { 1, 2, 3,
+                           4, 5, 6 };
+    core::MatN<3, 2> b = { 7, 8,
+                           9, 10,
+                           11, 12 };
+    CHECK(core::MatN<2, 3>::Rows == 2);
+    CHECK(core::MatN<2, 3>::Cols == 3);
+    CHECK(core::MatN<2, 2>() == (core::MatN<2, 2> { 0, 0, 0, 0 }));
+
+    core::MatN<2, 2> ab = a * b;
+    CHECK(ab == (core::MatN<2, 2> { 58, 64, 139, 154 }));
+    CHECK(core::transpose(a) == (core::MatN<3, 2> { 1, 4, 2, 5, 3, 6 }));
+    CHECK(core::trace(ab) == 212);
+    CHECK(a + a == a * 2.0);
+    CHECK(a - a == core::MatN<2, 3>());
+    CHECK(-a == a / -1.0);
+    CHECK(core::dot(core::VecN<3> { 1, 2, 3 }, core::VecN<3> { 4, 5, 6 }) == 32);
+    CHECK(core::MatN<3, 3>::identity() * core::transpose(a) == core::transpose(a));
+}
+
+TEST_CASE("MatN.solve", "[matn]")
+{
+    // needs pivoting: 0 on the diagonal
+    core::MatN<4, 4> m = { 0, 2, 1, 4,
+                           1, 1, 0, 2,
+                           3, 0, 2, 1,
+                           2, 5, 1, 0 };
+    core::VecN<4> x = { 1, -2, 3, 0.5 };
+    core::VecN<4> b = m * x;
+    CHECK(core::solve(m, b).isClose(x, 1e-12));
+    CHECK((core::invert(m) * m).isClose(core::MatN<4, 4>::identity(), 1e-12));
+    CHECK(core::determinant(m) == Approx(69));
+
+    core::MatN<3, 3> m3 = { 2, 0, 1, 1, 3, 0, 0, 1, 4 };
+    CHECK(core::determinant(m3) == Approx(25));
+    CHECK((core::invert(m3) * m3).isClose(core::MatN<3, 3>::identity(), 1e-12));
+
+    core::MatN<3, 3> singular = { 1, 2, 3, 2, 4, 6, 0, 1, 1 };
+    CHECK_THROWS_AS(core::invert(singular), core::IGTDivideByZeroErr);
+    CHECK_THROWS_AS(core::solve(singular, core::VecN<3>()), core::IGTDivideByZeroErr);
+}
+
+TEST_CASE("MatN.interop", "[matn]")
+{
+    core::Matrix3 r(0, -1, 0,
+                    1, 0, 0,
+                    0, 0, 1);
+    core::Vector3 v(1, 2, 3);
+
+    // implicit both ways, same products
+    core::MatN<3, 3> m = r;
+    core::VecN<3> w = v;
+    CHECK(m(0, 1) == -1);
+    CHECK(w[2] == 3);
+    core::Vector3 mv = m * w;
+    CHECK(mv == r * v);
+    CHECK(m * v == r * v);
+    core::Matrix3 back = m * m;
+    CHECK(back == r * r);
+
+    core::Matrix4 t = core::MatN<4, 4>::identity();
+    t[0][3] = 10;
+    core::MatN<4, 4> m4 = t;
+    core::Vector4 p = m4 * core::VecN<4>(core::Vector4(v, 1));
+    CHECK(p[0] == 11);
+    CHECK(p[3] == 1);
+}
@@ -0,0 +1,228 @@
+#include <catch2/catch.hpp>
+#include "../libs/libCore/Core/Maths/Matrix.h"
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+core::Matrix randomMatrix(int n, std::mt19937& generator) {
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    core::Matrix m(n);
+    for (int k = 0; k < n * n; ++k)
+        m[k] = value(generator);
+    return m;
+}
+
+/** The product as it was written before the blocked kernel: the reference */
+core::Matrix naiveProduct(const core::Matrix& lhs, const core::Matrix& rhs) {
+    core::Matrix res(rhs.columns(), lhs.rows());
+    for (int j = 0; j < res.rows(); ++j) {
+        for (int i = 0; i < res.columns(); ++i) {
+            double c = 0;
+            for (int k = 0; k < lhs.columns(); ++k)
+                c += lhs[k * lhs.rows() + i] * rhs[j * rhs.columns() + k];
+            res[j * res.columns() + i] = c;
+        }
+    }
+    return res;
+}
+
+double maxDifference(const core::Matrix& m1, const core::Matrix& m2) {
+    double difference = 0;
+    for (int k = 0; k < m1.columns() * m1.rows(); ++k)
+        difference = std::max(difference, std::abs(m1[k] - m2[k]));
+    return difference;
+}
+
+} // namespace
+
+
+TEST_CASE("Matrix.product", "[matrix]")
+{
+    // the blocked kernel, edges included, against the plain triple loop
+    std::mt19937 generator(1);
+    for (int n : { 1, 3, 4, 9, 31, 33, 100, 261 }) {
+        core::Matrix a = randomMatrix(n, generator), b = randomMatrix(n, generator);
+        CHECK(maxDifference(a * b, naiveProduct(a, b)) < 1e-12 * n);
+        core::Matrix c(a);
+        c *= b;
+        CHECK(maxDifference(c, naiveProduct(a, b)) < 1e-12 * n);
+    }
+    CHECK_THROWS_AS(core::Matrix(2, 3) * core::Matrix(2, 3), std::domain_error);
+}
+
+TEST_CASE("Matrix.lu", "[matrix]")
+{
+    std::mt19937 generator(2);
+    for (int n : { 1, 3, 7, 64, 65, 150 }) {
+        core::Matrix a = randomMatrix(n, generator);
+        core::LUDecomposition lu(a);
+        CHECK_FALSE(lu.isSingular());
+
+        // several right-hand sides at once, with the same factors
+        core::Matrix x(4, n);
+        for (int k = 0; k < 4 * n; ++k)
+            x[k] = k % 7 - 3.0;
+        core::Matrix b(4, n);
+        for (int r = 0; r < n; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                double sum = 0;
+                for (int k = 0; k < n; ++k)
+                    sum += a(k, r) * x(c, k);
+                b(c, r) = sum;
+            }
+        }
+        CHECK(maxDifference(lu.solve(b), x) < 1e-9);
+
+        // the inverse, row by row like the matrix
+        core::Matrix inverse = a.inverse();
+        core::Matrix identity(n);
+        double difference = 0;
+        for (int r = 0; r < n; ++r) {
+            for (int c = 0; c < n; ++c) {
+                double sum = 0;
+                for (int k = 0; k < n; ++k)
+                    sum += a(k, r) * inverse(c, k);
+                difference = std::max(difference, std::abs(sum - identity(c, r)));
+            }
+        }
+        CHECK(difference < 1e-9);
+    }
+
+    // needs pivoting: 0 on the diagonal
+    core::Matrix a(3);
+    const double values[9] = { 0, 2, 1, 1, 1, 0, 3, 0, 2 };
+    for (int k = 0; k < 9; ++k)
+        a[k] = values[k];
+    core::LUDecomposition lu(a);
+    CHECK(lu.determinant() == Approx(-7));
+    core::Matrix b(1, 3);
+    b[0] = 3; b[1] = 2; b[2] = 5;
+    core::Matrix x = core::solve(a, b);
+    CHECK(x.columns() == 3);
+    CHECK(x[0] == Approx(1));
+    CHECK(x[1] == Approx(1));
+    CHECK(x[2] == Approx(1));
+
+    core::Matrix singular(3);
+    singular[4] = 0;
+    CHECK(core::LUDecomposition(singular).isSingular());
+    CHECK(core::LUDecomposition(singular).determinant() == 0);
+    CHECK_THROWS_AS(singular.inverse(), std::domain_error);
+    CHECK_THROWS_AS(core::solve(singular, b), std::domain_error);
+    CHECK_THROWS_AS(core::LUDecomposition(core::Matrix(2, 3)), std::domain_error);
+}
+
+TEST_CASE("Matrix.move", "[matrix]")
+{
+    std::mt19937 generator(3);
+    core::Matrix a = randomMatrix(5, generator);
+
+    // moves take the components, and leave the other matrix empty
+    core::Matrix copy(a);
+    const double* data = copy.data();
+    core::Matrix moved(std::move(copy));
+    CHECK(moved.data() == data);
+    CHECK(copy.columns() * copy.rows() == 0);
+    copy = std::move(moved);
+    CHECK(copy.data() == data);
+    CHECK(maxDifference(copy, a) == 0);
+
+    // copies reuse the components of a matrix of the same size
+    core::Matrix b = randomMatrix(5, generator);
+    data = b.data();
+    b = a;
+    CHECK(b.data() == data);
+
+    // in place transpose and inverse of temporaries
+    core::Matrix t = core::Matrix(a).transpose();
+    CHECK(maxDifference(core::Matrix(t).transpose(), a) == 0);
+    CHECK(maxDifference(t, a.transpose()) == 0);
+    core::Matrix column(1, 4);
+    column[2] = 5;
+    core::Matrix row = std::move(column).transpose();
+    CHECK(row.columns() == 4);
+    CHECK(row.rows() == 1);
+    CHECK(row[2] == 5);
+    core::Matrix rectangle(2, 3);
+    rectangle(1, 2) = 7;
+    core::Matrix r = core::Matrix(rectangle).transpose();
+    CHECK(r.columns() == 3);
+    CHECK(r(2, 1) == 7);
+    CHECK(maxDifference(core::Matrix(a).inverse(), a.inverse()) < 1e-12);
+
+    // products into caller-owned storage
+    core::Matrix out(5);
+    data = out.data();
+    multiplyInto(out, a, b);
+    CHECK(out.data() == data);
+    CHECK(maxDifference(out, naiveProduct(a, b)) < 1e-12);
+    multiplyInto(out, out, b);
+    CHECK(maxDifference(out, naiveProduct(naiveProduct(a, b), b)) < 1e-12);
+}
+
+TEST_CASE("Matrix.tridiagonal", "[matrix]")
+{
+    // many systems at once, against one at a time
+    std::mt19937 generator(4);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    const int n = 50, nb = 3000;
+    for (bool isPeriodic : { false, true }) {
+        std::deque<double> coefficients(3 * n);
+        for (int i = 0; i < n; ++i) {
+            coefficients[3 * i] = value(generator);
+            coefficients[3 * i + 1] = 4 + value(generator);
+            coefficients[3 * i + 2] = value(generator);
+        }
+        if (!isPeriodic) {
+            coefficients[0] = 0;
+            coefficients[3 * n - 1] = 0;
+        }
+        core::TridiagonalMatrix m(coefficients);
+
+        std::vector<double> l(n * nb);
+        for (double& v : l)
+            v = value(generator);
+        std::vector<double> x(l), xThreads(l);
+        std::vector<float> xFloat(l.begin(), l.end());
+        if (isPeriodic) {
+            m.multi_syst_solve_period(x.data(), nb, 1);
+            m.multi_syst_solve_period(xThreads.data(), nb, 4);
+            m.multi_syst_solve_period(xFloat.data(), nb);
+        }
+        else {
+            m.multi_syst_solve(x.data(), nb, 1);
+            m.multi_syst_solve(xThreads.data(), nb, 4);
+            m.multi_syst_solve(xFloat.data(), nb);
+        }
+        CHECK(x == xThreads);
+
+        double difference = 0, differenceFloat = 0;
+        for (int j = 0; j < nb; j += 97) {
+            std::deque<double> system(n);
+            for (int i = 0; i < n; ++i)
+                system[i] = l[nb * i + j];
+            std::deque<double> solution = isPeriodic ? m.syst_solve_period(system) : m.syst_solve(system);
+            for (int i = 0; i < n; ++i) {
+                difference = std::max(difference, std::abs(solution[i] - x[nb * i + j]));
+                differenceFloat = std::max(differenceFloat, std::abs(solution[i] - xFloat[nb * i + j]));
+            }
+        }
+        CHECK(difference < 1e-12);
+        CHECK(differenceFloat < 1e-5);
+
+        // the deque version gives the same as the buffer one
+        std::deque<float> lFloat(l.begin(), l.begin() + 4 * n);
+        std::vector<float> xSmall(lFloat.begin(), lFloat.end());
+        std::deque<float> xDeque = isPeriodic ? m.multi_syst_solve_period(lFloat, 4) : m.multi_syst_solve(lFloat, 4);
+        isPeriodic ? m.multi_syst_solve_period(xSmall.data(), 4) : m.multi_syst_solve(xSmall.data(), 4);
+        CHECK(std::equal(xDeque.begin(), xDeque.end(), xSmall.begin()));
+    }
+    core::TridiagonalMatrix small(2);
+    float l[2] = { 1, 2 };
+    CHECK_THROWS_AS(small.multi_syst_solve_period(l, 1), std::domain_error);
+}
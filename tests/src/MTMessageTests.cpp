@@ -0,0 +1,83 @@
+#include <catch2/catch.hpp>
+#include "MuseMessage.cpp"
+#include <limits>
+
+
+TEST_CASE("Message.encode", "[message]")
+{
+    // header, then the values, little-endian
+    MuseMessage m = MuseMessage::makeFocus(MuseMessage::ObservedFocus, core::Vector3(1.5, -2, 30));
+    m.sequence = 0x01020304;
+    m.timestamp = 5;
+    std::vector<uint8_t> buffer;
+    m.encode(buffer);
+    REQUIRE(buffer.size() == 40);
+    CHECK(m.getSize() == 40);
+    CHECK(buffer[0] == 'M');
+    CHECK(buffer[1] == 'T');
+    CHECK(buffer[2] == MuseMessage::Version);
+    CHECK(buffer[3] == MuseMessage::ObservedFocus);
+    CHECK(buffer[4] == 0x04);
+    CHECK(buffer[7] == 0x01);
+    CHECK(buffer[8] == 5);
+    CHECK(buffer[23] == 0x3f);  // 1.5 == 0x3ff8000000000000
+
+    CHECK(MuseMessage::makeSettings(MuseMessage::CurrentSettings, SettingsSnapshot()).getSize() == 64);
+    MuseMessage reset;
+    reset.type = MuseMessage::Reset;
+    CHECK(reset.getSize() == MuseMessage::HeaderSize);
+    CHECK(MuseMessage::getNumValues(42) == -1);
+}
+
+TEST_CASE("Message.reader", "[message]")
+{
+    SettingsSnapshot s = { { 10, 20, 3, 4, -5, 6 } };
+    MuseMessage settings = MuseMessage::makeSettings(MuseMessage::CurrentSettings, s);
+    settings.sequence = 1;
+    MuseMessage desired = MuseMessage::makeFocus(MuseMessage::DesiredFocus, core::Vector3(-1, 2, 3));
+    desired.sequence = 2;
+    desired.timestamp = MuseMessage::now();
+    std::vector<uint8_t> buffer;
+    settings.encode(buffer);
+    desired.encode(buffer);
+
+    // messages split across reads
+    MuseMessageReader reader;
+    MuseMessage m;
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        reader.append(reinterpret_cast<const char*>(&buffer[i]), 1);
+        if (i + 1 == settings.getSize()) {
+            REQUIRE(reader.next(m));
+            CHECK(m.type == MuseMessage::CurrentSettings);
+            CHECK(m.sequence == 1);
+            for (int j = 0; j < MuseDOF::Count; ++j)
+                CHECK(m.getSettings().values[j] == s.values[j]);
+        }
+    }
+    REQUIRE(reader.next(m));
+    CHECK(m.type == MuseMessage::DesiredFocus);
+    CHECK(m.sequence == 2);
+    CHECK(m.timestamp == desired.timestamp);
+    CHECK(m.getFocus() == core::Vector3(-1, 2, 3));
+    CHECK_FALSE(reader.next(m));
+    CHECK_FALSE(reader.hasError());
+
+    // not a message: the reader stops
+    const char garbage[MuseMessage::HeaderSize] = "not a message";
+    reader.append(garbage, sizeof(garbage));
+    CHECK_FALSE(reader.next(m));
+    CHECK(reader.hasError());
+    reader.clear();
+    reader.append(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    CHECK(reader.next(m));
+
+    // well formed, but not a focus: the reader stops as well
+    for (double value : { std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity() }) {
+        std::vector<uint8_t> invalid;
+        MuseMessage::makeFocus(MuseMessage::ObservedFocus, core::Vector3(1, value, 3)).encode(invalid);
+        reader.clear();
+        reader.append(reinterpret_cast<const char*>(invalid.data()), invalid.size());
+        CHECK_FALSE(reader.next(m));
+        CHECK(reader.hasError());
+    }
+}
@@ -0,0 +1,360 @@
+#include <catch2/catch.hpp>
+#include "../libs/libCore/Core/Maths/Polygon.h"
+#include "../libs/libCore/Core/Maths/PolygonQuery.h"
+#include "../libs/libCore/Core/Maths/PolygonRaster.h"
+#include "../libs/libCore/Core/Maths/Segment.h"
+#include "../libs/libCore/Core/Maths/Triangle.h"
+#include <cmath>
+#include <list>
+#include <memory>
+#include <random>
+
+
+namespace {
+
+/** An L in the plane x + y + z = 10 (concave, projected on (x, y)) */
+core::Polygon lShape() {
+    core::Polygon::Vertices points;
+    const double xy[6][2] = { { 0, 0 }, { 4, 0 }, { 4, 1 }, { 1, 1 }, { 1, 3 }, { 0, 3 } };
+    for (const auto& p : xy)
+        points.push_back(core::Point3(p[0], p[1], 10 - p[0] - p[1]));
+    return core::Polygon(points);
+}
+
+/** A star of n branches, in a tilted plane */
+core::Polygon star(int n) {
+    core::Polygon::Vertices points;
+    for (int i = 0; i < 2 * n; ++i) {
+        double angle = core::IGT_PI * i / n, radius = (i % 2) ? 40 : 100;
+        double u = radius * std::cos(angle), v = radius * std::sin(angle);
+        points.push_back(core::Point3(u, 0.6 * v, 0.8 * v + 5));
+    }
+    return core::Polygon(points);
+}
+
+} // namespace
+
+
+TEST_CASE("Polygon.isIn", "[polygon]")
+{
+    core::Polygon l = lShape();
+    CHECK(l.isIn(core::Point3(0.5, 2, 7.5)));
+    CHECK(l.isIn(core::Point3(3, 0.5, 6.5)));
+    CHECK_FALSE(l.isIn(core::Point3(3, 2, 5)));          // in the notch
+    CHECK_FALSE(l.isIn(core::Point3(0.5, 2, 7)));        // off the plane
+    CHECK(l.isIn(core::Point3(4, 1, 5)));                // vertex
+    CHECK(l.isIn(core::Point3(2, 0, 8)));                // edge
+    CHECK(l.getArea() == Approx(6));
+    CHECK(l.getPerimeter() > 0);
+
+    // the cached projection follows the changes of the vertices
+    l.setVertex(2, core::Point3(4, 3, 3));
+    l.setVertex(3, core::Point3(1, 3, 6));
+    CHECK(l.isIn(core::Point3(3, 2, 5)));
+    l.deleteVertex(core::Point3(1, 3, 6));
+    l.replaceVertex(core::Point3(4, 3, 3), core::Point3(4, 2, 4));
+    CHECK(l.size() == 5);
+    CHECK_FALSE(l.isIn(core::Point3(3, 2.9, 4.1)));
+    l.addVertex(core::Point3(4, 3, 3), 3);
+    CHECK(l.isIn(core::Point3(3, 2.9, 4.1)));
+    l.reversePoints();
+    CHECK(l.isIn(core::Point3(3, 2.9, 4.1)));
+    l.deleteAllVertices();
+    CHECK_FALSE(l.isIn(core::Point3(3, 2.9, 4.1)));
+
+    // aligned vertices
+    core::Polygon line(std::list<core::Point3> { core::Point3(0, 0, 0), core::Point3(1, 0, 0), core::Point3(2, 0, 0) });
+    CHECK(line.isIn(core::Point3(0.5, 0, 0)));
+    CHECK_FALSE(line.isIn(core::Point3(0.5, 1, 0)));
+}
+
+TEST_CASE("Polygon.fractional", "[polygon]")
+{
+    // the area and the projection axis are computed on doubles: truncated to integers, the area below
+    // was 1 and a vertical polygon was projected on (x, y), where it is a segment
+    core::Polygon triangle(std::list<core::Point3> { core::Point3(0, 0, 0), core::Point3(1.5, 0, 0),
+        core::Point3(0, 1.5, 0) });
+    CHECK(triangle.getArea() == Approx(1.125));
+    core::Polygon square(std::list<core::Point3> { core::Point3(0.2, 0.3, 0), core::Point3(0.8, 0.9, 0),
+        core::Point3(0.8, 0.9, 0.7), core::Point3(0.2, 0.3, 0.7) });
+    CHECK(square.isIn(core::Point3(0.5, 0.6, 0.35)));
+    CHECK_FALSE(square.isIn(core::Point3(0.5, 0.6, 0.9)));
+    CHECK_FALSE(square.isIn(core::Point3(0.9, 1.0, 0.35)));
+}
+
+TEST_CASE("Polygon.vertices", "[polygon]")
+{
+    core::Polygon l = lShape();
+    const core::Polygon& constL = l;
+    CHECK(constL[4] == core::Point3(1, 3, 6));
+    CHECK_THROWS_AS(constL[6], core::IGTIndexOutOfBounds);
+    CHECK_THROWS_AS(l[-1], core::IGTIndexOutOfBounds);
+    CHECK(l.getIndex(core::Point3(0, 3, 7)) == 5);
+
+    // the same polygon, from another vertex and in the other direction
+    core::Polygon other(l);
+    other.reversePoints();
+    other.addVertex(other[5], 0);
+    other.deleteVertex(6);
+    CHECK(other == l);
+    other.addVertex(core::Point3(2, 0, 8), 6);  // on an edge: same polygon
+    CHECK(other == l);
+    CHECK(other.isClose(l));
+    other.setVertex(0, core::Point3(0, 0, 9));
+    CHECK(other != l);
+    CHECK_THROWS_AS(other.setVertex(7, core::Point3()), core::IGTIndexOutOfBounds);
+
+    core::Triangle t(core::Point3(0, 0, 0), core::Point3(2, 0, 0), core::Point3(0, 2, 0));
+    CHECK(t.getArea() == Approx(2));
+    CHECK(t.isIn(core::Point3(0.5, 0.5, 0)));
+    CHECK(l.triangulate(l.getVertices()).size() == 4);
+}
+
+TEST_CASE("Polygon.triangulate", "[polygon]")
+{
+    std::vector<core::Polygon> polygons;
+    polygons.push_back(lShape());
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<double> radius(20, 100);
+    for (int n : { 3, 4, 7, 50, 400 }) {
+        core::Polygon::Vertices points;  // star-shaped, with random radii, in a tilted plane
+        for (int i = 0; i < n; ++i) {
+            double angle = 2 * core::IGT_PI * i / n, r = radius(generator);
+            double u = r * std::cos(angle), v = r * std::sin(angle);
+            points.push_back(core::Point3(u, 0.6 * v, 0.8 * v + 5));
+        }
+        polygons.push_back(core::Polygon(points));
+    }
+    core::Polygon::Vertices comb;  // teeth up and down: split and merge vertices, horizontal and aligned edges
+    for (int i = 0; i < 10; ++i) {
+        comb.push_back(core::Point3(2 * i, 0, 0));
+        comb.push_back(core::Point3(2 * i + 1, -3, 0));
+    }
+    comb.push_back(core::Point3(20, 0, 0));
+    comb.push_back(core::Point3(20, 5, 0));
+    for (int i = 10; i > 0; --i) {
+        comb.push_back(core::Point3(2 * i - 1, 8 + i % 3, 0));
+        comb.push_back(core::Point3(2 * i - 2, 5, 0));
+    }
+    polygons.push_back(core::Polygon(comb));
+    polygons.push_back(core::Polygon(comb));
+    polygons.back().reversePoints();
+
+    for (const core::Polygon& polygon : polygons) {
+        // n - 2 triangles, in the polygon, turning as it, which cover it
+        core::Vector3 normal;  // twice the area, along the normal which sees the polygon counterclockwise
+        for (size_t i = 0; i < polygon.size(); ++i)
+            normal += core::Vector3(polygon[int(i)]) ^ core::Vector3(polygon[int((i + 1) % polygon.size())]);
+        std::vector<int> indices = polygon.getTriangleIndices();
+        REQUIRE(indices.size() == 3 * (polygon.size() - 2));
+        double area = 0;
+        int outside = 0, reversed = 0;
+        for (size_t k = 0; k < indices.size(); k += 3) {
+            const core::Point3& a = polygon[indices[k]];
+            const core::Point3& b = polygon[indices[k + 1]];
+            const core::Point3& c = polygon[indices[k + 2]];
+            core::Vector3 side = (b - a) ^ (c - a);
+            area += 0.5 * side.length();
+            reversed += side * normal < 0;
+            outside += ! polygon.isIn(core::Point3((a[0] + b[0] + c[0]) / 3, (a[1] + b[1] + c[1]) / 3, (a[2] + b[2] + c[2]) / 3));
+        }
+        CHECK(area == Approx(0.5 * normal.length()));
+        CHECK(outside == 0);
+        CHECK(reversed == 0);
+        CHECK(polygon.triangulate(polygon.getVertices()).size() == polygon.size() - 2);
+    }
+    CHECK(core::Polygon(2).getTriangleIndices().empty());
+}
+
+TEST_CASE("Polygon.query", "[polygon]")
+{
+    // the prepared query answers as Polygon::isIn, edges and vertices included
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> value(-110, 110);
+    for (int n : { 3, 5, 64 }) {
+        core::Polygon polygon = star(n);
+        core::PolygonQuery query(polygon);
+
+        std::vector<core::Point3> points;
+        for (int k = 0; k < 5000; ++k) {
+            double u = value(generator), v = value(generator);
+            points.push_back(core::Point3(u, 0.6 * v, 0.8 * v + 5));
+        }
+        for (size_t i = 0; i < polygon.size(); ++i) {
+            const core::Point3& current = polygon[int(i)];
+            const core::Point3& next = polygon[int((i + 1) % polygon.size())];
+            points.push_back(current);
+            points.push_back(0.5 * (current + next));
+            points.push_back(current + core::Vector3(0, 0, 1));
+        }
+
+        std::unique_ptr<bool[]> inside(new bool[points.size()]);
+        query.isIn(points.data(), int(points.size()), inside.get(), 3);
+        int count = 0, mismatches = 0;
+        for (size_t k = 0; k < points.size(); ++k) {
+            bool expected = polygon.isIn(points[k]);
+            if (query.isIn(points[k]) != expected || inside[k] != expected)
+                ++mismatches;
+            count += expected;
+        }
+        CHECK(mismatches == 0);
+        CHECK(count > 0);
+        CHECK(count < int(points.size()));
+    }
+
+    // degenerate polygons
+    core::Polygon line(std::list<core::Point3> { core::Point3(0, 0, 0), core::Point3(1, 0, 0), core::Point3(2, 0, 0) });
+    CHECK(core::PolygonQuery(line).isIn(core::Point3(0.5, 0, 0)));
+    CHECK_FALSE(core::PolygonQuery(line).isIn(core::Point3(0.5, 1, 0)));
+    CHECK_FALSE(core::PolygonQuery(core::Polygon(2)).isIn(core::Point3()));
+    CHECK_FALSE(core::PolygonQuery(core::Polygon()).isIn(core::Point3()));
+}
+
+TEST_CASE("Polygon.segment", "[polygon]")
+{
+    // in the L, along its edges, across its notch
+    core::Polygon l = lShape();
+    CHECK(l.isIn(core::Segment(core::Point3(0.5, 2.5, 7), core::Point3(3.5, 0.5, 6))) == false);
+    CHECK(l.isIn(core::Segment(core::Point3(0.5, 2.5, 7), core::Point3(0.5, 0.5, 9))));
+    CHECK(l.isIn(core::Segment(core::Point3(0, 3, 7), core::Point3(4, 0, 6))) == false);
+    CHECK(l.isIn(core::Segment(core::Point3(0, 2, 8), core::Point3(2, 0, 8))));  // through the inner corner (1, 1)
+    CHECK(l.isIn(core::Segment(core::Point3(4, 1, 5), core::Point3(1, 1, 8))));  // on an edge
+    CHECK(l.isIn(core::Segment(core::Point3(0.5, 2.5, 7), core::Point3(0.5, 2.5, 8))) == false);  // off the plane
+
+    // a slit of 0.001 between two sampled points
+    core::Polygon slit(std::list<core::Point3> { core::Point3(0, 0, 0), core::Point3(10, 0, 0), core::Point3(10, 10, 0),
+                                                 core::Point3(5.0105, 10, 0), core::Point3(5.0105, 2, 0), core::Point3(5.0095, 2, 0),
+                                                 core::Point3(5.0095, 10, 0), core::Point3(0, 10, 0) });
+    core::Segment across(core::Point3(0, 5, 0), core::Point3(10, 5, 0));
+    CHECK_FALSE(slit.isIn(across));
+    CHECK_FALSE(core::PolygonQuery(slit).isIn(across));
+    CHECK(slit.isIn(core::Segment(core::Point3(0, 1, 0), core::Point3(10, 1, 0))));
+
+    // on a lattice, through vertices which touch or cross the segment, and along edges
+    core::Polygon::Vertices onLattice;
+    const int xy[10][2] = { { 0, 0 }, { 6, 0 }, { 6, 2 }, { 4, 4 }, { 6, 6 }, { 4, 6 }, { 2, 4 }, { 0, 6 }, { -2, 4 }, { 0, 2 } };
+    for (const auto& p : xy)
+        onLattice.push_back(core::Point3(p[0], p[1], 0));
+    core::Polygon lattice(onLattice);
+    int latticeMismatches = 0;
+    for (int x0 = -3; x0 <= 7; ++x0) {
+        for (int y0 = -1; y0 <= 7; ++y0) {
+            for (int d = 0; d < 8; ++d) {
+                const int dx[8] = { 1, 1, 0, -1, 2, 1, 3, 2 }, dy[8] = { 0, 1, 1, 1, 1, 2, 1, -1 };
+                core::Segment s(core::Point3(x0, y0, 0), core::Point3(x0 + 3 * dx[d], y0 + 3 * dy[d], 0));
+                bool sampled = true;
+                for (int i = 0; i <= 600 && sampled; ++i)
+                    sampled = lattice.isIn(s.from() + (i / 600.0) * (s.to() - s.from()));
+                latticeMismatches += (lattice.isIn(s) != sampled);
+            }
+        }
+    }
+    CHECK(latticeMismatches == 0);
+
+    // against many points along random segments
+    std::mt19937 generator(4);
+    std::uniform_real_distribution<double> value(-110, 110);
+    for (int n : { 3, 5, 32 }) {
+        core::Polygon polygon = star(n);
+        core::PolygonQuery query(polygon);
+        int count = 0, mismatches = 0;
+        for (int k = 0; k < 300; ++k) {
+            double u0 = value(generator), v0 = value(generator), u1 = value(generator) / 4, v1 = value(generator) / 4;
+            core::Segment s(core::Point3(u0, 0.6 * v0, 0.8 * v0 + 5), core::Point3(u1, 0.6 * v1, 0.8 * v1 + 5));
+            bool sampled = true;
+            for (int i = 0; i <= 2000 && sampled; ++i)
+                sampled = polygon.isIn(s.from() + (i / 2000.0) * (s.to() - s.from()));
+            mismatches += (polygon.isIn(s) != sampled) + (query.isIn(s) != sampled);
+            count += sampled;
+        }
+        CHECK(mismatches == 0);
+        CHECK(count > 0);
+    }
+}
+
+TEST_CASE("Polygon.rasterize", "[polygon]")
+{
+    // the mask is the pixels which Polygon::isIn finds in the polygon, edges and vertices included
+    std::mt19937 generator(2);
+    std::uniform_real_distribution<double> radius(5, 30);
+    std::vector<core::Polygon> polygons;
+    for (int k = 0; k < 20; ++k) {
+        core::Polygon::Vertices points;
+        int n = 3 + k * 3;
+        for (int i = 0; i < n; ++i) {
+            double angle = 2 * core::IGT_PI * i / n, r = radius(generator);
+            points.push_back(core::Point3(30 + r * std::cos(angle), 20 + r * std::sin(angle), 0));
+        }
+        polygons.push_back(core::Polygon(points));
+    }
+    core::Polygon::Vertices onPixels;  // an L, with a peak, on the pixels: all the boundary cases
+    const int xy[8][2] = { { 2, 2 }, { 12, 2 }, { 12, 6 }, { 9, 9 }, { 6, 6 }, { 6, 12 }, { 2, 12 }, { 4, 7 } };
+    for (const auto& p : xy)
+        onPixels.push_back(core::Point3(p[0], p[1], 0));
+    polygons.push_back(core::Polygon(onPixels));
+    polygons.push_back(core::Polygon(std::list<core::Point3> { core::Point3(-5, -5, 0), core::Point3(70, 1, 0), core::Point3(3, 60, 0) }));
+
+    for (const core::Polygon& polygon : polygons) {
+        core::Mask mask(64, 48);
+        core::rasterize(polygon, mask);
+        int mismatches = 0;
+        for (unsigned y = 0; y < mask.height(); ++y) {
+            for (unsigned x = 0; x < mask.width(); ++x)
+                mismatches += mask(x, y) != polygon.isIn(core::Point3(x, y, 0));
+        }
+        CHECK(mismatches == 0);
+    }
+
+    core::Mask mask(10, 10, true);
+    core::rasterize(core::Polygon(2), mask);
+    CHECK(mask.empty());
+}
+
+TEST_CASE("Polygon.coverage", "[polygon]")
+{
+    auto square = [](double x0, double y0, double x1, double y1) {
+        return core::Polygon(std::list<core::Point3> { core::Point3(x0, y0, 0), core::Point3(x1, y0, 0),
+                                                       core::Point3(x1, y1, 0), core::Point3(x0, y1, 0) });
+    };
+    auto sum = [](const core::Image<float>& image) {
+        double s = 0;
+        for (unsigned k = 0; k < image.width() * image.height(); ++k)
+            s += image[k];
+        return s;
+    };
+
+    // pixel (x, y) is the square of side 1 centered on (x, y)
+    core::Image<float> coverage(16, 12);
+    core::rasterizeCoverage(square(1.5, 1.5, 5.5, 5.5), coverage);
+    CHECK(sum(coverage) == Approx(16));
+    CHECK(coverage(2, 2) == Approx(1));
+    CHECK(coverage(1, 2) == Approx(0).margin(1e-6));
+    core::rasterizeCoverage(square(1.25, 1.5, 5.5, 3.75), coverage);
+    CHECK(sum(coverage) == Approx(4.25 * 2.25));
+    CHECK(coverage(1, 2) == Approx(0.25));
+    CHECK(coverage(3, 4) == Approx(0.25));
+    CHECK(coverage(1, 4) == Approx(0.0625));
+
+    // cut by the sides of the image, and turning the other way
+    core::rasterizeCoverage(square(20, 3.5, -10, -10), coverage);
+    CHECK(sum(coverage) == Approx(16 * 4));
+    CHECK(coverage(15, 0) == Approx(1));
+
+    // an antialiased star: its area, on the pixels of the mask
+    core::Polygon::Vertices points;
+    for (int i = 0; i < 14; ++i) {
+        double angle = core::IGT_PI * i / 7, r = (i % 2) ? 2.3 : 5.1;
+        points.push_back(core::Point3(7.3 + r * std::cos(angle), 5.6 + r * std::sin(angle), 0));
+    }
+    core::Polygon star(points);
+    core::rasterizeCoverage(star, coverage);
+    CHECK(sum(coverage) == Approx(star.getArea()).epsilon(1e-5));
+    core::Mask mask(16, 12);
+    core::rasterize(star, mask);
+    for (unsigned k = 0; k < 16 * 12; ++k) {
+        CHECK(coverage[k] >= 0);
+        CHECK(coverage[k] <= 1);
+        if (coverage[k] == 0)
+            CHECK_FALSE(mask[k]);
+    }
+}
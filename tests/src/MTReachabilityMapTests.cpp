@@ -0,0 +1,46 @@
+#include <catch2/catch.hpp>
+#include "MuseReachabilityMap.cpp"
+#include <cstdlib>
+
+
+TEST_CASE("ReachabilityMap.reachable", "[reachability]")
+{
+    // the focus of any settings within the limits is reachable, with or without calibration
+    MuseKinematics k;
+    MuseReachabilityMap map(k);
+    CHECK_FALSE(map.isValid());
+    map.build(4.0, 2);
+    REQUIRE(map.isValid());
+    CHECK(map.getNumReachable() > 0);
+    CHECK(map.getNumReachable() < (size_t)map.getDim(0) * map.getDim(1) * map.getDim(2));
+
+    core::Vector3 calibration(3, -2, 5);
+    std::srand(1);
+    int missed = 0;
+    for (int i = 0; i < 10000; ++i) {
+        double psi = 40.0 * std::rand() / RAND_MAX, theta = 360.0 * std::rand() / RAND_MAX;
+        double alpha = -10 + 20.0 * std::rand() / RAND_MAX, LSlider = 40.0 * std::rand() / RAND_MAX;
+        double XTrolley = -20 + 40.0 * std::rand() / RAND_MAX, ZTrolley = -20 + 40.0 * std::rand() / RAND_MAX;
+        core::Vector3 f = k.calcScannerFocus(psi, theta, alpha, LSlider, XTrolley, ZTrolley, calibration);
+        if (!map.isReachable(f, calibration))
+            ++missed;
+    }
+    CHECK(missed == 0);
+}
+
+TEST_CASE("ReachabilityMap.unreachable", "[reachability]")
+{
+    // psi >= 0 keeps the focus below the transducer centre height + focal length; far foci are out of the map
+    MuseKinematics k;
+    MuseReachabilityMap map(k);
+    map.build(4.0, 1);
+    CHECK_FALSE(map.isReachable(core::Vector3(0, 100, 0), core::Vector3()));
+    CHECK_FALSE(map.isReachable(core::Vector3(500, -55, 0), core::Vector3()));
+    CHECK(map.isReachable(core::Vector3(0, -55, 0), core::Vector3()));
+
+    // the calibration shifts the workspace
+    core::Vector3 f = k.calcScannerFocus(40, 0, 0, 40, 0, 0, core::Vector3());
+    CHECK(map.isReachable(f, core::Vector3()));
+    CHECK_FALSE(map.isReachable(f + core::Vector3(0, 30, 0), core::Vector3()));
+    CHECK(map.isReachable(f + core::Vector3(0, 30, 0), core::Vector3(0, 30, 0)));
+}
@@ -0,0 +1,52 @@
+#include <catch2/catch.hpp>
+#include "MuseSessionRecorder.cpp"
+#include "MuseSessionReplay.cpp"
+#include <cstdio>
+
+
+TEST_CASE("Session.recordReplay", "[session]")
+{
+    const std::string fileName = "MTSessionTests.mtlog";
+    std::remove(fileName.c_str());
+
+    // a short session: observed focus, settings (calibrates), desired focus (solves), reset, desired focus again
+    SettingsSnapshot s = { { 10, 20, 3, 25, -5, 6 } };
+    MuseTargetingModel recorded;
+    REQUIRE(recorded.getRecorder().open(fileName));
+    recorded.updateObservedFocus(core::Vector3(1, -50, 2));
+    recorded.updateCurrentSettings(s);
+    recorded.updateDesiredFocus(core::Vector3(5, -40, 10));
+    recorded.reset();
+    recorded.updateDesiredFocus(core::Vector3(-3, -45, 0));
+    CHECK(recorded.getRecorder().getNumRecorded() == 5);
+    recorded.getRecorder().close();
+
+    MuseSessionReplay replay;
+    REQUIRE(replay.load(fileName));
+    const std::vector<MuseMessage>& messages = replay.getMessages();
+    REQUIRE(messages.size() == 5);
+    CHECK(messages[0].type == MuseMessage::ObservedFocus);
+    CHECK(messages[1].getSettings().values[MuseDOF::Theta] == 20);
+    CHECK(messages[3].type == MuseMessage::Reset);
+    CHECK(messages[4].getFocus() == core::Vector3(-3, -45, 0));
+    CHECK(messages[4].timestamp >= messages[0].timestamp);
+
+    // same inputs, same model
+    MuseTargetingModel replayed;
+    std::vector<double> latencies = replay.run(replayed);
+    REQUIRE(latencies.size() == 5);
+    CHECK(latencies[2] > 0);
+    CHECK(replayed.getObservedFocus() == recorded.getObservedFocus());
+    CHECK(replayed.getCalibration() == recorded.getCalibration());
+    CHECK(replayed.getDesiredFocus() == recorded.getDesiredFocus());
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        CHECK(replayed.getSuggestedSettings()->getSettingValue(i) == recorded.getSuggestedSettings()->getSettingValue(i));
+
+    // the log is append-only
+    REQUIRE(recorded.getRecorder().open(fileName));
+    recorded.updateDesiredFocus(core::Vector3(0, -55, 0));
+    recorded.getRecorder().close();
+    REQUIRE(replay.load(fileName));
+    CHECK(replay.getMessages().size() == 6);
+    std::remove(fileName.c_str());
+}
@@ -1,41 +1,57 @@
 #include <catch2/catch.hpp>
-//#include "MuseTargetingSettings.cpp"
-//
-//
-//TEST_CASE("Settings.constructors", "[settings]")
-//{
-//    // check constructor
-//    MuseTargetingSettings S1;
-//    CHECK(S1.getNumSettings() == 0);
-//}
-////
-//////void addSetting(std::string name, double min, double max, double value);
-//////void addSetting(std::string name, double min, double max);
-//////void setValue(std::string settingName, double val);
-//////std::vector<MuseDegreeOfFreedom> getSettings();
-//////double getSettingMin(std::string settingName);
-//////double getSettingMax(std::string settingName);
-//////double getSettingValue(std::string settingName);
-////TEST_CASE("Settings.setget", "[settings]")
-////{
-////    MuseTargetingSettings S2;
-////    S2.addSetting("A", 0, 10, 5);
-////    CHECK(S2.getNumSettings() == 1);
-////    CHECK(S2.getSettingMin("A") == 0);
-////    CHECK(S2.getSettingMax("A") == 10);
-////    CHECK(S2.getSettingValue("A") == 5);
-////
-////    S2.addSetting("B", -10, 100); // default value == 0
-////    CHECK(S2.getNumSettings() == 2);
-////    CHECK(S2.getSettingMin("B") == -10);
-////    CHECK(S2.getSettingMax("B") == 100);
-////    CHECK(S2.getSettingValue("B") == 0);
-////
-////    S2.setValue("B", 12);
-////    CHECK(S2.getSettingValue("B") == 12);
-////
-////    std::vector<MuseDegreeOfFreedom> allSettings = S2.getSettings();
-////    CHECK(allSettings.size() == 2);
-////}
-//
-//
+#include "MuseTargetingSettings.cpp"
+
+
+TEST_CASE("Settings.constructors", "[settings]")
+{
+    // the six Muse System settings, in the order of MuseDOF::Index
+    MuseTargetingSettings S1;
+    CHECK(S1.getNumSettings() == MuseDOF::Count);
+    CHECK(S1.indexOf("Psi") == MuseDOF::Psi);
+    CHECK(S1.indexOf("ZTrolley") == MuseDOF::ZTrolley);
+    CHECK(S1.getSettingValue(MuseDOF::LSlider) == 20);
+    CHECK(S1.getSettingMax(MuseDOF::Theta) == 360);
+    CHECK(S1.getSettingMin(MuseDOF::Alpha) == -10);
+}
+
+TEST_CASE("Settings.setget", "[settings]")
+{
+    MuseTargetingSettings S2;
+    S2.addSetting("A", 0, 10, 5);
+    CHECK(S2.getNumSettings() == MuseDOF::Count + 1);
+    CHECK(S2.getSettingMin("A") == 0);
+    CHECK(S2.getSettingMax("A") == 10);
+    CHECK(S2.getSettingValue("A") == 5);
+
+    S2.addSetting("B", -10, 100); // default value == 0
+    CHECK(S2.getNumSettings() == MuseDOF::Count + 2);
+    CHECK(S2.getSettingMin("B") == -10);
+    CHECK(S2.getSettingMax("B") == 100);
+    CHECK(S2.getSettingValue("B") == 0);
+
+    S2.setValue("B", 12);
+    CHECK(S2.getSettingValue("B") == 12);
+    int b = S2.indexOf("B");
+    S2.setValue(b, 13);
+    CHECK(S2.getSettingValue(b) == 13);
+    CHECK(S2.indexOf("C") == -1);
+
+    const std::vector<MuseTargetingDOF>& allSettings = S2.getSettings();
+    CHECK(allSettings.size() == MuseDOF::Count + 2);
+}
+
+TEST_CASE("Settings.snapshot", "[settings]")
+{
+    MuseTargetingSettings S3;
+    SettingsSnapshot s = { { 10, 20, 3, 4, -5, 6 } };
+    S3.setValues(s);
+    CHECK(S3.getSettingValue("Theta") == 20);
+    CHECK(S3.getSettingValue("XTrolley") == -5);
+    SettingsSnapshot t = S3.getSnapshot();
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        CHECK(t.values[i] == s.values[i]);
+
+    S3.resetToDefault();
+    CHECK(S3.getSettingValue(MuseDOF::Psi) == 0);
+    CHECK(S3.getSettingValue(MuseDOF::LSlider) == 20);
+}
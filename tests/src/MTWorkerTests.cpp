@@ -0,0 +1,113 @@
+#include <catch2/catch.hpp>
+#include "MuseTargetingWorker.cpp"
+#include "MuseTargetingModel.h"
+#include <vector>
+
+
+TEST_CASE("Worker.calcSuggestedSettings", "[worker]")
+{
+    // a request carries everything the solve needs
+    MuseKinematics k;
+    MuseSolveRequest request;
+    double target[MuseDOF::Count] = { 25, 30, 5, 10, -8, 12 };
+    double current[MuseDOF::Count] = { 0, 0, 0, 20, 0, 0 };
+    std::copy(current, current + MuseDOF::Count, request.initial);
+    std::copy(current, current + MuseDOF::Count, request.current);
+    request.calibration = core::Vector3(2, -1, 4);
+    core::Vector3 jacobian[MuseDOF::Count];
+    request.desiredScannerFocus = k.calcScannerFocus(target, request.calibration, jacobian);
+    request.ik = std::make_shared<MuseInverseKinematics>(k);
+    request.generation = 7;
+
+    MuseSolveResult result = MuseTargetingWorker::calcSuggestedSettings(request);
+    CHECK(result.generation == 7);
+    CHECK(result.isReachable);
+    CHECK(result.solve.converged);
+
+    // with a table built for the solver, its lookup is refined once; a table built for other limits is ignored
+    MuseInverseKinematics other(k);
+    other.setLimits(MuseDOF::Psi, 0, 30);
+    core::Vector3 focus = request.desiredScannerFocus - core::Vector3(-2, -1, 4);
+    std::shared_ptr<MuseIKTable> table = std::make_shared<MuseIKTable>(*request.ik);
+    table->build(focus - core::Vector3(6, 6, 6), focus + core::Vector3(6, 6, 6), 3, 1);
+    request.ikTable = table;
+    result = MuseTargetingWorker::calcSuggestedSettings(request);
+    CHECK(result.solve.converged);
+    CHECK(result.solve.iterations <= 1);
+    table = std::make_shared<MuseIKTable>(other);
+    table->build(focus - core::Vector3(6, 6, 6), focus + core::Vector3(6, 6, 6), 3, 1);
+    request.ikTable = table;
+    result = MuseTargetingWorker::calcSuggestedSettings(request);
+    CHECK(result.solve.converged);
+    CHECK(result.solve.iterations > 1);
+    request.ikTable.reset();
+
+    // out of the workspace: no solve, the current settings are suggested
+    std::shared_ptr<MuseReachabilityMap> map = std::make_shared<MuseReachabilityMap>(k);
+    map->build(4.0, 1);
+    request.reachabilityMap = map;
+    CHECK(MuseTargetingWorker::calcSuggestedSettings(request).isReachable);
+    request.desiredScannerFocus = core::Vector3(0, 200, 0);
+    result = MuseTargetingWorker::calcSuggestedSettings(request);
+    CHECK_FALSE(result.isReachable);
+    CHECK_FALSE(result.solve.converged);
+    CHECK(result.solve.iterations == 0);
+    for (int i = 0; i < MuseDOF::Count; ++i)
+        CHECK(result.solve.settings[i] == current[i]);
+}
+
+TEST_CASE("Worker.coalescing", "[worker]")
+{
+    // the model publishes each new generation before queueing its request: when the worker gets to the queue,
+    // only the latest request is solved and emitted
+    MuseKinematics k;
+    MuseTargetingWorker worker;
+    std::vector<MuseSolveResult> results;
+    QObject::connect(&worker, &MuseTargetingWorker::solved, [&results](MuseSolveResult result) { results.push_back(result); });
+
+    std::shared_ptr<const MuseInverseKinematics> ik = std::make_shared<MuseInverseKinematics>(k);
+    double current[MuseDOF::Count] = { 0, 0, 0, 20, 0, 0 };
+    core::Vector3 jacobian[MuseDOF::Count];
+    std::vector<MuseSolveRequest> queue;
+    for (int i = 1; i <= 5; ++i) {
+        double target[MuseDOF::Count] = { 5.0 * i, 30, 5, 10, -8, 12 };
+        MuseSolveRequest request;
+        std::copy(current, current + MuseDOF::Count, request.initial);
+        std::copy(current, current + MuseDOF::Count, request.current);
+        request.desiredScannerFocus = k.calcScannerFocus(target, request.calibration, jacobian);
+        request.ik = ik;
+        request.generation = i;
+        worker.setLatestGeneration(request.generation);
+        queue.push_back(request);
+    }
+    for (size_t i = 0; i < queue.size(); ++i)
+        worker.solve(queue[i]);
+    REQUIRE(results.size() == 1);
+    CHECK(results[0].generation == 5);
+    CHECK(results[0].solve.converged);
+    core::Vector3 focus = k.calcScannerFocus(results[0].solve.settings, queue.back().calibration, jacobian);
+    CHECK((focus - queue.back().desiredScannerFocus).length() < 1e-3);
+
+    // nothing newer: the latest request is solved again if delivered again, older ones stay stale
+    worker.solve(queue[3]);
+    worker.solve(queue[4]);
+    REQUIRE(results.size() == 2);
+    CHECK(results[1].generation == 5);
+}
+
+TEST_CASE("Worker.reachabilityMap", "[worker]")
+{
+    // the model builds its map of the workspace in the background: until then the reachability is unknown and
+    // every desired focus is solved for, once it is ready the foci out of reach are not
+    MuseTargetingModel model;
+    model.updateDesiredFocus(core::Vector3(5, -40, 10));
+    CHECK(model.isDesiredFocusReachable());
+    CHECK(model.getSuggestedSettingsSolve().converged);
+    model.waitForReachabilityMap();
+    model.updateDesiredFocus(core::Vector3(0, 200, 0));
+    CHECK_FALSE(model.isDesiredFocusReachable());
+    CHECK(model.getSuggestedSettingsSolve().iterations == 0);
+    model.updateDesiredFocus(core::Vector3(5, -40, 10));
+    CHECK(model.isDesiredFocusReachable());
+    CHECK(model.getSuggestedSettingsSolve().converged);
+}